@@ -38,6 +38,10 @@ from psycopg2._psycopg import BINARYARRAY, BOOLEANARRAY, DATEARRAY, DATETIMEARRA
 from psycopg2._psycopg import DECIMALARRAY, FLOATARRAY, INTEGERARRAY, INTERVALARRAY
 from psycopg2._psycopg import LONGINTEGERARRAY, ROWIDARRAY, STRINGARRAY, TIMEARRAY
 from psycopg2._psycopg import UNICODEARRAY
+from psycopg2._psycopg import DEC2FLOAT, DEC2INT, DEC2FLOATARRAY, DEC2INTARRAY
+from psycopg2._psycopg import PACKEDFLOATARRAY, PACKEDINTEGERARRAY
+from psycopg2._psycopg import PACKEDLONGINTEGERARRAY
+from psycopg2._psycopg import JSON, JSONARRAY, JSONB, JSONBARRAY
 
 from psycopg2._psycopg import Binary, Boolean, Int, Float, QuotedString, AsIs
 try:
@@ -113,28 +117,9 @@ def register_adapter(typ, callable):
     adapters[(typ, ISQLQuote)] = callable
 
 
-# The SQL_IN class is the official adapter for tuples starting from 2.0.6.
-class SQL_IN(object):
-    """Adapt any iterable to an SQL quotable object."""
-    
-    def __init__(self, seq):
-        self._seq = seq
-
-    def prepare(self, conn):
-        self._conn = conn
-    
-    def getquoted(self):
-        # this is the important line: note how every object in the
-        # list is adapted and then how getquoted() is called on it
-        pobjs = [adapt(o) for o in self._seq]
-        for obj in pobjs:
-            if hasattr(obj, 'prepare'):
-                obj.prepare(self._conn)
-        qobjs = [o.getquoted() for o in pobjs]
-        return b('(') + b(', ').join(qobjs) + b(')')
-
-    def __str__(self):
-        return str(self.getquoted())
+# The SQL_IN class is the official adapter for tuples starting from 2.0.6,
+# implemented in C from 2.5.
+from psycopg2._psycopg import SQL_IN
 
 
 class NoneAdapter(object):
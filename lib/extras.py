@@ -37,6 +37,7 @@ except:
     logging = None
 
 import psycopg2
+from psycopg2 import _psycopg
 from psycopg2 import extensions as _ext
 from psycopg2.extensions import cursor as _cursor
 from psycopg2.extensions import connection as _connection
@@ -453,6 +454,9 @@ def register_uuid(oids=None, conn_or_curs=None):
         standard oids.
     :param conn_or_curs: where to register the typecaster. If not specified,
         register it globally.
+
+    .. versionchanged:: 2.5
+        the typecaster and the adapter are implemented in C.
     """
 
     import uuid
@@ -466,13 +470,12 @@ def register_uuid(oids=None, conn_or_curs=None):
         oid1 = oids
         oid2 = 2951
 
-    _ext.UUID = _ext.new_type((oid1, ), "UUID",
-            lambda data, cursor: data and uuid.UUID(data) or None)
+    _ext.UUID = _ext.new_type((oid1, ), "UUID", _psycopg.UUID)
     _ext.UUIDARRAY = _ext.new_array_type((oid2,), "UUID[]", _ext.UUID)
 
     _ext.register_type(_ext.UUID, conn_or_curs)
     _ext.register_type(_ext.UUIDARRAY, conn_or_curs)
-    _ext.register_adapter(uuid.UUID, UUID_adapter)
+    _ext.register_adapter(uuid.UUID, _psycopg.Uuid)
 
     return _ext.UUID
 
@@ -536,6 +539,32 @@ def register_inet(oid=None, conn_or_curs=None):
 
     return _ext.INET
 
+def register_ipaddress(conn_or_curs=None):
+    """Register conversion support between `ipaddress` objects and network
+    types.
+
+    :param conn_or_curs: the scope where to register the typecasters. If not
+        specified, register them globally.
+
+    After the function is called, PostgreSQL :sql:`inet` values will be
+    converted into `!IPv4Interface` or `!IPv6Interface` objects, :sql:`cidr`
+    values into `!IPv4Network` or `!IPv6Network`. Python networks are
+    adapted to :sql:`cidr`, addresses and interfaces to :sql:`inet`.
+
+    The `!ipaddress` module is available in the standard library from Python
+    3.3; on Python 2 the `!ipaddress` backport can be used.
+    """
+    import ipaddress
+
+    for c in (_psycopg.INET, _psycopg.INETARRAY,
+            _psycopg.CIDR, _psycopg.CIDRARRAY):
+        _ext.register_type(c, conn_or_curs)
+
+    for t in (ipaddress.IPv4Address, ipaddress.IPv6Address,
+            ipaddress.IPv4Interface, ipaddress.IPv6Interface,
+            ipaddress.IPv4Network, ipaddress.IPv6Network):
+        _ext.register_adapter(t, _psycopg.IPAddress)
+
 
 def register_tstz_w_secs(oids=None, conn_or_curs=None):
     """The function used to register an alternate type caster for
@@ -752,6 +781,9 @@ def register_hstore(conn_or_curs, globally=False, unicode=False,
     .. versionchanged:: 2.4.3
         added support for |hstore| array.
 
+    .. versionchanged:: 2.5
+        the typecaster and the adapter are implemented in C.
+
     """
     if oid is None:
         oid = HstoreAdapter.get_oids(conn_or_curs)
@@ -772,15 +804,16 @@ def register_hstore(conn_or_curs, globally=False, unicode=False,
         else:
             array_oid = tuple([x for x in array_oid if x])
 
-    # create and register the typecaster
+    # create and register the typecaster, using the C implementation of
+    # the parser and the adapter if available
     if sys.version_info[0] < 3 and unicode:
-        cast = HstoreAdapter.parse_unicode
+        cast = getattr(_psycopg, 'UNICODEHSTORE', HstoreAdapter.parse_unicode)
     else:
-        cast = HstoreAdapter.parse
+        cast = getattr(_psycopg, 'HSTORE', HstoreAdapter.parse)
 
     HSTORE = _ext.new_type(oid, "HSTORE", cast)
     _ext.register_type(HSTORE, not globally and conn_or_curs or None)
-    _ext.register_adapter(dict, HstoreAdapter)
+    _ext.register_adapter(dict, getattr(_psycopg, 'Hstore', HstoreAdapter))
 
     if array_oid:
         HSTOREARRAY = _ext.new_array_type(array_oid, "HSTOREARRAY", HSTORE)
@@ -821,6 +854,10 @@ class CompositeCaster(object):
 
         List of component type oids of the type to be casted.
 
+    .. versionchanged:: 2.5
+        the records are parsed in C, unless `!parse()` or `!tokenize()` is
+        overridden in a subclass.
+
     """
     def __init__(self, name, oid, attrs, array_oid=None):
         self.name = name
@@ -830,7 +867,16 @@ class CompositeCaster(object):
         self.attnames = [ a[0] for a in attrs ]
         self.atttypes = [ a[1] for a in attrs ]
         self._create_type(name, self.attnames)
-        self.typecaster = _ext.new_type((oid,), name, self.parse)
+
+        # parse the records in C, unless a subclass customized the parsing
+        if (hasattr(_psycopg, 'new_composite_type')
+                and type(self).parse == CompositeCaster.parse
+                and type(self).tokenize.__func__
+                    is CompositeCaster.tokenize.__func__):
+            self.typecaster = _psycopg.new_composite_type(
+                (oid,), name, tuple(self.atttypes), self._ctor)
+        else:
+            self.typecaster = _ext.new_type((oid,), name, self.parse)
         if array_oid:
             self.array_typecaster = _ext.new_array_type(
                 (array_oid,), "%sARRAY" % name, self.typecaster)
@@ -965,4 +1011,488 @@ def register_composite(name, conn_or_curs, globally=False):
     return caster
 
 
+# JSON adaptation
+
+# The adapter is implemented in C: a subclass can override dumps() to
+# customize the serialization.
+Json = _psycopg.Json
+
+def register_json(conn_or_curs=None, globally=False, loads=None,
+        oid=None, array_oid=None, name='json'):
+    """Create and register typecasters converting :sql:`json` type to Python.
+
+    :param conn_or_curs: a connection or cursor used to find the :sql:`json`
+        and :sql:`json[]` oids; the typecasters are registered in a scope
+        limited to this object, unless *globally* is set to `!True`. It can be
+        `!None` if the oids are provided
+    :param globally: if `!False` register the typecasters only on
+        *conn_or_curs*, otherwise register them globally
+    :param loads: the function used to parse the data into a Python object. If
+        `!None` use `!json.loads()`, where `!json` is the module chosen
+        according to the Python version (see above)
+    :param oid: the OID of the :sql:`json` type if known; If not, it will be
+        queried on *conn_or_curs*
+    :param array_oid: the OID of the :sql:`json[]` array type if known;
+        if not, it will be queried on *conn_or_curs*
+    :param name: the name of the data type to look for in *conn_or_curs*
+    :return: the typecasters created for the type and for its array
+
+    The connection or cursor passed to the function will be used to query the
+    database and look for the OID of the :sql:`json` type. No query is
+    performed if *oid* and *array_oid* are provided.  Raise
+    `~psycopg2.ProgrammingError` if the type is not found.
+
+    The typecasters are implemented in C: *loads* is called once per value,
+    receiving the same string a Python typecaster would receive.
+
+    """
+    if oid is None:
+        oid, array_oid = _get_json_oids(conn_or_curs, name)
+
+    JSON = _psycopg.new_json_type((oid,), name.upper(), loads)
+    _ext.register_type(JSON, not globally and conn_or_curs or None)
+
+    JSONARRAY = None
+    if array_oid:
+        JSONARRAY = _ext.new_array_type(
+            (array_oid,), "%sARRAY" % name.upper(), JSON)
+        _ext.register_type(JSONARRAY, not globally and conn_or_curs or None)
+
+    return JSON, JSONARRAY
+
+def register_default_json(conn_or_curs=None, globally=False, loads=None):
+    """
+    Create and register :sql:`json` typecasters for PostgreSQL 9.2 and following.
+
+    Since PostgreSQL 9.2 :sql:`json` is a builtin type, hence its oid is known
+    and fixed. This function allows specifying a customized *loads* function
+    for the default :sql:`json` type without querying the database.
+    All the parameters have the same meaning of `register_json()`.
+    """
+    return register_json(conn_or_curs=conn_or_curs, globally=globally,
+        loads=loads, oid=114, array_oid=199)
+
+def register_default_jsonb(conn_or_curs=None, globally=False, loads=None):
+    """
+    Create and register :sql:`jsonb` typecasters for PostgreSQL 9.4 and following.
+
+    As in `register_default_json()`, the function allows to register a
+    customized *loads* function for the :sql:`jsonb` type at its known oid.
+    """
+    return register_json(conn_or_curs=conn_or_curs, globally=globally,
+        loads=loads, oid=3802, array_oid=3807, name='jsonb')
+
+def _get_json_oids(conn_or_curs, name='json'):
+    if hasattr(conn_or_curs, 'execute'):
+        conn = conn_or_curs.connection
+        curs = conn_or_curs
+    else:
+        conn = conn_or_curs
+        curs = conn_or_curs.cursor()
+
+    # Store the transaction status of the connection to revert it after use
+    conn_status = conn.status
+
+    # column typarray not available before PG 8.3
+    typarray = conn.server_version >= 80300 and "typarray" or "NULL"
+
+    # get the oid for the json type
+    curs.execute(
+        "SELECT t.oid, %s FROM pg_type t WHERE t.typname = %%s;"
+        % typarray, (name,))
+    r = curs.fetchone()
+
+    # revert the status of the connection as before the command
+    if (conn_status != _ext.STATUS_IN_TRANSACTION
+    and not conn.autocommit):
+        conn.rollback()
+
+    if not r:
+        raise psycopg2.ProgrammingError("%s data type not found" % name)
+
+    return r
+
+
+# Range types support
+
+class Range(object):
+    """Python representation for a PostgreSQL |range|_ type.
+
+    :param lower: lower bound for the range. `!None` means unbound
+    :param upper: upper bound for the range. `!None` means unbound
+    :param bounds: one of the literal strings ``()``, ``[)``, ``(]``, ``[]``,
+        representing whether the lower or upper bounds are included
+    :param empty: if `!True`, the range is empty
+
+    """
+    __slots__ = ('_lower', '_upper', '_bounds')
+
+    def __init__(self, lower=None, upper=None, bounds='[)', empty=False):
+        if not empty:
+            if bounds not in ('[)', '(]', '()', '[]'):
+                raise ValueError("bound flags not valid: %r" % bounds)
+
+            self._lower = lower
+            self._upper = upper
+            self._bounds = bounds
+        else:
+            self._lower = self._upper = self._bounds = None
+
+    def __repr__(self):
+        if self._bounds is None:
+            return "%s(empty=True)" % self.__class__.__name__
+        else:
+            return "%s(%r, %r, %r)" % (self.__class__.__name__,
+                self._lower, self._upper, self._bounds)
+
+    @property
+    def lower(self):
+        """The lower bound of the range. `!None` if empty or unbound."""
+        return self._lower
+
+    @property
+    def upper(self):
+        """The upper bound of the range. `!None` if empty or unbound."""
+        return self._upper
+
+    @property
+    def isempty(self):
+        """`!True` if the range is empty."""
+        return self._bounds is None
+
+    @property
+    def lower_inf(self):
+        """`!True` if the range doesn't have a lower bound."""
+        if self._bounds is None: return False
+        return self._lower is None
+
+    @property
+    def upper_inf(self):
+        """`!True` if the range doesn't have an upper bound."""
+        if self._bounds is None: return False
+        return self._upper is None
+
+    @property
+    def lower_inc(self):
+        """`!True` if the lower bound is included in the range."""
+        if self._bounds is None or self._lower is None: return False
+        return self._bounds[0] == '['
+
+    @property
+    def upper_inc(self):
+        """`!True` if the upper bound is included in the range."""
+        if self._bounds is None or self._upper is None: return False
+        return self._bounds[1] == ']'
+
+    def __contains__(self, x):
+        if self._bounds is None: return False
+        if self._lower is not None:
+            if self._bounds[0] == '[':
+                if x < self._lower: return False
+            else:
+                if x <= self._lower: return False
+
+        if self._upper is not None:
+            if self._bounds[1] == ']':
+                if x > self._upper: return False
+            else:
+                if x >= self._upper: return False
+
+        return True
+
+    def __nonzero__(self):
+        return self._bounds is not None
+
+    def __eq__(self, other):
+        if not isinstance(other, Range):
+            return False
+        return (self._lower == other._lower
+            and self._upper == other._upper
+            and self._bounds == other._bounds)
+
+    def __ne__(self, other):
+        return not self.__eq__(other)
+
+    def __hash__(self):
+        return hash((self._lower, self._upper, self._bounds))
+
+    def __getstate__(self):
+        return dict(
+            (slot, getattr(self, slot))
+            for slot in Range.__slots__ if hasattr(self, slot))
+
+    def __setstate__(self, state):
+        for slot, value in state.items():
+            setattr(self, slot, value)
+
+class NumericRange(Range):
+    """A `Range` suitable to pass Python numeric types to a PostgreSQL range.
+
+    PostgreSQL types :sql:`int4range`, :sql:`int8range`, :sql:`numrange` are
+    casted into `!NumericRange` instances.
+    """
+    __slots__ = ()
+
+class DateRange(Range):
+    """Represents :sql:`daterange` values."""
+    __slots__ = ()
+
+class DateTimeRange(Range):
+    """Represents :sql:`tsrange` values."""
+    __slots__ = ()
+
+class DateTimeTZRange(Range):
+    """Represents :sql:`tstzrange` values."""
+    __slots__ = ()
+
+
+# The adapter is implemented in C: concrete adapters are subclasses setting
+# the name of the PostgreSQL range type in the `name` class attribute.
+RangeAdapter = _psycopg.RangeAdapter
+
+class NumberRangeAdapter(RangeAdapter):
+    """Adapt a range if the subtype doesn't need quotes.
+
+    The range is adapted to an untyped literal such as ``'[10,20)'``, which
+    PostgreSQL can convert to any numeric range.
+    """
+    name = None
+
+class RangeCaster(object):
+    """Helper class to convert between `Range` and PostgreSQL range types.
+
+    Objects of this class are usually created by `register_range()`. Manual
+    creation could be useful if querying the database is not advisable: in
+    this case the oids must be provided.
+
+    .. versionadded:: 2.5
+
+    """
+    def __init__(self, pgrange, pyrange, oid, subtype_oid, array_oid=None):
+        self.subtype_oid = subtype_oid
+        self._create_ranges(pgrange, pyrange)
+
+        name = self.adapter.name or self.adapter.__name__
+
+        # parse the ranges in C, unless a subclass customized the parsing
+        if type(self).parse == RangeCaster.parse:
+            self.typecaster = _psycopg.new_range_type(
+                (oid,), name, subtype_oid, self.range)
+        else:
+            self.typecaster = _ext.new_type((oid,), name, self.parse)
+
+        if array_oid is not None:
+            self.array_typecaster = _ext.new_array_type(
+                (array_oid,), name + "ARRAY", self.typecaster)
+        else:
+            self.array_typecaster = None
+
+    def _create_ranges(self, pgrange, pyrange):
+        """Create Range and RangeAdapter classes if needed."""
+        # if got a string create a new RangeAdapter concrete type (with a name)
+        # else take it as an adapter. Passing an adapter should be considered
+        # an implementation detail and is not documented. It is currently used
+        # for the numeric ranges.
+        self.adapter = None
+        if isinstance(pgrange, basestring):
+            self.adapter = type(pgrange, (RangeAdapter,), {})
+            self.adapter.name = pgrange
+        else:
+            try:
+                if issubclass(pgrange, RangeAdapter) \
+                        and pgrange is not RangeAdapter:
+                    self.adapter = pgrange
+            except TypeError:
+                pass
+
+        if self.adapter is None:
+            raise TypeError(
+                'pgrange must be a string or a RangeAdapter strict subclass')
+
+        self.range = None
+        try:
+            if isinstance(pyrange, basestring):
+                self.range = type(pyrange, (Range,), {})
+            elif issubclass(pyrange, Range) and pyrange is not Range:
+                self.range = pyrange
+        except TypeError:
+            pass
+
+        if self.range is None:
+            raise TypeError(
+                'pyrange must be a type or a Range strict subclass')
+
+    @classmethod
+    def _from_db(self, name, pyrange, conn_or_curs):
+        """Return a `RangeCaster` instance for the type *pgrange*.
+
+        Raise `ProgrammingError` if the type is not found.
+        """
+        if hasattr(conn_or_curs, 'execute'):
+            conn = conn_or_curs.connection
+            curs = conn_or_curs
+        else:
+            conn = conn_or_curs
+            curs = conn_or_curs.cursor()
+
+        if conn.server_version < 90200:
+            raise psycopg2.ProgrammingError(
+                "range types not available in version %s"
+                % conn.server_version)
+
+        # Store the transaction status of the connection to revert it after use
+        conn_status = conn.status
+
+        # Use the correct schema
+        if '.' in name:
+            schema, tname = name.split('.', 1)
+        else:
+            tname = name
+            schema = 'public'
+
+        # get the type oid and attributes
+        try:
+            curs.execute("""\
+SELECT rngtypid, rngsubtype,
+    (SELECT typarray FROM pg_type WHERE oid = rngtypid)
+FROM pg_range r
+JOIN pg_type t ON t.oid = rngtypid
+JOIN pg_namespace ns ON ns.oid = typnamespace
+WHERE typname = %s AND ns.nspname = %s;
+""", (tname, schema))
+
+        except psycopg2.ProgrammingError:
+            if not conn.autocommit:
+                conn.rollback()
+            raise
+
+        rec = curs.fetchone()
+
+        # revert the status of the connection as before the command
+        if (conn_status != _ext.STATUS_IN_TRANSACTION
+        and not conn.autocommit):
+            conn.rollback()
+
+        if not rec:
+            raise psycopg2.ProgrammingError(
+                "PostgreSQL type '%s' not found" % name)
+
+        type, subtype, array = rec
+
+        return RangeCaster(name, pyrange,
+            oid=type, subtype_oid=subtype, array_oid=array)
+
+    _re_range = regex.compile(r"""
+        ( \(|\[ )                   # lower bound flag
+        (?:                         # lower bound:
+          " ( (?: [^"] | "")* ) "   #   - a quoted string
+          | ( [^",]+ )              #   - or an unquoted string
+        )?                          #   - or empty (not catched)
+        ,
+        (?:                         # upper bound:
+          " ( (?: [^"] | "")* ) "   #   - a quoted string
+          | ( [^"\)\]]+ )           #   - or an unquoted string
+        )?                          #   - or empty (not catched)
+        ( \)|\] )                   # upper bound flag
+        """, regex.VERBOSE)
+
+    _re_undouble = regex.compile(r'(["\\])\1')
+
+    def parse(self, s, cur=None):
+        if s is None:
+            return None
+
+        if s == 'empty':
+            return self.range(empty=True)
+
+        m = self._re_range.match(s)
+        if m is None:
+            raise psycopg2.InterfaceError("failed to parse range: '%s'" % s)
+
+        lower = m.group(3)
+        if lower is None:
+            lower = m.group(2)
+            if lower is not None:
+                lower = self._re_undouble.sub(r"\1", lower)
+
+        upper = m.group(5)
+        if upper is None:
+            upper = m.group(4)
+            if upper is not None:
+                upper = self._re_undouble.sub(r"\1", upper)
+
+        if cur is not None:
+            lower = cur.cast(self.subtype_oid, lower)
+            upper = cur.cast(self.subtype_oid, upper)
+
+        bounds = m.group(1) + m.group(6)
+
+        return self.range(lower, upper, bounds)
+
+    def _register(self, scope=None):
+        _ext.register_type(self.typecaster, scope)
+        if self.array_typecaster is not None:
+            _ext.register_type(self.array_typecaster, scope)
+
+        _ext.register_adapter(self.range, self.adapter)
+
+def register_range(pgrange, pyrange, conn_or_curs, globally=False):
+    """Create and register an adapter and the typecasters to convert between
+    a PostgreSQL |range|_ type and a PostgreSQL `Range` subclass.
+
+    :param pgrange: the name of the PostgreSQL |range| type. Can be
+        schema-qualified
+    :param pyrange: a `Range` strict subclass, or just a name to give to a new
+        class
+    :param conn_or_curs: a connection or cursor used to find the oid of the
+        range and its subtype; the typecaster is registered in a scope limited
+        to this object, unless *globally* is set to `!True`
+    :param globally: if `!False` (default) register the typecaster only on
+        *conn_or_curs*, otherwise register it globally
+    :return: `RangeCaster` instance responsible for the conversion
+
+    If a string is passed to *pyrange*, a new `Range` subclass is created
+    with such name and will be available as the `~RangeCaster.range` attribute
+    of the returned `RangeCaster` object.
+
+    The function queries the database on *conn_or_curs* to inspect the
+    *pgrange* type and raises `~psycopg2.ProgrammingError` if the type is not
+    found.  If querying the database is not advisable, use directly the
+    `RangeCaster` class and register the adapter and typecasters using the
+    provided functions.
+
+    """
+    caster = RangeCaster._from_db(pgrange, pyrange, conn_or_curs)
+    caster._register(not globally and conn_or_curs or None)
+    return caster
+
+
+# Register global typecasters and adapters for builtin range types.
+
+# note: the adapter is registered more than once, but this is harmless.
+int4range_caster = RangeCaster(NumberRangeAdapter, NumericRange,
+    oid=3904, subtype_oid=23, array_oid=3905)
+int4range_caster._register()
+
+int8range_caster = RangeCaster(NumberRangeAdapter, NumericRange,
+    oid=3926, subtype_oid=20, array_oid=3927)
+int8range_caster._register()
+
+numrange_caster = RangeCaster(NumberRangeAdapter, NumericRange,
+    oid=3906, subtype_oid=1700, array_oid=3907)
+numrange_caster._register()
+
+daterange_caster = RangeCaster('daterange', DateRange,
+    oid=3912, subtype_oid=1082, array_oid=3913)
+daterange_caster._register()
+
+tsrange_caster = RangeCaster('tsrange', DateTimeRange,
+    oid=3908, subtype_oid=1114, array_oid=3909)
+tsrange_caster._register()
+
+tstzrange_caster = RangeCaster('tstzrange', DateTimeTZRange,
+    oid=3910, subtype_oid=1184, array_oid=3911)
+tstzrange_caster._register()
+
+
 __all__ = filter(lambda k: not k.startswith('_'), locals().keys())
@@ -47,85 +47,155 @@ binary_escape(unsigned char *from, size_t from_length,
         return PQescapeBytea(from, from_length, to_length);
 }
 
-#define HAS_BUFFER (PY_MAJOR_VERSION < 3)
-#define HAS_MEMORYVIEW (PY_MAJOR_VERSION > 2 || PY_MINOR_VERSION >= 6)
-
-/* binary_quote - do the quote process on plain and unicode strings */
+/* binary_quote_hex - build the literal '\x...'::bytea from a buffer */
 
 static PyObject *
-binary_quote(binaryObject *self)
+binary_quote_hex(const unsigned char *buffer, Py_ssize_t len, int equote)
 {
-    char *to = NULL;
-    const char *buffer = NULL;
-    Py_ssize_t buffer_len;
-    size_t len = 0;
-    PyObject *rv = NULL;
-#if HAS_MEMORYVIEW
-    Py_buffer view;
-    int got_view = 0;
-#endif
+    PyObject *rv;
+    char *ptr;
+    Py_ssize_t prefix = equote ? 5 : 3;   /* E'\\x or '\x */
 
-    /* Allow Binary(None) to work */
-    if (self->wrapped == Py_None) {
-        Py_INCREF(psyco_null);
-        rv = psyco_null;
-        goto exit;
+    if (len > (PY_SSIZE_T_MAX - prefix - 8) / 2) {
+        PyErr_NoMemory();
+        return NULL;
     }
 
-    /* if we got a plain string or a buffer we escape it and save the buffer */
-
-#if HAS_MEMORYVIEW
-    if (PyObject_CheckBuffer(self->wrapped)) {
-        if (0 > PyObject_GetBuffer(self->wrapped, &view, PyBUF_CONTIG_RO)) {
-            goto exit;
-        }
-        got_view = 1;
-        buffer = (const char *)(view.buf);
-        buffer_len = view.len;
+    if (!(rv = Bytes_FromStringAndSize(NULL, prefix + 2 * len + 8))) {
+        return NULL;
     }
-#endif
 
-#if HAS_BUFFER
-    if (!buffer && (Bytes_Check(self->wrapped) || PyBuffer_Check(self->wrapped))) {
-        if (PyObject_AsReadBuffer(self->wrapped, (const void **)&buffer,
-                                  &buffer_len) < 0) {
-            goto exit;
-        }
+    ptr = Bytes_AS_STRING(rv);
+    if (equote) { *ptr++ = 'E'; }
+    *ptr++ = '\'';
+    if (equote) { *ptr++ = '\\'; }
+    *ptr++ = '\\';
+    *ptr++ = 'x';
+
+    psycopg_hex_encode(buffer, len, ptr);
+    ptr += 2 * len;
+    memcpy(ptr, "'::bytea", 8);
+
+    return rv;
+}
+
+/* binary_quote_buffer - build the bytea literal for a buffer
+ *
+ * conn may be NULL: in this case the literal is built with the escaping
+ * functions not depending on the connection.
+ */
+
+PyObject *
+binary_quote_buffer(const char *buffer, Py_ssize_t buffer_len,
+                    connectionObject *conn)
+{
+    char *to = NULL;
+    size_t len = 0;
+    PyObject *rv = NULL;
+
+    /* empty buffers have no escape */
+    if (buffer_len == 0) {
+        return Bytes_FromString("''::bytea");
     }
-#endif
 
-    if (!buffer) {
-        goto exit;
+    /* servers from 9.0 parse the hex format: we can build the literal in a
+     * single pass without the libpq escape and its temporary buffer. */
+    if (conn && conn->server_version >= 90000) {
+        return binary_quote_hex((const unsigned char *)buffer, buffer_len,
+            conn->equote);
     }
 
     /* escape and build quoted buffer */
 
     to = (char *)binary_escape((unsigned char*)buffer, (size_t)buffer_len,
-        &len, self->conn ? ((connectionObject*)self->conn)->pgconn : NULL);
+        &len, conn ? conn->pgconn : NULL);
     if (to == NULL) {
         PyErr_NoMemory();
-        goto exit;
+        return NULL;
     }
 
     if (len > 0)
         rv = Bytes_FromFormat(
-            (self->conn && ((connectionObject*)self->conn)->equote)
-                ? "E'%s'::bytea" : "'%s'::bytea" , to);
+            (conn && conn->equote) ? "E'%s'::bytea" : "'%s'::bytea" , to);
     else
         rv = Bytes_FromString("''::bytea");
 
-exit:
-    if (to) { PQfreemem(to); }
+    PQfreemem(to);
+    return rv;
+}
+
+/* binary_buffer_get - access the content of a bytes-like object
+ *
+ * On success the buffer must be released with binary_buffer_release().
+ */
+
+int
+binary_buffer_get(PyObject *obj, binarybuf *b)
+{
+    b->buf = NULL;
+    b->len = 0;
 #if HAS_MEMORYVIEW
-    if (got_view) { PyBuffer_Release(&view); }
+    b->got_view = 0;
+
+    if (PyObject_CheckBuffer(obj)) {
+        if (0 > PyObject_GetBuffer(obj, &b->view, PyBUF_CONTIG_RO)) {
+            return -1;
+        }
+        b->got_view = 1;
+        b->buf = (const char *)(b->view.buf);
+        b->len = b->view.len;
+        return 0;
+    }
 #endif
 
-    /* if the wrapped object is not bytes or a buffer, this is an error */
-    if (!rv && !PyErr_Occurred()) {
-        PyErr_Format(PyExc_TypeError, "can't escape %s to binary",
-            Py_TYPE(self->wrapped)->tp_name);
+#if HAS_BUFFER
+    if (Bytes_Check(obj) || PyBuffer_Check(obj)) {
+        if (PyObject_AsReadBuffer(obj, (const void **)&b->buf, &b->len) < 0) {
+            return -1;
+        }
+        return 0;
+    }
+#endif
+
+    /* if the object is not bytes or a buffer, this is an error */
+    PyErr_Format(PyExc_TypeError, "can't escape %s to binary",
+        Py_TYPE(obj)->tp_name);
+    return -1;
+}
+
+void
+binary_buffer_release(binarybuf *b)
+{
+#if HAS_MEMORYVIEW
+    if (b->got_view) {
+        PyBuffer_Release(&b->view);
+        b->got_view = 0;
     }
+#endif
+}
+
+/* binary_quote - do the quote process on plain and unicode strings */
+
+static PyObject *
+binary_quote(binaryObject *self)
+{
+    binarybuf b;
+    PyObject *rv;
+
+    /* Allow Binary(None) to work */
+    if (self->wrapped == Py_None) {
+        Py_INCREF(psyco_null);
+        return psyco_null;
+    }
+
+    /* if we got a plain string or a buffer we escape it and save the buffer */
+    if (0 > binary_buffer_get(self->wrapped, &b)) {
+        return NULL;
+    }
+
+    rv = binary_quote_buffer(b.buf, b.len, (connectionObject *)self->conn);
 
+    binary_buffer_release(&b);
     return rv;
 }
 
@@ -26,6 +26,8 @@
 #ifndef PSYCOPG_BINARY_H
 #define PSYCOPG_BINARY_H 1
 
+#include "psycopg/connection.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +42,26 @@ typedef struct {
     PyObject *conn;
 } binaryObject;
 
+#define HAS_BUFFER (PY_MAJOR_VERSION < 3)
+#define HAS_MEMORYVIEW (PY_MAJOR_VERSION > 2 || PY_MINOR_VERSION >= 6)
+
+/* the content of a bytes-like object, see binary_buffer_get() */
+typedef struct {
+    const char *buf;
+    Py_ssize_t len;
+#if HAS_MEMORYVIEW
+    Py_buffer view;
+    int got_view;
+#endif
+} binarybuf;
+
+RAISES_NEG HIDDEN int binary_buffer_get(PyObject *obj, binarybuf *b);
+HIDDEN void binary_buffer_release(binarybuf *b);
+
+/* build the bytea literal of a buffer: conn may be NULL */
+HIDDEN PyObject *binary_quote_buffer(const char *buffer, Py_ssize_t len,
+                                     connectionObject *conn);
+
 /* functions exported to psycopgmodule.c */
 
 HIDDEN PyObject *psyco_Binary(PyObject *module, PyObject *args);
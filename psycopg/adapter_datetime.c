@@ -54,8 +54,114 @@ psyco_adapter_datetime_init(void)
 
 /* datetime_str, datetime_getquoted - return result of quoting */
 
+/* the longest literal: '9999-12-31T23:59:59.999999+23:59:59.999999'::timestamptz */
+#define PYDATETIME_MAXLEN 64
+
+/* write `n` as a number of `digits` digits, zero padded */
+static char *
+_pydatetime_write_int(char *p, int n, int digits)
+{
+    int i;
+
+    for (i = digits - 1; i >= 0; i--) {
+        p[i] = '0' + n % 10;
+        n /= 10;
+    }
+    return p + digits;
+}
+
+static char *
+_pydatetime_write_date(char *p, int year, int month, int day)
+{
+    p = _pydatetime_write_int(p, year, 4);
+    *p++ = '-';
+    p = _pydatetime_write_int(p, month, 2);
+    *p++ = '-';
+    return _pydatetime_write_int(p, day, 2);
+}
+
+/* write the time as isoformat() does: the microseconds only if not zero */
+static char *
+_pydatetime_write_time(char *p, int hour, int minute, int second, int us)
+{
+    p = _pydatetime_write_int(p, hour, 2);
+    *p++ = ':';
+    p = _pydatetime_write_int(p, minute, 2);
+    *p++ = ':';
+    p = _pydatetime_write_int(p, second, 2);
+    if (us) {
+        *p++ = '.';
+        p = _pydatetime_write_int(p, us, 6);
+    }
+    return p;
+}
+
+/* write the utcoffset() of a time or datetime as isoformat() does
+ *
+ * Nothing is written if the object has no offset. Return the pointer past
+ * the offset written, NULL on error.
+ */
+static char *
+_pydatetime_write_offset(char *p, PyObject *obj)
+{
+    PyObject *offset;
+    PyDateTime_Delta *d;
+    PY_LONG_LONG us;
+    int hh, mm, ss;
+
+    if (!(offset = PyObject_CallMethod(obj, "utcoffset", NULL))) {
+        return NULL;
+    }
+    if (offset == Py_None) {
+        Py_DECREF(offset);
+        return p;
+    }
+    if (!PyDelta_Check(offset)) {
+        PyErr_Format(PyExc_TypeError,
+            "utcoffset() returned %s, expected timedelta or None",
+            Py_TYPE(offset)->tp_name);
+        Py_DECREF(offset);
+        return NULL;
+    }
+
+    d = (PyDateTime_Delta *)offset;
+    us = ((PY_LONG_LONG)d->days * 86400 + d->seconds) * 1000000
+        + d->microseconds;
+    Py_DECREF(offset);
+
+    if (us < 0) {
+        *p++ = '-';
+        us = -us;
+    }
+    else {
+        *p++ = '+';
+    }
+
+    /* the offset is less than a day */
+    ss = (int)(us / 1000000);
+    us %= 1000000;
+    hh = ss / 3600;
+    mm = ss / 60 % 60;
+    ss %= 60;
+
+    p = _pydatetime_write_int(p, hh, 2);
+    *p++ = ':';
+    p = _pydatetime_write_int(p, mm, 2);
+    if (ss || us) {
+        *p++ = ':';
+        p = _pydatetime_write_int(p, ss, 2);
+    }
+    if (us) {
+        *p++ = '.';
+        p = _pydatetime_write_int(p, (int)us, 6);
+    }
+
+    return p;
+}
+
+/* quote the subclasses calling their isoformat(), which may be overridden */
 static PyObject *
-_pydatetime_string_date_time(pydatetimeObject *self)
+_pydatetime_string_iso(pydatetimeObject *self)
 {
     PyObject *rv = NULL;
     PyObject *iso = NULL;
@@ -93,23 +199,92 @@ error:
     return rv;
 }
 
+/* quote the builtin date, time and datetime writing the literal from the
+ * object fields */
 static PyObject *
-_pydatetime_string_delta(pydatetimeObject *self)
+_pydatetime_string_date_time(pydatetimeObject *self)
 {
-    PyDateTime_Delta *obj = (PyDateTime_Delta*)self->wrapped;
+    PyObject *obj = self->wrapped;
+    char buf[PYDATETIME_MAXLEN], *p = buf;
+    const char *cast;
 
-    char buffer[8];
-    int i;
-    int a = obj->microseconds;
+    *p++ = '\'';
+
+    switch (self->type) {
+    case PSYCO_DATETIME_TIME:
+        if (!PyTime_CheckExact(obj)) { return _pydatetime_string_iso(self); }
+        p = _pydatetime_write_time(p,
+            PyDateTime_TIME_GET_HOUR(obj),
+            PyDateTime_TIME_GET_MINUTE(obj),
+            PyDateTime_TIME_GET_SECOND(obj),
+            PyDateTime_TIME_GET_MICROSECOND(obj));
+        if (((_PyDateTime_BaseTZInfo *)obj)->hastzinfo) {
+            if (!(p = _pydatetime_write_offset(p, obj))) { return NULL; }
+        }
+        cast = "'::time";
+        break;
 
-    for (i=0; i < 6 ; i++) {
-        buffer[5-i] = '0' + (a % 10);
-        a /= 10;
+    case PSYCO_DATETIME_DATE:
+        if (!PyDate_CheckExact(obj)) { return _pydatetime_string_iso(self); }
+        p = _pydatetime_write_date(p,
+            PyDateTime_GET_YEAR(obj),
+            PyDateTime_GET_MONTH(obj),
+            PyDateTime_GET_DAY(obj));
+        cast = "'::date";
+        break;
+
+    default: /* PSYCO_DATETIME_TIMESTAMP */
+        if (!PyDateTime_CheckExact(obj)) {
+            return _pydatetime_string_iso(self);
+        }
+        p = _pydatetime_write_date(p,
+            PyDateTime_GET_YEAR(obj),
+            PyDateTime_GET_MONTH(obj),
+            PyDateTime_GET_DAY(obj));
+        *p++ = 'T';
+        p = _pydatetime_write_time(p,
+            PyDateTime_DATE_GET_HOUR(obj),
+            PyDateTime_DATE_GET_MINUTE(obj),
+            PyDateTime_DATE_GET_SECOND(obj),
+            PyDateTime_DATE_GET_MICROSECOND(obj));
+        if (((_PyDateTime_BaseTZInfo *)obj)->hastzinfo
+                && ((PyDateTime_DateTime *)obj)->tzinfo != Py_None) {
+            if (!(p = _pydatetime_write_offset(p, obj))) { return NULL; }
+            cast = "'::timestamptz";
+        }
+        else {
+            cast = "'::timestamp";
+        }
+        break;
     }
-    buffer[6] = '\0';
 
-    return Bytes_FromFormat("'%d days %d.%s seconds'::interval",
-                            obj->days, obj->seconds, buffer);
+    strcpy(p, cast);
+    p += strlen(cast);
+
+    return Bytes_FromStringAndSize(buf, p - buf);
+}
+
+static PyObject *
+_pydatetime_string_delta(pydatetimeObject *self)
+{
+    PyDateTime_Delta *obj = (PyDateTime_Delta*)self->wrapped;
+    char buf[PYDATETIME_MAXLEN], *p = buf;
+    int len;
+
+    /* '%d days %d.%06d seconds'::interval */
+    *p++ = '\'';
+    len = PyOS_snprintf(p, 16, "%d", obj->days);
+    p += len;
+    memcpy(p, " days ", 6);
+    p += 6;
+    len = PyOS_snprintf(p, 16, "%d", obj->seconds);
+    p += len;
+    *p++ = '.';
+    p = _pydatetime_write_int(p, obj->microseconds, 6);
+    memcpy(p, " seconds'::interval", 19);
+    p += 19;
+
+    return Bytes_FromStringAndSize(buf, p - buf);
 }
 
 static PyObject *
@@ -0,0 +1,356 @@
+/* adapter_hstore.c - adapt python dicts to hstore
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+#define PSYCOPG_MODULE
+#include "psycopg/psycopg.h"
+
+#include "psycopg/adapter_hstore.h"
+#include "psycopg/microprotocols.h"
+#include "psycopg/microprotocols_proto.h"
+
+#include <string.h>
+
+
+/* hstore_quote - adapt the dict keys and values and join them
+ *
+ * On PostgreSQL 9.0 and following the result is
+ * 'hstore(ARRAY[k1, k2], ARRAY[v1, v2])', on previous versions, missing the
+ * array constructor, '((k1 => v1)||(k2 => v2))'.
+ */
+
+static PyObject *
+hstore_quote(hstoreObject *self)
+{
+    PyObject *keys = NULL, *values = NULL, *quoted = NULL;
+    PyObject *item, *res = NULL;
+    connectionObject *conn = (connectionObject *)self->connection;
+    Py_ssize_t n, i, size;
+    char *p;
+    int arrays = !(conn && conn->server_version < 90000);
+
+    n = PyDict_Size(self->wrapped);
+    if (n == 0) { return Bytes_FromString("''::hstore"); }
+
+    /* the adapters may run any code: work on a snapshot of the dict */
+    if (!(keys = PyDict_Keys(self->wrapped))) { goto exit; }
+    if (!(values = PyDict_Values(self->wrapped))) { goto exit; }
+    n = PyList_GET_SIZE(keys);
+
+    /* the quoted keys in the first half of the tuple, the values after */
+    if (!(quoted = PyTuple_New(2 * n))) { goto exit; }
+
+    for (i = 0; i < n; i++) {
+        if (!(item = microprotocol_getquoted(
+                PyList_GET_ITEM(keys, i), conn))) {
+            goto exit;
+        }
+        PyTuple_SET_ITEM(quoted, i, item);
+
+        item = PyList_GET_ITEM(values, i);
+        if (item == Py_None) {
+            Py_INCREF(psyco_null);
+            item = psyco_null;
+        }
+        else if (!(item = microprotocol_getquoted(item, conn))) {
+            goto exit;
+        }
+        PyTuple_SET_ITEM(quoted, n + i, item);
+    }
+
+    size = 0;
+    for (i = 0; i < 2 * n; i++) {
+        item = PyTuple_GET_ITEM(quoted, i);
+        if (!Bytes_Check(item)) {
+            PyErr_Format(PyExc_TypeError,
+                "hstore items must be adapted to bytes, got %s",
+                Py_TYPE(item)->tp_name);
+            goto exit;
+        }
+        size += Bytes_GET_SIZE(item);
+    }
+
+    /* compute the size of the result, then fill it */
+    if (arrays) {
+        /* hstore(ARRAY[, ], ARRAY[, ]) */
+        size += 13 + 9 + 2 + 4 * (n - 1);
+    }
+    else {
+        /* ((k => v)||(k => v)) */
+        size += 2 + 6 * n + 2 * (n - 1);
+    }
+
+    if (!(res = Bytes_FromStringAndSize(NULL, size))) { goto exit; }
+    p = Bytes_AS_STRING(res);
+
+#define HSTORE_APPEND(s, l) do { memcpy(p, s, l); p += l; } while (0)
+#define HSTORE_APPEND_ITEM(i) do { \
+    item = PyTuple_GET_ITEM(quoted, i); \
+    HSTORE_APPEND(Bytes_AS_STRING(item), Bytes_GET_SIZE(item)); \
+} while (0)
+
+    if (arrays) {
+        HSTORE_APPEND("hstore(ARRAY[", 13);
+        for (i = 0; i < n; i++) {
+            if (i) { HSTORE_APPEND(", ", 2); }
+            HSTORE_APPEND_ITEM(i);
+        }
+        HSTORE_APPEND("], ARRAY[", 9);
+        for (i = 0; i < n; i++) {
+            if (i) { HSTORE_APPEND(", ", 2); }
+            HSTORE_APPEND_ITEM(n + i);
+        }
+        HSTORE_APPEND("])", 2);
+    }
+    else {
+        HSTORE_APPEND("(", 1);
+        for (i = 0; i < n; i++) {
+            if (i) { HSTORE_APPEND("||", 2); }
+            HSTORE_APPEND("(", 1);
+            HSTORE_APPEND_ITEM(i);
+            HSTORE_APPEND(" => ", 4);
+            HSTORE_APPEND_ITEM(n + i);
+            HSTORE_APPEND(")", 1);
+        }
+        HSTORE_APPEND(")", 1);
+    }
+
+#undef HSTORE_APPEND_ITEM
+#undef HSTORE_APPEND
+
+exit:
+    Py_XDECREF(keys);
+    Py_XDECREF(values);
+    Py_XDECREF(quoted);
+    return res;
+}
+
+static PyObject *
+hstore_str(hstoreObject *self)
+{
+    return psycopg_ensure_text(hstore_quote(self));
+}
+
+static PyObject *
+hstore_getquoted(hstoreObject *self, PyObject *args)
+{
+    return hstore_quote(self);
+}
+
+static PyObject *
+hstore_prepare(hstoreObject *self, PyObject *args)
+{
+    PyObject *conn;
+
+    if (!PyArg_ParseTuple(args, "O!", &connectionType, &conn))
+        return NULL;
+
+    Py_CLEAR(self->connection);
+    Py_INCREF(conn);
+    self->connection = conn;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *
+hstore_conform(hstoreObject *self, PyObject *args)
+{
+    PyObject *res, *proto;
+
+    if (!PyArg_ParseTuple(args, "O", &proto)) return NULL;
+
+    if (proto == (PyObject*)&isqlquoteType)
+        res = (PyObject*)self;
+    else
+        res = Py_None;
+
+    Py_INCREF(res);
+    return res;
+}
+
+/** the Hstore object **/
+
+/* object member list */
+
+static struct PyMemberDef hstoreObject_members[] = {
+    {"adapted", T_OBJECT, offsetof(hstoreObject, wrapped), READONLY},
+    {NULL}
+};
+
+/* object method table */
+
+static PyMethodDef hstoreObject_methods[] = {
+    {"getquoted", (PyCFunction)hstore_getquoted, METH_NOARGS,
+     "getquoted() -> wrapped object value as SQL hstore"},
+    {"prepare", (PyCFunction)hstore_prepare, METH_VARARGS,
+     "prepare(conn) -> prepare the items for the connection"},
+    {"__conform__", (PyCFunction)hstore_conform, METH_VARARGS, NULL},
+    {NULL}  /* Sentinel */
+};
+
+/* initialization and finalization methods */
+
+static int
+hstore_setup(hstoreObject *self, PyObject *obj)
+{
+    Dprintf("hstore_setup: init hstore object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+
+    if (!PyDict_Check(obj)) {
+        PyErr_SetString(PyExc_TypeError, "Hstore() argument must be a dict");
+        return -1;
+    }
+
+    self->connection = NULL;
+    Py_INCREF(obj);
+    self->wrapped = obj;
+
+    Dprintf("hstore_setup: good hstore object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+    return 0;
+}
+
+static int
+hstore_traverse(PyObject *obj, visitproc visit, void *arg)
+{
+    hstoreObject *self = (hstoreObject *)obj;
+
+    Py_VISIT(self->wrapped);
+    Py_VISIT(self->connection);
+    return 0;
+}
+
+static void
+hstore_dealloc(PyObject* obj)
+{
+    hstoreObject *self = (hstoreObject *)obj;
+
+    Py_CLEAR(self->wrapped);
+    Py_CLEAR(self->connection);
+
+    Dprintf("hstore_dealloc: deleted hstore object at %p, "
+            "refcnt = " FORMAT_CODE_PY_SSIZE_T, obj, Py_REFCNT(obj));
+
+    Py_TYPE(obj)->tp_free(obj);
+}
+
+static int
+hstore_init(PyObject *obj, PyObject *args, PyObject *kwds)
+{
+    PyObject *d;
+
+    if (!PyArg_ParseTuple(args, "O", &d))
+        return -1;
+
+    return hstore_setup((hstoreObject *)obj, d);
+}
+
+static PyObject *
+hstore_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    return type->tp_alloc(type, 0);
+}
+
+static void
+hstore_del(PyObject* self)
+{
+    PyObject_GC_Del(self);
+}
+
+static PyObject *
+hstore_repr(hstoreObject *self)
+{
+    return PyString_FromFormat(
+        "<psycopg2._psycopg.Hstore object at %p>", self);
+}
+
+/* object type */
+
+#define hstoreType_doc \
+"Hstore(dict) -> new dict to hstore adapter object"
+
+PyTypeObject hstoreType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "psycopg2._psycopg.Hstore",
+    sizeof(hstoreObject),
+    0,
+    hstore_dealloc, /*tp_dealloc*/
+    0,          /*tp_print*/
+    0,          /*tp_getattr*/
+    0,          /*tp_setattr*/
+
+    0,          /*tp_compare*/
+    (reprfunc)hstore_repr, /*tp_repr*/
+    0,          /*tp_as_number*/
+    0,          /*tp_as_sequence*/
+    0,          /*tp_as_mapping*/
+    0,          /*tp_hash */
+
+    0,          /*tp_call*/
+    (reprfunc)hstore_str, /*tp_str*/
+    0,          /*tp_getattro*/
+    0,          /*tp_setattro*/
+    0,          /*tp_as_buffer*/
+
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_HAVE_GC, /*tp_flags*/
+
+    hstoreType_doc, /*tp_doc*/
+
+    hstore_traverse, /*tp_traverse*/
+    0,          /*tp_clear*/
+
+    0,          /*tp_richcompare*/
+    0,          /*tp_weaklistoffset*/
+
+    0,          /*tp_iter*/
+    0,          /*tp_iternext*/
+
+    /* Attribute descriptor and subclassing stuff */
+
+    hstoreObject_methods, /*tp_methods*/
+    hstoreObject_members, /*tp_members*/
+    0,          /*tp_getset*/
+    0,          /*tp_base*/
+    0,          /*tp_dict*/
+
+    0,          /*tp_descr_get*/
+    0,          /*tp_descr_set*/
+    0,          /*tp_dictoffset*/
+
+    hstore_init, /*tp_init*/
+    0, /*tp_alloc  will be set to PyType_GenericAlloc in module init*/
+    hstore_new, /*tp_new*/
+    (freefunc)hstore_del, /*tp_free  Low-level free-memory routine */
+    0,          /*tp_is_gc For PyObject_IS_GC */
+    0,          /*tp_bases*/
+    0,          /*tp_mro method resolution order */
+    0,          /*tp_cache*/
+    0,          /*tp_subclasses*/
+    0           /*tp_weaklist*/
+};
@@ -0,0 +1,271 @@
+/* adapter_ipaddress.c - adapt python ipaddress objects
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+
+#define PSYCOPG_MODULE
+#include "psycopg/psycopg.h"
+
+#include "psycopg/adapter_ipaddress.h"
+#include "psycopg/microprotocols_proto.h"
+
+#include <string.h>
+
+
+/* ipaddress_quote - quote the string representation of the object
+ *
+ * Networks are cast to cidr, addresses and interfaces to inet, so that lists
+ * are adapted to arrays of the right type.
+ */
+
+static PyObject *
+ipaddress_quote(ipaddressObject *self)
+{
+    PyObject *types, *s = NULL, *b = NULL, *rv = NULL;
+    const char *cast = "::inet";
+    char *buf, *qbuf = NULL;
+    Py_ssize_t len, qlen;
+    int network;
+
+    if (!(types = psyco_GetIPAddressTypes())) { return NULL; }
+    if (-1 == (network = PyObject_IsInstance(self->wrapped,
+            PyTuple_GET_ITEM(types, 2)))) {
+        goto exit;
+    }
+    if (!network && -1 == (network = PyObject_IsInstance(self->wrapped,
+            PyTuple_GET_ITEM(types, 3)))) {
+        goto exit;
+    }
+    if (network) { cast = "::cidr"; }
+
+    if (!(s = PyObject_Str(self->wrapped))) { goto exit; }
+
+    if (PyUnicode_Check(s)) {
+        if (!(b = PyUnicode_AsASCIIString(s))) { goto exit; }
+    }
+    else {
+        Py_INCREF(s);
+        b = s;
+    }
+
+    /* escape into a buffer with room for the cast */
+    Bytes_AsStringAndSize(b, &buf, &len);
+    if (!(qbuf = PyMem_Malloc(len * 2 + 4 + 6))) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+    psycopg_escape_string(NULL, buf, len, qbuf, &qlen);
+    memcpy(qbuf + qlen, cast, 6);
+    rv = Bytes_FromStringAndSize(qbuf, qlen + 6);
+
+exit:
+    PyMem_Free(qbuf);
+    Py_DECREF(types);
+    Py_XDECREF(s);
+    Py_XDECREF(b);
+    return rv;
+}
+
+static PyObject *
+ipaddress_str(ipaddressObject *self)
+{
+    return psycopg_ensure_text(ipaddress_quote(self));
+}
+
+static PyObject *
+ipaddress_getquoted(ipaddressObject *self, PyObject *args)
+{
+    return ipaddress_quote(self);
+}
+
+static PyObject *
+ipaddress_conform(ipaddressObject *self, PyObject *args)
+{
+    PyObject *res, *proto;
+
+    if (!PyArg_ParseTuple(args, "O", &proto)) return NULL;
+
+    if (proto == (PyObject*)&isqlquoteType)
+        res = (PyObject*)self;
+    else
+        res = Py_None;
+
+    Py_INCREF(res);
+    return res;
+}
+
+/** the IPAddress object **/
+
+/* object member list */
+
+static struct PyMemberDef ipaddressObject_members[] = {
+    {"adapted", T_OBJECT, offsetof(ipaddressObject, wrapped), READONLY},
+    {NULL}
+};
+
+/* object method table */
+
+static PyMethodDef ipaddressObject_methods[] = {
+    {"getquoted", (PyCFunction)ipaddress_getquoted, METH_NOARGS,
+     "getquoted() -> wrapped object value as SQL string"},
+    {"__conform__", (PyCFunction)ipaddress_conform, METH_VARARGS, NULL},
+    {NULL}  /* Sentinel */
+};
+
+/* initialization and finalization methods */
+
+static int
+ipaddress_setup(ipaddressObject *self, PyObject *obj)
+{
+    Dprintf("ipaddress_setup: init ipaddress object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+
+    Py_INCREF(obj);
+    self->wrapped = obj;
+
+    Dprintf("ipaddress_setup: good ipaddress object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+    return 0;
+}
+
+static int
+ipaddress_traverse(PyObject *obj, visitproc visit, void *arg)
+{
+    ipaddressObject *self = (ipaddressObject *)obj;
+
+    Py_VISIT(self->wrapped);
+    return 0;
+}
+
+static void
+ipaddress_dealloc(PyObject* obj)
+{
+    ipaddressObject *self = (ipaddressObject *)obj;
+
+    Py_CLEAR(self->wrapped);
+
+    Dprintf("ipaddress_dealloc: deleted ipaddress object at %p, "
+            "refcnt = " FORMAT_CODE_PY_SSIZE_T, obj, Py_REFCNT(obj));
+
+    Py_TYPE(obj)->tp_free(obj);
+}
+
+static int
+ipaddress_init(PyObject *obj, PyObject *args, PyObject *kwds)
+{
+    PyObject *o;
+
+    if (!PyArg_ParseTuple(args, "O", &o))
+        return -1;
+
+    return ipaddress_setup((ipaddressObject *)obj, o);
+}
+
+static PyObject *
+ipaddress_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    return type->tp_alloc(type, 0);
+}
+
+static void
+ipaddress_del(PyObject* self)
+{
+    PyObject_GC_Del(self);
+}
+
+static PyObject *
+ipaddress_repr(ipaddressObject *self)
+{
+    return PyString_FromFormat(
+        "<psycopg2._psycopg.IPAddress object at %p>", self);
+}
+
+/* object type */
+
+#define ipaddressType_doc \
+"IPAddress(obj) -> new ipaddress object adapter"
+
+PyTypeObject ipaddressType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "psycopg2._psycopg.IPAddress",
+    sizeof(ipaddressObject),
+    0,
+    ipaddress_dealloc, /*tp_dealloc*/
+    0,          /*tp_print*/
+    0,          /*tp_getattr*/
+    0,          /*tp_setattr*/
+
+    0,          /*tp_compare*/
+    (reprfunc)ipaddress_repr, /*tp_repr*/
+    0,          /*tp_as_number*/
+    0,          /*tp_as_sequence*/
+    0,          /*tp_as_mapping*/
+    0,          /*tp_hash */
+
+    0,          /*tp_call*/
+    (reprfunc)ipaddress_str, /*tp_str*/
+    0,          /*tp_getattro*/
+    0,          /*tp_setattro*/
+    0,          /*tp_as_buffer*/
+
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_HAVE_GC, /*tp_flags*/
+
+    ipaddressType_doc, /*tp_doc*/
+
+    ipaddress_traverse, /*tp_traverse*/
+    0,          /*tp_clear*/
+
+    0,          /*tp_richcompare*/
+    0,          /*tp_weaklistoffset*/
+
+    0,          /*tp_iter*/
+    0,          /*tp_iternext*/
+
+    /* Attribute descriptor and subclassing stuff */
+
+    ipaddressObject_methods, /*tp_methods*/
+    ipaddressObject_members, /*tp_members*/
+    0,          /*tp_getset*/
+    0,          /*tp_base*/
+    0,          /*tp_dict*/
+
+    0,          /*tp_descr_get*/
+    0,          /*tp_descr_set*/
+    0,          /*tp_dictoffset*/
+
+    ipaddress_init,  /*tp_init*/
+    0, /*tp_alloc  will be set to PyType_GenericAlloc in module init*/
+    ipaddress_new,   /*tp_new*/
+    (freefunc)ipaddress_del, /*tp_free  Low-level free-memory routine */
+    0,          /*tp_is_gc For PyObject_IS_GC */
+    0,          /*tp_bases*/
+    0,          /*tp_mro method resolution order */
+    0,          /*tp_cache*/
+    0,          /*tp_subclasses*/
+    0           /*tp_weaklist*/
+};
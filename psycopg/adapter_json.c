@@ -0,0 +1,317 @@
+/* adapter_json.c - adapt python objects to json
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+
+#define PSYCOPG_MODULE
+#include "psycopg/psycopg.h"
+
+#include "psycopg/connection.h"
+#include "psycopg/adapter_json.h"
+#include "psycopg/microprotocols_proto.h"
+
+#include <string.h>
+
+
+/* json_dumps - serialize an object using the adapter dumps function */
+
+static PyObject *
+json_dumps(jsonObject *self, PyObject *obj)
+{
+    PyObject *dumps, *rv;
+
+    if (self->dumps) {
+        return PyObject_CallFunctionObjArgs(self->dumps, obj, NULL);
+    }
+
+    if (!(dumps = psyco_GetJsonDumps())) { return NULL; }
+    rv = PyObject_CallFunctionObjArgs(dumps, obj, NULL);
+    Py_DECREF(dumps);
+    return rv;
+}
+
+/* json_quote - serialize the wrapped object and quote it as a string */
+
+static PyObject *
+json_quote(jsonObject *self)
+{
+    PyObject *s = NULL, *b = NULL, *rv = NULL;
+    connectionObject *conn = (connectionObject *)self->connection;
+    char *buf, *qbuf;
+    Py_ssize_t len, qlen;
+
+    /* look up the dumps() method only if a subclass may have overridden it */
+    if (Py_TYPE(self) == &jsonType) {
+        s = json_dumps(self, self->wrapped);
+    }
+    else {
+        s = PyObject_CallMethod((PyObject *)self, "dumps", "(O)",
+            self->wrapped);
+    }
+    if (!s) { goto exit; }
+
+    if (PyUnicode_Check(s)) {
+        if (!(b = conn_encode(conn, s))) {
+            goto exit;
+        }
+    }
+    else if (Bytes_Check(s)) {
+        Py_INCREF(s);
+        b = s;
+    }
+    else {
+        PyErr_Format(PyExc_TypeError,
+            "dumps() must return a string, got %s", Py_TYPE(s)->tp_name);
+        goto exit;
+    }
+
+    Bytes_AsStringAndSize(b, &buf, &len);
+    if (!(qbuf = psycopg_escape_string((PyObject *)conn, buf, len,
+            NULL, &qlen))) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+    rv = Bytes_FromStringAndSize(qbuf, qlen);
+    PyMem_Free(qbuf);
+
+exit:
+    Py_XDECREF(s);
+    Py_XDECREF(b);
+    return rv;
+}
+
+static PyObject *
+json_str(jsonObject *self)
+{
+    return psycopg_ensure_text(json_quote(self));
+}
+
+static PyObject *
+json_getquoted(jsonObject *self, PyObject *args)
+{
+    return json_quote(self);
+}
+
+static PyObject *
+json_prepare(jsonObject *self, PyObject *args)
+{
+    PyObject *conn;
+
+    if (!PyArg_ParseTuple(args, "O!", &connectionType, &conn))
+        return NULL;
+
+    Py_CLEAR(self->connection);
+    Py_INCREF(conn);
+    self->connection = conn;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *
+json_conform(jsonObject *self, PyObject *args)
+{
+    PyObject *res, *proto;
+
+    if (!PyArg_ParseTuple(args, "O", &proto)) return NULL;
+
+    if (proto == (PyObject*)&isqlquoteType)
+        res = (PyObject*)self;
+    else
+        res = Py_None;
+
+    Py_INCREF(res);
+    return res;
+}
+
+/** the Json object **/
+
+/* object member list */
+
+static struct PyMemberDef jsonObject_members[] = {
+    {"adapted", T_OBJECT, offsetof(jsonObject, wrapped), READONLY},
+    {NULL}
+};
+
+/* object method table */
+
+static PyMethodDef jsonObject_methods[] = {
+    {"getquoted", (PyCFunction)json_getquoted, METH_NOARGS,
+     "getquoted() -> wrapped object value as SQL json"},
+    {"dumps", (PyCFunction)json_dumps, METH_O,
+     "dumps(obj) -> serialize obj to a json string"},
+    {"prepare", (PyCFunction)json_prepare, METH_VARARGS,
+     "prepare(conn) -> prepare the object for the connection"},
+    {"__conform__", (PyCFunction)json_conform, METH_VARARGS, NULL},
+    {NULL}  /* Sentinel */
+};
+
+/* initialization and finalization methods */
+
+static int
+json_setup(jsonObject *self, PyObject *obj, PyObject *dumps)
+{
+    Dprintf("json_setup: init json object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+
+    self->connection = NULL;
+    Py_INCREF(obj);
+    self->wrapped = obj;
+
+    if (dumps && dumps != Py_None) {
+        Py_INCREF(dumps);
+        self->dumps = dumps;
+    }
+
+    Dprintf("json_setup: good json object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+    return 0;
+}
+
+static int
+json_traverse(PyObject *obj, visitproc visit, void *arg)
+{
+    jsonObject *self = (jsonObject *)obj;
+
+    Py_VISIT(self->wrapped);
+    Py_VISIT(self->dumps);
+    Py_VISIT(self->connection);
+    return 0;
+}
+
+static void
+json_dealloc(PyObject* obj)
+{
+    jsonObject *self = (jsonObject *)obj;
+
+    Py_CLEAR(self->wrapped);
+    Py_CLEAR(self->dumps);
+    Py_CLEAR(self->connection);
+
+    Dprintf("json_dealloc: deleted json object at %p, "
+            "refcnt = " FORMAT_CODE_PY_SSIZE_T, obj, Py_REFCNT(obj));
+
+    Py_TYPE(obj)->tp_free(obj);
+}
+
+static int
+json_init(PyObject *obj, PyObject *args, PyObject *kwds)
+{
+    PyObject *o, *dumps = NULL;
+
+    static char *kwlist[] = {"adapted", "dumps", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O", kwlist, &o, &dumps))
+        return -1;
+
+    return json_setup((jsonObject *)obj, o, dumps);
+}
+
+static PyObject *
+json_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    return type->tp_alloc(type, 0);
+}
+
+static void
+json_del(PyObject* self)
+{
+    PyObject_GC_Del(self);
+}
+
+static PyObject *
+json_repr(jsonObject *self)
+{
+    return PyString_FromFormat(
+        "<psycopg2._psycopg.Json object at %p>", self);
+}
+
+/* object type */
+
+#define jsonType_doc \
+"Json(adapted, dumps=None) -> new json adapter object"
+
+PyTypeObject jsonType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "psycopg2._psycopg.Json",
+    sizeof(jsonObject),
+    0,
+    json_dealloc, /*tp_dealloc*/
+    0,          /*tp_print*/
+    0,          /*tp_getattr*/
+    0,          /*tp_setattr*/
+
+    0,          /*tp_compare*/
+    (reprfunc)json_repr, /*tp_repr*/
+    0,          /*tp_as_number*/
+    0,          /*tp_as_sequence*/
+    0,          /*tp_as_mapping*/
+    0,          /*tp_hash */
+
+    0,          /*tp_call*/
+    (reprfunc)json_str, /*tp_str*/
+    0,          /*tp_getattro*/
+    0,          /*tp_setattro*/
+    0,          /*tp_as_buffer*/
+
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_HAVE_GC, /*tp_flags*/
+
+    jsonType_doc, /*tp_doc*/
+
+    json_traverse, /*tp_traverse*/
+    0,          /*tp_clear*/
+
+    0,          /*tp_richcompare*/
+    0,          /*tp_weaklistoffset*/
+
+    0,          /*tp_iter*/
+    0,          /*tp_iternext*/
+
+    /* Attribute descriptor and subclassing stuff */
+
+    jsonObject_methods, /*tp_methods*/
+    jsonObject_members, /*tp_members*/
+    0,          /*tp_getset*/
+    0,          /*tp_base*/
+    0,          /*tp_dict*/
+
+    0,          /*tp_descr_get*/
+    0,          /*tp_descr_set*/
+    0,          /*tp_dictoffset*/
+
+    json_init,  /*tp_init*/
+    0, /*tp_alloc  will be set to PyType_GenericAlloc in module init*/
+    json_new,   /*tp_new*/
+    (freefunc)json_del, /*tp_free  Low-level free-memory routine */
+    0,          /*tp_is_gc For PyObject_IS_GC */
+    0,          /*tp_bases*/
+    0,          /*tp_mro method resolution order */
+    0,          /*tp_cache*/
+    0,          /*tp_subclasses*/
+    0           /*tp_weaklist*/
+};
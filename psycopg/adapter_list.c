@@ -27,60 +27,408 @@
 #include "psycopg/psycopg.h"
 
 #include "psycopg/adapter_list.h"
+#include "psycopg/adapter_pint.h"
+#include "psycopg/adapter_pfloat.h"
+#include "psycopg/adapter_qstring.h"
+#include "psycopg/adapter_uuid.h"
 #include "psycopg/microprotocols.h"
 #include "psycopg/microprotocols_proto.h"
 
+#include <math.h>
+#include <string.h>
 
-/* list_str, list_getquoted - return result of quoting */
 
+/* The lists whose items are all ints, floats, strings or uuids (or None)
+ * adapted by the default adapters are quoted as a typed array literal
+ * '{...}'::type[], built in a single buffer. The type is the one
+ * PostgreSQL would choose for the ARRAY[...] of the items quoted, which is
+ * used for all the other lists. */
+
+#define LIST_KIND_MIXED 0
+#define LIST_KIND_INT 1
+#define LIST_KIND_FLOAT 2
+#define LIST_KIND_STRING 3
+#define LIST_KIND_UUID 4
+
+/* the longest representations of a long long, a float repr() and a uuid */
+#define LIST_INT_MAXLEN PINT_LONG_MAXLEN
+#define LIST_FLOAT_MAXLEN 32
+#define LIST_UUID_MAXLEN 36
+
+/* Return the kind of the list item, setting `adapter` to the default adapter
+ * for it. Return -1 on error. */
+static int
+list_item_kind(PyObject *item, connectionObject *conn,
+               PyTypeObject **adapter)
+{
+    PyTypeObject *type = Py_TYPE(item);
+    PyObject *uuid;
+
+#if PY_MAJOR_VERSION < 3
+    if (type == &PyInt_Type) { *adapter = &pintType; return LIST_KIND_INT; }
+    if (type == &PyString_Type) {
+        *adapter = &qstringType;
+        return LIST_KIND_STRING;
+    }
+#endif
+    if (type == &PyLong_Type) { *adapter = &pintType; return LIST_KIND_INT; }
+    if (type == &PyFloat_Type) {
+        *adapter = &pfloatType;
+        return LIST_KIND_FLOAT;
+    }
+    /* unicode needs the connection encoding */
+    if (type == &PyUnicode_Type) {
+        *adapter = &qstringType;
+        return conn ? LIST_KIND_STRING : LIST_KIND_MIXED;
+    }
+
+    /* a uuid can only be there if the module was imported */
+    if (!PyDict_GetItemString(PyImport_GetModuleDict(), "uuid")) {
+        return LIST_KIND_MIXED;
+    }
+    if (!(uuid = psyco_GetUUIDType())) { return -1; }
+    Py_DECREF(uuid);
+    if (type == (PyTypeObject *)uuid) {
+        *adapter = &uuidType;
+        return LIST_KIND_UUID;
+    }
+
+    return LIST_KIND_MIXED;
+}
+
+/* Return the kind of list if all the items are of the same kind and adapted
+ * by the default adapters, else LIST_KIND_MIXED. Return -1 on error. */
+static int
+list_kind(PyObject *items, connectionObject *conn)
+{
+    PyTypeObject *seen = NULL, *adapter;
+    PyObject *item;
+    Py_ssize_t i;
+    int kind = LIST_KIND_MIXED, ikind;
+
+    for (i = 0; i < PyTuple_GET_SIZE(items); i++) {
+        item = PyTuple_GET_ITEM(items, i);
+        if (item == Py_None || Py_TYPE(item) == seen) { continue; }
+
+        if (0 > (ikind = list_item_kind(item, conn, &adapter))) { return -1; }
+        if (ikind == LIST_KIND_MIXED || (kind && ikind != kind)) {
+            return LIST_KIND_MIXED;
+        }
+        switch (microprotocols_has_adapter(item, adapter)) {
+        case 1:
+            break;
+        case 0:
+            return LIST_KIND_MIXED;
+        default:
+            return -1;
+        }
+
+        kind = ikind;
+        seen = Py_TYPE(item);
+    }
+
+    return kind;
+}
+
+/* Quote a list of ints, floats or uuids. The items have a bounded length
+ * and don't need escaping: write the literal in a string long enough, then
+ * shrink it. Return Py_NotImplemented if an int doesn't fit in a bigint. */
 static PyObject *
-list_quote(listObject *self)
+list_quote_numbers(PyObject *items, int kind)
 {
-    /*  adapt the list by calling adapt() recursively and then wrapping
-        everything into "ARRAY[]" */
-    PyObject *tmp = NULL, *str = NULL, *joined = NULL, *res = NULL;
-    Py_ssize_t i, len;
+    PyObject *rv = NULL, *item;
+    Py_ssize_t n = PyTuple_GET_SIZE(items), i, maxlen, len;
+    PY_LONG_LONG val;
+    int overflow, int8 = 0, finite = 1;
+    const char *type;
+    char *p, *s;
+
+    switch (kind) {
+    case LIST_KIND_INT:
+        maxlen = LIST_INT_MAXLEN;
+        break;
+    case LIST_KIND_FLOAT:
+        maxlen = LIST_FLOAT_MAXLEN;
+        break;
+    default:
+        maxlen = LIST_UUID_MAXLEN;
+        break;
+    }
 
-    len = PyList_GET_SIZE(self->wrapped);
+    /* '{item,item}'::numeric[] */
+    if (!(rv = Bytes_FromStringAndSize(NULL, n * (maxlen + 1) + 16))) {
+        return NULL;
+    }
+    p = Bytes_AS_STRING(rv);
+    *p++ = '\'';
+    *p++ = '{';
+
+    for (i = 0; i < n; i++) {
+        if (i) { *p++ = ','; }
+        item = PyTuple_GET_ITEM(items, i);
+        if (item == Py_None) {
+            memcpy(p, "NULL", 4);
+            p += 4;
+            continue;
+        }
 
-    /* empty arrays are converted to NULLs (still searching for a way to
-       insert an empty array in postgresql */
-    if (len == 0) return Bytes_FromString("'{}'");
+        switch (kind) {
+        case LIST_KIND_INT:
+#if PY_MAJOR_VERSION < 3
+            if (PyInt_CheckExact(item)) {
+                val = PyInt_AS_LONG(item);
+            }
+            else
+#endif
+            {
+                val = PyLong_AsLongLongAndOverflow(item, &overflow);
+                if (overflow) {
+                    /* it would be a numeric: let ARRAY[] deal with it */
+                    Py_DECREF(rv);
+                    Py_INCREF(Py_NotImplemented);
+                    return Py_NotImplemented;
+                }
+                if (val == -1 && PyErr_Occurred()) { goto error; }
+            }
+            if (val < -2147483647L - 1 || val > 2147483647L) { int8 = 1; }
+            p = pint_write_long(p, val);
+            break;
+
+        case LIST_KIND_FLOAT:
+        {
+            double d = PyFloat_AS_DOUBLE(item);
+            if (isnan(d)) {
+                memcpy(p, "NaN", 3);
+                p += 3;
+                finite = 0;
+            }
+            else if (isinf(d)) {
+                if (d < 0) { *p++ = '-'; }
+                memcpy(p, "Infinity", 8);
+                p += 8;
+                finite = 0;
+            }
+            else {
+                /* the same of repr(), which is used for the single floats */
+                if (!(s = PyOS_double_to_string(
+                        d, 'r', 0, Py_DTSF_ADD_DOT_0, NULL))) {
+                    goto error;
+                }
+                len = strlen(s);
+                memcpy(p, s, len);
+                p += len;
+                PyMem_Free(s);
+            }
+            break;
+        }
 
-    tmp = PyTuple_New(len);
+        default:
+            if (0 > uuid_format(item, p)) { goto error; }
+            p += LIST_UUID_MAXLEN;
+            break;
+        }
+    }
 
-    for (i=0; i<len; i++) {
-        PyObject *quoted;
-        PyObject *wrapped = PyList_GET_ITEM(self->wrapped, i);
-        if (wrapped == Py_None) {
-            Py_INCREF(psyco_null);
-            quoted = psyco_null;
+    switch (kind) {
+    case LIST_KIND_INT:
+        type = int8 ? "}'::int8[]" : "}'::int4[]";
+        break;
+    case LIST_KIND_FLOAT:
+        /* numbers with a dot are numeric, 'NaN'::float isn't */
+        type = finite ? "}'::numeric[]" : "}'::float8[]";
+        break;
+    default:
+        type = "}'::uuid[]";
+        break;
+    }
+    memcpy(p, type, strlen(type));
+    p += strlen(type);
+
+    if (0 > _Bytes_Resize(&rv, p - Bytes_AS_STRING(rv))) { return NULL; }
+    return rv;
+
+error:
+    Py_DECREF(rv);
+    return NULL;
+}
+
+/* Quote a list of strings as '{"item","item"}'::text[], escaping the items
+ * for the array syntax and then the whole literal for the connection.
+ * Return Py_NotImplemented if a string contains a NUL, or if the client
+ * encoding may hide a backslash in a multibyte char (SJIS, BIG5...). */
+static PyObject *
+list_quote_strings(PyObject *items, connectionObject *conn)
+{
+    PyObject *strs = NULL, *item, *rv = NULL;
+    Py_ssize_t n = PyTuple_GET_SIZE(items), i, j, len, size;
+    char *lit = NULL, *p, *s;
+    static const char type[] = "::text[]";
+
+    if (!psycopg_ascii_safe((PyObject *)conn)) {
+        Py_INCREF(Py_NotImplemented);
+        return Py_NotImplemented;
+    }
+
+    /* the items as bytes in the connection encoding */
+    if (!(strs = PyTuple_New(n))) { goto exit; }
+    size = 2;
+    for (i = 0; i < n; i++) {
+        item = PyTuple_GET_ITEM(items, i);
+        if (PyUnicode_CheckExact(item)) {
+            if (!(item = conn_encode(conn, item))) { goto exit; }
         }
         else {
-            quoted = microprotocol_getquoted(wrapped,
-                                       (connectionObject*)self->connection);
-            if (quoted == NULL) goto error;
+            Py_INCREF(item);
         }
+        PyTuple_SET_ITEM(strs, i, item);
 
-        /* here we don't loose a refcnt: SET_ITEM does not change the
-           reference count and we are just transferring ownership of the tmp
-           object to the tuple */
-        PyTuple_SET_ITEM(tmp, i, quoted);
+        if (item == Py_None) {
+            size += 5;
+            continue;
+        }
+        len = Bytes_GET_SIZE(item);
+        if (memchr(Bytes_AS_STRING(item), '\0', len)) {
+            Py_INCREF(Py_NotImplemented);
+            rv = Py_NotImplemented;
+            goto exit;
+        }
+        /* "item", with quotes and backslashes escaped */
+        size += 2 * len + 3;
     }
 
-    /* now that we have a tuple of adapted objects we just need to join them
-       and put "ARRAY[] around the result */
-    str = Bytes_FromString(", ");
-    joined = PyObject_CallMethod(str, "join", "(O)", tmp);
-    if (joined == NULL) goto error;
+    if (!(lit = PyMem_Malloc(size))) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+    p = lit;
+    *p++ = '{';
+    for (i = 0; i < n; i++) {
+        if (i) { *p++ = ','; }
+        item = PyTuple_GET_ITEM(strs, i);
+        if (item == Py_None) {
+            memcpy(p, "NULL", 4);
+            p += 4;
+            continue;
+        }
+        s = Bytes_AS_STRING(item);
+        len = Bytes_GET_SIZE(item);
+        *p++ = '"';
+        for (j = 0; j < len; j++) {
+            if (s[j] == '"' || s[j] == '\\') { *p++ = '\\'; }
+            *p++ = s[j];
+        }
+        *p++ = '"';
+    }
+    *p++ = '}';
+    len = p - lit;
 
-    res = Bytes_FromFormat("ARRAY[%s]", Bytes_AsString(joined));
+    /* the literal quoted for the connection, then the type */
+    if (!(rv = Bytes_FromStringAndSize(NULL, 2 * len + 4 + sizeof(type)))) {
+        goto exit;
+    }
+    psycopg_escape_string((PyObject *)conn, lit, len,
+        Bytes_AS_STRING(rv), &size);
+    memcpy(Bytes_AS_STRING(rv) + size, type, sizeof(type) - 1);
+    if (0 > _Bytes_Resize(&rv, size + sizeof(type) - 1)) { goto exit; }
+
+exit:
+    PyMem_Free(lit);
+    Py_XDECREF(strs);
+    return rv;
+}
 
- error:
-    Py_XDECREF(tmp);
-    Py_XDECREF(str);
-    Py_XDECREF(joined);
-    return res;
+/* list_quote_items - quote a tuple of any objects as open + items separated
+ * by ", " + close, e.g. ARRAY[item, item] */
+
+PyObject *
+list_quote_items(PyObject *items, connectionObject *conn,
+                 const char *open, const char *close)
+{
+    PyObject *quoted = NULL, *item, *rv = NULL;
+    Py_ssize_t n = PyTuple_GET_SIZE(items), i, size;
+    size_t olen = strlen(open), clen = strlen(close);
+    char *p;
+
+    if (!(quoted = PyTuple_New(n))) { goto exit; }
+
+    size = olen + clen + (n ? 2 * (n - 1) : 0);
+    for (i = 0; i < n; i++) {
+        item = PyTuple_GET_ITEM(items, i);
+        if (item == Py_None) {
+            Py_INCREF(psyco_null);
+            item = psyco_null;
+        }
+        else if (!(item = microprotocol_getquoted(item, conn))) {
+            goto exit;
+        }
+        PyTuple_SET_ITEM(quoted, i, item);
+
+        if (!Bytes_Check(item)) {
+            PyErr_Format(PyExc_TypeError,
+                "items must be adapted to bytes, got %s",
+                Py_TYPE(item)->tp_name);
+            goto exit;
+        }
+        size += Bytes_GET_SIZE(item);
+    }
+
+    if (!(rv = Bytes_FromStringAndSize(NULL, size))) { goto exit; }
+    p = Bytes_AS_STRING(rv);
+    memcpy(p, open, olen);
+    p += olen;
+    for (i = 0; i < n; i++) {
+        if (i) {
+            memcpy(p, ", ", 2);
+            p += 2;
+        }
+        item = PyTuple_GET_ITEM(quoted, i);
+        memcpy(p, Bytes_AS_STRING(item), Bytes_GET_SIZE(item));
+        p += Bytes_GET_SIZE(item);
+    }
+    memcpy(p, close, clen);
+
+exit:
+    Py_XDECREF(quoted);
+    return rv;
+}
+
+/* list_str, list_getquoted - return result of quoting */
+
+static PyObject *
+list_quote(listObject *self)
+{
+    connectionObject *conn = (connectionObject *)self->connection;
+    PyObject *items, *rv = NULL;
+    int kind;
+
+    /* empty arrays are converted to NULLs (still searching for a way to
+       insert an empty array in postgresql */
+    if (PyList_GET_SIZE(self->wrapped) == 0) return Bytes_FromString("'{}'");
+
+    /* the adapters may run any code: work on a snapshot of the list */
+    if (!(items = PyList_AsTuple(self->wrapped))) { return NULL; }
+
+    if (0 > (kind = list_kind(items, conn))) { goto exit; }
+
+    switch (kind) {
+    case LIST_KIND_STRING:
+        rv = list_quote_strings(items, conn);
+        break;
+    case LIST_KIND_MIXED:
+        break;
+    default:
+        rv = list_quote_numbers(items, kind);
+        break;
+    }
+
+    if (kind == LIST_KIND_MIXED || rv == Py_NotImplemented) {
+        Py_XDECREF(rv);
+        rv = list_quote_items(items, conn, "ARRAY[", "]");
+    }
+
+exit:
+    Py_DECREF(items);
+    return rv;
 }
 
 static PyObject *
@@ -26,6 +26,8 @@
 #ifndef PSYCOPG_LIST_H
 #define PSYCOPG_LIST_H 1
 
+#include "psycopg/connection.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +42,9 @@ typedef struct {
     char     *encoding;
 } listObject;
 
+HIDDEN PyObject *list_quote_items(PyObject *items, connectionObject *conn,
+                                  const char *open, const char *close);
+
 HIDDEN PyObject *psyco_List(PyObject *module, PyObject *args);
 #define psyco_List_doc \
     "List(list, enc) -> new quoted list"
@@ -27,87 +27,157 @@
 #include "psycopg/psycopg.h"
 
 #include "psycopg/adapter_pdecimal.h"
+#include "psycopg/adapter_pint.h"
 #include "psycopg/microprotocols_proto.h"
 
-#include <floatobject.h>
-#include <math.h>
+#include <string.h>
 
 
 /** the Decimal object **/
 
+/* pdecimal_quote_digits - format a Decimal implemented in Python
+ *
+ * The Python decimal module stores the number in the fields _sign, _int
+ * (the digits as a string) and _exp: write the literal from them as
+ * Decimal.__str__() does. Return Py_NotImplemented if the fields are not
+ * usable.
+ */
 static PyObject *
-pdecimal_getquoted(pdecimalObject *self, PyObject *args)
+pdecimal_quote_digits(PyObject *obj)
 {
-    PyObject *check, *res = NULL;
-    check = PyObject_CallMethod(self->wrapped, "is_finite", NULL);
-    if (check == Py_True) {
-        if (!(res = PyObject_Str(self->wrapped))) {
-            goto end;
-        }
-        goto output;
+    PyObject *special = NULL, *sign = NULL, *digits = NULL, *exp = NULL;
+    PyObject *rv = NULL;
+    const char *d;
+    Py_ssize_t ndigits, leftdigits, dotplace;
+    long e;
+    int is_special, neg;
+    char *p;
+
+    if (!(special = PyObject_GetAttrString(obj, "_is_special"))) {
+        goto notimpl;
     }
-    else if (check) {
-        res = Bytes_FromString("'NaN'::numeric");
-        goto end;
+    if (0 > (is_special = PyObject_IsTrue(special))) { goto notimpl; }
+    if (is_special) {
+        rv = Bytes_FromString("'NaN'::numeric");
+        goto exit;
     }
 
-    /* is_finite() was introduced 2.5.1 < somewhere <= 2.5.4.
-     * We assume we are here because we didn't find the method. */
-    PyErr_Clear();
+    if (!(sign = PyObject_GetAttrString(obj, "_sign"))) { goto notimpl; }
+    if (!(exp = PyObject_GetAttrString(obj, "_exp"))) { goto notimpl; }
+    if (!(digits = psycopg_ensure_bytes(
+            PyObject_GetAttrString(obj, "_int")))) {
+        goto notimpl;
+    }
+
+    if (0 > (neg = PyObject_IsTrue(sign))) { goto notimpl; }
+    e = PyInt_AsLong(exp);
+    if (e == -1 && PyErr_Occurred()) { goto notimpl; }
+    d = Bytes_AS_STRING(digits);
+    ndigits = Bytes_GET_SIZE(digits);
+    if (ndigits == 0 || e < -1000000000L || e > 1000000000L) {
+        goto notimpl;
+    }
 
-    if (!(check = PyObject_CallMethod(self->wrapped, "_isnan", NULL))) {
-        goto end;
+    /* the position of the dot, as in Decimal.__str__() */
+    leftdigits = e + ndigits;
+    dotplace = (e <= 0 && leftdigits > -6) ? leftdigits : 1;
+
+    /* sign, 0. and up to 6 zeros, digits, exponent */
+    if (!(rv = Bytes_FromStringAndSize(NULL, 2 + 8 + ndigits
+            + (dotplace > ndigits ? dotplace - ndigits : 0)
+            + 2 + PINT_LONG_MAXLEN))) {
+        goto exit;
     }
-    if (PyObject_IsTrue(check)) {
-        res = Bytes_FromString("'NaN'::numeric");
-        goto end;
+    p = Bytes_AS_STRING(rv);
+
+    /* Prepend a space in front of negative numbers (ticket #57) */
+    if (neg) {
+        *p++ = ' ';
+        *p++ = '-';
     }
 
-    Py_DECREF(check);
-    if (!(check = PyObject_CallMethod(self->wrapped, "_isinfinity", NULL))) {
-        goto end;
+    if (dotplace <= 0) {
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -dotplace);
+        p += -dotplace;
+        memcpy(p, d, ndigits);
+        p += ndigits;
     }
-    if (PyObject_IsTrue(check)) {
-        res = Bytes_FromString("'NaN'::numeric");
-        goto end;
+    else if (dotplace >= ndigits) {
+        memcpy(p, d, ndigits);
+        p += ndigits;
+        memset(p, '0', dotplace - ndigits);
+        p += dotplace - ndigits;
     }
+    else {
+        memcpy(p, d, dotplace);
+        p += dotplace;
+        *p++ = '.';
+        memcpy(p, d + dotplace, ndigits - dotplace);
+        p += ndigits - dotplace;
+    }
+
+    if (leftdigits != dotplace) {
+        *p++ = 'E';
+        if (leftdigits > dotplace) { *p++ = '+'; }
+        p = pint_write_long(p, leftdigits - dotplace);
+    }
+
+    if (0 > _Bytes_Resize(&rv, p - Bytes_AS_STRING(rv))) { goto exit; }
+    goto exit;
+
+notimpl:
+    PyErr_Clear();
+    Py_INCREF(Py_NotImplemented);
+    rv = Py_NotImplemented;
+
+exit:
+    Py_XDECREF(special);
+    Py_XDECREF(sign);
+    Py_XDECREF(digits);
+    Py_XDECREF(exp);
+    return rv;
+}
+
+/* pdecimal_quote - return the literal of a Decimal
+ *
+ * The Python implementation of the builtin Decimal is formatted from its
+ * digits, the C implementation and the subclasses from their str(). The
+ * special values are the only ones containing letters other than E.
+ * PostgreSQL numeric has no infinity: they are converted to NaN too.
+ */
+PyObject *
+pdecimal_quote(PyObject *obj)
+{
+    PyObject *rv, *decimalType;
+    int pydecimal = 0;
 
-    /* wrapped is finite */
-    if (!(res = PyObject_Str(self->wrapped))) {
-        goto end;
+    if (PyType_HasFeature(Py_TYPE(obj), Py_TPFLAGS_HEAPTYPE)) {
+        decimalType = psyco_GetDecimalType();
+        pydecimal = ((PyObject *)Py_TYPE(obj) == decimalType);
+        Py_XDECREF(decimalType);
     }
 
-    /* res may be unicode and may suffer for issue #57 */
-output:
-
-#if PY_MAJOR_VERSION > 2
-    /* unicode to bytes in Py3 */
-    {
-        PyObject *tmp = PyUnicode_AsUTF8String(res);
-        Py_DECREF(res);
-        if (!(res = tmp)) {
-            goto end;
-        }
+    if (pydecimal) {
+        if (!(rv = pdecimal_quote_digits(obj))) { return NULL; }
+        if (rv != Py_NotImplemented) { return rv; }
+        Py_DECREF(rv);
     }
-#endif
-
-    if ('-' == Bytes_AS_STRING(res)[0]) {
-        /* Prepend a space in front of negative numbers (ticket #57) */
-        PyObject *tmp;
-        if (!(tmp = Bytes_FromString(" "))) {
-            Py_DECREF(res);
-            res = NULL;
-            goto end;
-        }
-        Bytes_ConcatAndDel(&tmp, res);
-        if (!(res = tmp)) {
-            goto end;
-        }
+
+    if (!(rv = psycopg_quote_number(PyObject_Str(obj)))) { return NULL; }
+    if (strpbrk(Bytes_AS_STRING(rv), "nNI")) {
+        Py_DECREF(rv);
+        rv = Bytes_FromString("'NaN'::numeric");
     }
 
-end:
-    Py_XDECREF(check);
-    return res;
+    return rv;
+}
+
+static PyObject *
+pdecimal_getquoted(pdecimalObject *self, PyObject *args)
+{
+    return pdecimal_quote(self->wrapped);
 }
 
 static PyObject *
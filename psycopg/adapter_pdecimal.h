@@ -40,6 +40,8 @@ typedef struct {
 
 } pdecimalObject;
 
+HIDDEN PyObject *pdecimal_quote(PyObject *obj);
+
 /* functions exported to psycopgmodule.c */
 
 HIDDEN PyObject *psyco_Decimal(PyObject *module, PyObject *args);
@@ -31,58 +31,62 @@
 
 #include <floatobject.h>
 #include <math.h>
+#include <string.h>
 
 
 /** the Float object **/
 
-static PyObject *
-pfloat_getquoted(pfloatObject *self, PyObject *args)
+/* pfloat_quote - return the literal of a float
+ *
+ * The floats are written with the shortest repr() that round-trips: the
+ * builtin ones in C, the subclasses, which may customize it, calling it.
+ */
+PyObject *
+pfloat_quote(PyObject *obj)
 {
     PyObject *rv;
-    double n = PyFloat_AsDouble(self->wrapped);
-    if (isnan(n))
-        rv = Bytes_FromString("'NaN'::float");
+    double n;
+    char *s;
+    Py_ssize_t len;
+    int neg;
+
+    n = PyFloat_AsDouble(obj);
+    if (n == -1.0 && PyErr_Occurred()) { return NULL; }
+
+    if (isnan(n)) {
+        return Bytes_FromString("'NaN'::float");
+    }
     else if (isinf(n)) {
-        if (n > 0)
-            rv = Bytes_FromString("'Infinity'::float");
-        else
-            rv = Bytes_FromString("'-Infinity'::float");
+        return Bytes_FromString(
+            n > 0 ? "'Infinity'::float" : "'-Infinity'::float");
     }
-    else {
-        if (!(rv = PyObject_Repr(self->wrapped))) {
-            goto exit;
-        }
-
-#if PY_MAJOR_VERSION > 2
-        /* unicode to bytes in Py3 */
-        {
-            PyObject *tmp = PyUnicode_AsUTF8String(rv);
-            Py_DECREF(rv);
-            if (!(rv = tmp)) {
-                goto exit;
-            }
-        }
-#endif
-
-        if ('-' == Bytes_AS_STRING(rv)[0]) {
-            /* Prepend a space in front of negative numbers (ticket #57) */
-            PyObject *tmp;
-            if (!(tmp = Bytes_FromString(" "))) {
-                Py_DECREF(rv);
-                rv = NULL;
-                goto exit;
-            }
-            Bytes_ConcatAndDel(&tmp, rv);
-            if (!(rv = tmp)) {
-                goto exit;
-            }
-        }
+
+    if (!PyFloat_CheckExact(obj)) {
+        return psycopg_quote_number(PyObject_Repr(obj));
     }
 
-exit:
+    if (!(s = PyOS_double_to_string(n, 'r', 0, Py_DTSF_ADD_DOT_0, NULL))) {
+        return NULL;
+    }
+
+    /* Prepend a space in front of negative numbers (ticket #57) */
+    len = strlen(s);
+    neg = (s[0] == '-');
+    if ((rv = Bytes_FromStringAndSize(NULL, len + neg))) {
+        if (neg) { Bytes_AS_STRING(rv)[0] = ' '; }
+        memcpy(Bytes_AS_STRING(rv) + neg, s, len);
+    }
+    PyMem_Free(s);
+
     return rv;
 }
 
+static PyObject *
+pfloat_getquoted(pfloatObject *self, PyObject *args)
+{
+    return pfloat_quote(self->wrapped);
+}
+
 static PyObject *
 pfloat_str(pfloatObject *self)
 {
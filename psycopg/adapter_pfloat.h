@@ -40,6 +40,8 @@ typedef struct {
 
 } pfloatObject;
 
+HIDDEN PyObject *pfloat_quote(PyObject *obj);
+
 /* functions exported to psycopgmodule.c */
 
 HIDDEN PyObject *psyco_Float(PyObject *module, PyObject *args);
@@ -29,44 +29,66 @@
 #include "psycopg/adapter_pint.h"
 #include "psycopg/microprotocols_proto.h"
 
+#include <string.h>
+
 
 /** the Int object **/
 
-static PyObject *
-pint_getquoted(pintObject *self, PyObject *args)
+/* Write the decimal representation of `n` into `p`, return the end */
+char *
+pint_write_long(char *p, PY_LONG_LONG n)
 {
-    PyObject *res;
-    if (!(res = PyObject_Str(self->wrapped))) {
-        goto exit;
-    }
+    char buf[PINT_LONG_MAXLEN], *b = buf + sizeof(buf);
+    unsigned PY_LONG_LONG u = n < 0 ?
+        0 - (unsigned PY_LONG_LONG)n : (unsigned PY_LONG_LONG)n;
 
-#if PY_MAJOR_VERSION > 2
-    /* unicode to bytes in Py3 */
-    {
-        PyObject *tmp = PyUnicode_AsUTF8String(res);
-        Py_DECREF(res);
-        if (!(res = tmp)) {
-            goto exit;
-        }
+    do { *--b = '0' + (char)(u % 10); u /= 10; } while (u);
+    if (n < 0) { *--b = '-'; }
+
+    memcpy(p, b, buf + sizeof(buf) - b);
+    return p + (buf + sizeof(buf) - b);
+}
+
+/* pint_quote - return the literal of an int or long
+ *
+ * The numbers fitting a long long are written in C, the other ones and the
+ * subclasses, which may customize str(), go through str().
+ */
+PyObject *
+pint_quote(PyObject *obj)
+{
+    char buf[PINT_LONG_MAXLEN + 1], *p = buf;
+    PY_LONG_LONG n;
+    int overflow;
+
+#if PY_MAJOR_VERSION < 3
+    if (PyInt_CheckExact(obj)) {
+        n = PyInt_AS_LONG(obj);
     }
+    else
 #endif
-
-    if ('-' == Bytes_AS_STRING(res)[0]) {
-        /* Prepend a space in front of negative numbers (ticket #57) */
-        PyObject *tmp;
-        if (!(tmp = Bytes_FromString(" "))) {
-            Py_DECREF(res);
-            res = NULL;
-            goto exit;
-        }
-        Bytes_ConcatAndDel(&tmp, res);
-        if (!(res = tmp)) {
-            goto exit;
+    if (PyLong_CheckExact(obj)) {
+        n = PyLong_AsLongLongAndOverflow(obj, &overflow);
+        if (overflow) {
+            return psycopg_quote_number(PyObject_Str(obj));
         }
+        if (n == -1 && PyErr_Occurred()) { return NULL; }
+    }
+    else {
+        return psycopg_quote_number(PyObject_Str(obj));
     }
 
-exit:
-    return res;
+    /* Prepend a space in front of negative numbers (ticket #57) */
+    if (n < 0) { *p++ = ' '; }
+    p = pint_write_long(p, n);
+
+    return Bytes_FromStringAndSize(buf, p - buf);
+}
+
+static PyObject *
+pint_getquoted(pintObject *self, PyObject *args)
+{
+    return pint_quote(self->wrapped);
 }
 
 static PyObject *
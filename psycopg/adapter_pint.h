@@ -40,6 +40,12 @@ typedef struct {
 
 } pintObject;
 
+/* the longest representation of a long long */
+#define PINT_LONG_MAXLEN 20
+
+HIDDEN char *pint_write_long(char *p, PY_LONG_LONG n);
+HIDDEN PyObject *pint_quote(PyObject *obj);
+
 /* functions exported to psycopgmodule.c */
 
 HIDDEN PyObject *psyco_Int(PyObject *module, PyObject *args);
@@ -49,7 +49,15 @@ qstring_quote(qstringObject *self)
     Dprintf("qstring_quote: encoding to %s", self->encoding);
 
     if (PyUnicode_Check(self->wrapped) && self->encoding) {
-        str = PyUnicode_AsEncodedString(self->wrapped, self->encoding, NULL);
+        connectionObject *conn = (connectionObject *)self->conn;
+        /* use the codec functions cached on the connection if possible */
+        if (conn && conn->codec && 0 == strcmp(self->encoding, conn->codec)) {
+            str = conn_encode(conn, self->wrapped);
+        }
+        else {
+            str = PyUnicode_AsEncodedString(
+                self->wrapped, self->encoding, NULL);
+        }
         Dprintf("qstring_quote: got encoded object at %p", str);
         if (str == NULL) return NULL;
     }
@@ -0,0 +1,382 @@
+/* adapter_range.c - adapt Range objects to range literals
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+#define PSYCOPG_MODULE
+#include "psycopg/psycopg.h"
+
+#include "psycopg/adapter_range.h"
+#include "psycopg/microprotocols.h"
+#include "psycopg/microprotocols_proto.h"
+
+#include <string.h>
+
+
+/* range_quote - adapt a Range object to a range literal
+ *
+ * If the adapter has a 'name' (the PostgreSQL range type, set as class
+ * attribute by the subclasses) the result is 'name(lower, upper, '[)')',
+ * using the adapters of the bounds. Without a name the bounds are assumed
+ * not to need quotes and the result is the untyped literal '[lower,upper)',
+ * so that the numeric ranges can be passed to int4range, int8range and
+ * numrange alike.
+ */
+
+static PyObject *
+range_quote(rangeObject *self)
+{
+    PyObject *name = NULL, *bounds = NULL, *lower = NULL, *upper = NULL;
+    PyObject *item, *res = NULL;
+    connectionObject *conn = (connectionObject *)self->connection;
+    const char *b;
+    Py_ssize_t size;
+    char *p;
+
+    if (!(name = PyObject_GetAttrString((PyObject *)self, "name"))) {
+        if (!PyErr_ExceptionMatches(PyExc_AttributeError)) { goto exit; }
+        PyErr_Clear();
+        Py_INCREF(Py_None);
+        name = Py_None;
+    }
+    if (name != Py_None && !(name = psycopg_ensure_bytes(name))) {
+        goto exit;
+    }
+
+    if (!(bounds = PyObject_GetAttrString(self->wrapped, "_bounds"))) {
+        goto exit;
+    }
+
+    if (bounds == Py_None) {
+        if (name == Py_None) {
+            res = Bytes_FromString("'empty'");
+        }
+        else {
+            res = Bytes_FromFormat("'empty'::%s", Bytes_AS_STRING(name));
+        }
+        goto exit;
+    }
+
+    if (!(bounds = psycopg_ensure_bytes(bounds))) { goto exit; }
+    if (Bytes_GET_SIZE(bounds) != 2) {
+        PyErr_SetString(PyExc_ValueError, "bound flags not valid");
+        goto exit;
+    }
+    b = Bytes_AS_STRING(bounds);
+
+    /* the quoted bounds: an infinite bound is NULL, or empty if unnamed */
+    if (!(item = PyObject_GetAttrString(self->wrapped, "_lower"))) {
+        goto exit;
+    }
+    if (item == Py_None) {
+        if (name == Py_None) {
+            lower = Bytes_FromString("");
+        }
+        else {
+            Py_INCREF(psyco_null);
+            lower = psyco_null;
+        }
+    }
+    else {
+        lower = microprotocol_getquoted(item, conn);
+    }
+    Py_DECREF(item);
+    if (!lower) { goto exit; }
+
+    if (!(item = PyObject_GetAttrString(self->wrapped, "_upper"))) {
+        goto exit;
+    }
+    if (item == Py_None) {
+        if (name == Py_None) {
+            upper = Bytes_FromString("");
+        }
+        else {
+            Py_INCREF(psyco_null);
+            upper = psyco_null;
+        }
+    }
+    else {
+        upper = microprotocol_getquoted(item, conn);
+    }
+    Py_DECREF(item);
+    if (!upper) { goto exit; }
+
+    if (!Bytes_Check(lower) || !Bytes_Check(upper)) {
+        PyErr_SetString(PyExc_TypeError,
+            "range bounds must be adapted to bytes");
+        goto exit;
+    }
+
+    /* compute the size of the result, then fill it */
+    size = Bytes_GET_SIZE(lower) + Bytes_GET_SIZE(upper);
+    if (name == Py_None) {
+        /* '[,)' */
+        size += 5;
+    }
+    else {
+        /* name(, , '[)') */
+        size += Bytes_GET_SIZE(name) + 10;
+    }
+
+    if (!(res = Bytes_FromStringAndSize(NULL, size))) { goto exit; }
+    p = Bytes_AS_STRING(res);
+
+#define RANGE_APPEND(s, l) do { memcpy(p, s, l); p += l; } while (0)
+#define RANGE_APPEND_BYTES(o) \
+    RANGE_APPEND(Bytes_AS_STRING(o), Bytes_GET_SIZE(o))
+
+    if (name == Py_None) {
+        *p++ = '\'';
+        *p++ = b[0];
+        RANGE_APPEND_BYTES(lower);
+        *p++ = ',';
+        RANGE_APPEND_BYTES(upper);
+        *p++ = b[1];
+        *p++ = '\'';
+    }
+    else {
+        RANGE_APPEND_BYTES(name);
+        *p++ = '(';
+        RANGE_APPEND_BYTES(lower);
+        RANGE_APPEND(", ", 2);
+        RANGE_APPEND_BYTES(upper);
+        RANGE_APPEND(", '", 3);
+        *p++ = b[0];
+        *p++ = b[1];
+        RANGE_APPEND("')", 2);
+    }
+
+#undef RANGE_APPEND_BYTES
+#undef RANGE_APPEND
+
+exit:
+    Py_XDECREF(name);
+    Py_XDECREF(bounds);
+    Py_XDECREF(lower);
+    Py_XDECREF(upper);
+    return res;
+}
+
+static PyObject *
+range_str(rangeObject *self)
+{
+    return psycopg_ensure_text(range_quote(self));
+}
+
+static PyObject *
+range_getquoted(rangeObject *self, PyObject *args)
+{
+    return range_quote(self);
+}
+
+static PyObject *
+range_prepare(rangeObject *self, PyObject *args)
+{
+    PyObject *conn;
+
+    if (!PyArg_ParseTuple(args, "O!", &connectionType, &conn))
+        return NULL;
+
+    Py_CLEAR(self->connection);
+    Py_INCREF(conn);
+    self->connection = conn;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *
+range_conform(rangeObject *self, PyObject *args)
+{
+    PyObject *res, *proto;
+
+    if (!PyArg_ParseTuple(args, "O", &proto)) return NULL;
+
+    if (proto == (PyObject*)&isqlquoteType)
+        res = (PyObject*)self;
+    else
+        res = Py_None;
+
+    Py_INCREF(res);
+    return res;
+}
+
+/** the RangeAdapter object **/
+
+/* object member list */
+
+static struct PyMemberDef rangeObject_members[] = {
+    {"adapted", T_OBJECT, offsetof(rangeObject, wrapped), READONLY},
+    {NULL}
+};
+
+/* object method table */
+
+static PyMethodDef rangeObject_methods[] = {
+    {"getquoted", (PyCFunction)range_getquoted, METH_NOARGS,
+     "getquoted() -> wrapped object value as SQL range"},
+    {"prepare", (PyCFunction)range_prepare, METH_VARARGS,
+     "prepare(conn) -> prepare the items for the connection"},
+    {"__conform__", (PyCFunction)range_conform, METH_VARARGS, NULL},
+    {NULL}  /* Sentinel */
+};
+
+/* initialization and finalization methods */
+
+static int
+range_setup(rangeObject *self, PyObject *obj)
+{
+    Dprintf("range_setup: init range object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+
+    self->connection = NULL;
+    Py_INCREF(obj);
+    self->wrapped = obj;
+
+    Dprintf("range_setup: good range object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+    return 0;
+}
+
+static int
+range_traverse(PyObject *obj, visitproc visit, void *arg)
+{
+    rangeObject *self = (rangeObject *)obj;
+
+    Py_VISIT(self->wrapped);
+    Py_VISIT(self->connection);
+    return 0;
+}
+
+static void
+range_dealloc(PyObject* obj)
+{
+    rangeObject *self = (rangeObject *)obj;
+
+    Py_CLEAR(self->wrapped);
+    Py_CLEAR(self->connection);
+
+    Dprintf("range_dealloc: deleted range object at %p, "
+            "refcnt = " FORMAT_CODE_PY_SSIZE_T, obj, Py_REFCNT(obj));
+
+    Py_TYPE(obj)->tp_free(obj);
+}
+
+static int
+range_init(PyObject *obj, PyObject *args, PyObject *kwds)
+{
+    PyObject *d;
+
+    if (!PyArg_ParseTuple(args, "O", &d))
+        return -1;
+
+    return range_setup((rangeObject *)obj, d);
+}
+
+static PyObject *
+range_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    return type->tp_alloc(type, 0);
+}
+
+static void
+range_del(PyObject* self)
+{
+    PyObject_GC_Del(self);
+}
+
+static PyObject *
+range_repr(rangeObject *self)
+{
+    return PyString_FromFormat(
+        "<psycopg2._psycopg.RangeAdapter object at %p>", self);
+}
+
+/* object type */
+
+#define rangeType_doc \
+"RangeAdapter(range) -> new Range object adapter"
+
+PyTypeObject rangeType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "psycopg2._psycopg.RangeAdapter",
+    sizeof(rangeObject),
+    0,
+    range_dealloc, /*tp_dealloc*/
+    0,          /*tp_print*/
+    0,          /*tp_getattr*/
+    0,          /*tp_setattr*/
+
+    0,          /*tp_compare*/
+    (reprfunc)range_repr, /*tp_repr*/
+    0,          /*tp_as_number*/
+    0,          /*tp_as_sequence*/
+    0,          /*tp_as_mapping*/
+    0,          /*tp_hash */
+
+    0,          /*tp_call*/
+    (reprfunc)range_str, /*tp_str*/
+    0,          /*tp_getattro*/
+    0,          /*tp_setattro*/
+    0,          /*tp_as_buffer*/
+
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_HAVE_GC, /*tp_flags*/
+
+    rangeType_doc, /*tp_doc*/
+
+    range_traverse, /*tp_traverse*/
+    0,          /*tp_clear*/
+
+    0,          /*tp_richcompare*/
+    0,          /*tp_weaklistoffset*/
+
+    0,          /*tp_iter*/
+    0,          /*tp_iternext*/
+
+    /* Attribute descriptor and subclassing stuff */
+
+    rangeObject_methods, /*tp_methods*/
+    rangeObject_members, /*tp_members*/
+    0,          /*tp_getset*/
+    0,          /*tp_base*/
+    0,          /*tp_dict*/
+
+    0,          /*tp_descr_get*/
+    0,          /*tp_descr_set*/
+    0,          /*tp_dictoffset*/
+
+    range_init, /*tp_init*/
+    0, /*tp_alloc  will be set to PyType_GenericAlloc in module init*/
+    range_new, /*tp_new*/
+    (freefunc)range_del, /*tp_free  Low-level free-memory routine */
+    0,          /*tp_is_gc For PyObject_IS_GC */
+    0,          /*tp_bases*/
+    0,          /*tp_mro method resolution order */
+    0,          /*tp_cache*/
+    0,          /*tp_subclasses*/
+    0           /*tp_weaklist*/
+};
@@ -0,0 +1,252 @@
+/* adapter_sqlin.c - adapt python tuples to a list of values for SQL IN
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+#define PSYCOPG_MODULE
+#include "psycopg/psycopg.h"
+
+#include "psycopg/adapter_sqlin.h"
+#include "psycopg/adapter_list.h"
+#include "psycopg/microprotocols_proto.h"
+
+
+/* sqlin_quote - adapt the items of the iterable and join them in parens */
+
+static PyObject *
+sqlin_quote(sqlinObject *self)
+{
+    PyObject *items, *rv;
+
+    if (!(items = PySequence_Tuple(self->wrapped))) { return NULL; }
+
+    rv = list_quote_items(items, (connectionObject *)self->connection,
+        "(", ")");
+
+    Py_DECREF(items);
+    return rv;
+}
+
+static PyObject *
+sqlin_str(sqlinObject *self)
+{
+    return psycopg_ensure_text(sqlin_quote(self));
+}
+
+static PyObject *
+sqlin_getquoted(sqlinObject *self, PyObject *args)
+{
+    return sqlin_quote(self);
+}
+
+static PyObject *
+sqlin_prepare(sqlinObject *self, PyObject *args)
+{
+    PyObject *conn;
+
+    if (!PyArg_ParseTuple(args, "O!", &connectionType, &conn))
+        return NULL;
+
+    Py_CLEAR(self->connection);
+    Py_INCREF(conn);
+    self->connection = conn;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *
+sqlin_conform(sqlinObject *self, PyObject *args)
+{
+    PyObject *res, *proto;
+
+    if (!PyArg_ParseTuple(args, "O", &proto)) return NULL;
+
+    if (proto == (PyObject*)&isqlquoteType)
+        res = (PyObject*)self;
+    else
+        res = Py_None;
+
+    Py_INCREF(res);
+    return res;
+}
+
+/** the SQL_IN object **/
+
+/* object member list */
+
+static struct PyMemberDef sqlinObject_members[] = {
+    {"adapted", T_OBJECT, offsetof(sqlinObject, wrapped), READONLY},
+    {NULL}
+};
+
+/* object method table */
+
+static PyMethodDef sqlinObject_methods[] = {
+    {"getquoted", (PyCFunction)sqlin_getquoted, METH_NOARGS,
+     "getquoted() -> wrapped object value as SQL list of values"},
+    {"prepare", (PyCFunction)sqlin_prepare, METH_VARARGS,
+     "prepare(conn) -> prepare the items for the connection"},
+    {"__conform__", (PyCFunction)sqlin_conform, METH_VARARGS, NULL},
+    {NULL}  /* Sentinel */
+};
+
+/* initialization and finalization methods */
+
+static int
+sqlin_setup(sqlinObject *self, PyObject *obj)
+{
+    Dprintf("sqlin_setup: init SQL_IN object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+
+    self->connection = NULL;
+    Py_INCREF(obj);
+    self->wrapped = obj;
+
+    Dprintf("sqlin_setup: good SQL_IN object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+    return 0;
+}
+
+static int
+sqlin_traverse(PyObject *obj, visitproc visit, void *arg)
+{
+    sqlinObject *self = (sqlinObject *)obj;
+
+    Py_VISIT(self->wrapped);
+    Py_VISIT(self->connection);
+    return 0;
+}
+
+static void
+sqlin_dealloc(PyObject* obj)
+{
+    sqlinObject *self = (sqlinObject *)obj;
+
+    Py_CLEAR(self->wrapped);
+    Py_CLEAR(self->connection);
+
+    Dprintf("sqlin_dealloc: deleted SQL_IN object at %p, "
+            "refcnt = " FORMAT_CODE_PY_SSIZE_T, obj, Py_REFCNT(obj));
+
+    Py_TYPE(obj)->tp_free(obj);
+}
+
+static int
+sqlin_init(PyObject *obj, PyObject *args, PyObject *kwds)
+{
+    PyObject *seq;
+
+    if (!PyArg_ParseTuple(args, "O", &seq))
+        return -1;
+
+    return sqlin_setup((sqlinObject *)obj, seq);
+}
+
+static PyObject *
+sqlin_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    return type->tp_alloc(type, 0);
+}
+
+static void
+sqlin_del(PyObject* self)
+{
+    PyObject_GC_Del(self);
+}
+
+static PyObject *
+sqlin_repr(sqlinObject *self)
+{
+    return PyString_FromFormat(
+        "<psycopg2._psycopg.SQL_IN object at %p>", self);
+}
+
+/* object type */
+
+#define sqlinType_doc \
+"SQL_IN(seq) -> new adapter for an iterable, quoted as (item, item)"
+
+PyTypeObject sqlinType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "psycopg2._psycopg.SQL_IN",
+    sizeof(sqlinObject),
+    0,
+    sqlin_dealloc, /*tp_dealloc*/
+    0,          /*tp_print*/
+    0,          /*tp_getattr*/
+    0,          /*tp_setattr*/
+
+    0,          /*tp_compare*/
+    (reprfunc)sqlin_repr, /*tp_repr*/
+    0,          /*tp_as_number*/
+    0,          /*tp_as_sequence*/
+    0,          /*tp_as_mapping*/
+    0,          /*tp_hash */
+
+    0,          /*tp_call*/
+    (reprfunc)sqlin_str, /*tp_str*/
+    0,          /*tp_getattro*/
+    0,          /*tp_setattro*/
+    0,          /*tp_as_buffer*/
+
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_HAVE_GC, /*tp_flags*/
+
+    sqlinType_doc, /*tp_doc*/
+
+    sqlin_traverse, /*tp_traverse*/
+    0,          /*tp_clear*/
+
+    0,          /*tp_richcompare*/
+    0,          /*tp_weaklistoffset*/
+
+    0,          /*tp_iter*/
+    0,          /*tp_iternext*/
+
+    /* Attribute descriptor and subclassing stuff */
+
+    sqlinObject_methods, /*tp_methods*/
+    sqlinObject_members, /*tp_members*/
+    0,          /*tp_getset*/
+    0,          /*tp_base*/
+    0,          /*tp_dict*/
+
+    0,          /*tp_descr_get*/
+    0,          /*tp_descr_set*/
+    0,          /*tp_dictoffset*/
+
+    sqlin_init, /*tp_init*/
+    0, /*tp_alloc  will be set to PyType_GenericAlloc in module init*/
+    sqlin_new, /*tp_new*/
+    (freefunc)sqlin_del, /*tp_free  Low-level free-memory routine */
+    0,          /*tp_is_gc For PyObject_IS_GC */
+    0,          /*tp_bases*/
+    0,          /*tp_mro method resolution order */
+    0,          /*tp_cache*/
+    0,          /*tp_subclasses*/
+    0           /*tp_weaklist*/
+};
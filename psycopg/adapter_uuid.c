@@ -0,0 +1,270 @@
+/* adapter_uuid.c - adapt python uuid objects
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+
+#define PSYCOPG_MODULE
+#include "psycopg/psycopg.h"
+
+#include "psycopg/adapter_uuid.h"
+#include "psycopg/microprotocols_proto.h"
+
+#include <string.h>
+
+
+/* uuid_format - write the 36 chars 'xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx'
+ * of a UUID into `buf` from the 128 bits of its int attribute.
+ *
+ * Return 0 on success, -1 with an exception set on error.
+ */
+
+RAISES_NEG int
+uuid_format(PyObject *uuid, char *buf)
+{
+    static const char digits[] = "0123456789abcdef";
+    PyObject *i;
+    unsigned char bytes[16];
+    char *p = buf;
+    int n, rv = -1;
+
+    if (!(i = PyObject_GetAttrString(uuid, "int"))) { return -1; }
+
+    /* on Python 2 UUID(int=x) may store a plain int */
+    if (!PyLong_Check(i)) {
+        PyObject *tmp = PyNumber_Long(i);
+        Py_DECREF(i);
+        if (!(i = tmp)) { return -1; }
+    }
+    if (0 != _PyLong_AsByteArray((PyLongObject *)i, bytes, 16, 0, 0)) {
+        goto exit;
+    }
+
+    for (n = 0; n < 16; n++) {
+        if (n == 4 || n == 6 || n == 8 || n == 10) { *p++ = '-'; }
+        *p++ = digits[bytes[n] >> 4];
+        *p++ = digits[bytes[n] & 0x0f];
+    }
+    rv = 0;
+
+exit:
+    Py_DECREF(i);
+    return rv;
+}
+
+/* uuid_quote - build the literal 'xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx'::uuid */
+
+static PyObject *
+uuid_quote(uuidObject *self)
+{
+    char buf[44];
+
+    buf[0] = '\'';
+    if (0 > uuid_format(self->wrapped, buf + 1)) { return NULL; }
+    memcpy(buf + 37, "'::uuid", 7);
+
+    return Bytes_FromStringAndSize(buf, sizeof(buf));
+}
+
+static PyObject *
+uuid_str(uuidObject *self)
+{
+    return psycopg_ensure_text(uuid_quote(self));
+}
+
+static PyObject *
+uuid_getquoted(uuidObject *self, PyObject *args)
+{
+    return uuid_quote(self);
+}
+
+static PyObject *
+uuid_conform(uuidObject *self, PyObject *args)
+{
+    PyObject *res, *proto;
+
+    if (!PyArg_ParseTuple(args, "O", &proto)) return NULL;
+
+    if (proto == (PyObject*)&isqlquoteType)
+        res = (PyObject*)self;
+    else
+        res = Py_None;
+
+    Py_INCREF(res);
+    return res;
+}
+
+/** the Uuid object **/
+
+/* object member list */
+
+static struct PyMemberDef uuidObject_members[] = {
+    {"adapted", T_OBJECT, offsetof(uuidObject, wrapped), READONLY},
+    {NULL}
+};
+
+/* object method table */
+
+static PyMethodDef uuidObject_methods[] = {
+    {"getquoted", (PyCFunction)uuid_getquoted, METH_NOARGS,
+     "getquoted() -> wrapped object value as SQL uuid"},
+    {"__conform__", (PyCFunction)uuid_conform, METH_VARARGS, NULL},
+    {NULL}  /* Sentinel */
+};
+
+/* initialization and finalization methods */
+
+static int
+uuid_setup(uuidObject *self, PyObject *obj)
+{
+    Dprintf("uuid_setup: init uuid object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+
+    Py_INCREF(obj);
+    self->wrapped = obj;
+
+    Dprintf("uuid_setup: good uuid object at %p, refcnt = "
+        FORMAT_CODE_PY_SSIZE_T,
+        self, Py_REFCNT(self)
+      );
+    return 0;
+}
+
+static int
+uuid_traverse(PyObject *obj, visitproc visit, void *arg)
+{
+    uuidObject *self = (uuidObject *)obj;
+
+    Py_VISIT(self->wrapped);
+    return 0;
+}
+
+static void
+uuid_dealloc(PyObject* obj)
+{
+    uuidObject *self = (uuidObject *)obj;
+
+    Py_CLEAR(self->wrapped);
+
+    Dprintf("uuid_dealloc: deleted uuid object at %p, "
+            "refcnt = " FORMAT_CODE_PY_SSIZE_T, obj, Py_REFCNT(obj));
+
+    Py_TYPE(obj)->tp_free(obj);
+}
+
+static int
+uuid_init(PyObject *obj, PyObject *args, PyObject *kwds)
+{
+    PyObject *o;
+
+    if (!PyArg_ParseTuple(args, "O", &o))
+        return -1;
+
+    return uuid_setup((uuidObject *)obj, o);
+}
+
+static PyObject *
+uuid_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    return type->tp_alloc(type, 0);
+}
+
+static void
+uuid_del(PyObject* self)
+{
+    PyObject_GC_Del(self);
+}
+
+static PyObject *
+uuid_repr(uuidObject *self)
+{
+    return PyString_FromFormat(
+        "<psycopg2._psycopg.Uuid object at %p>", self);
+}
+
+/* object type */
+
+#define uuidType_doc \
+"Uuid(uuid) -> new uuid.UUID adapter object"
+
+PyTypeObject uuidType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "psycopg2._psycopg.Uuid",
+    sizeof(uuidObject),
+    0,
+    uuid_dealloc, /*tp_dealloc*/
+    0,          /*tp_print*/
+    0,          /*tp_getattr*/
+    0,          /*tp_setattr*/
+
+    0,          /*tp_compare*/
+    (reprfunc)uuid_repr, /*tp_repr*/
+    0,          /*tp_as_number*/
+    0,          /*tp_as_sequence*/
+    0,          /*tp_as_mapping*/
+    0,          /*tp_hash */
+
+    0,          /*tp_call*/
+    (reprfunc)uuid_str, /*tp_str*/
+    0,          /*tp_getattro*/
+    0,          /*tp_setattro*/
+    0,          /*tp_as_buffer*/
+
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_HAVE_GC, /*tp_flags*/
+
+    uuidType_doc, /*tp_doc*/
+
+    uuid_traverse, /*tp_traverse*/
+    0,          /*tp_clear*/
+
+    0,          /*tp_richcompare*/
+    0,          /*tp_weaklistoffset*/
+
+    0,          /*tp_iter*/
+    0,          /*tp_iternext*/
+
+    /* Attribute descriptor and subclassing stuff */
+
+    uuidObject_methods, /*tp_methods*/
+    uuidObject_members, /*tp_members*/
+    0,          /*tp_getset*/
+    0,          /*tp_base*/
+    0,          /*tp_dict*/
+
+    0,          /*tp_descr_get*/
+    0,          /*tp_descr_set*/
+    0,          /*tp_dictoffset*/
+
+    uuid_init,  /*tp_init*/
+    0, /*tp_alloc  will be set to PyType_GenericAlloc in module init*/
+    uuid_new,   /*tp_new*/
+    (freefunc)uuid_del, /*tp_free  Low-level free-memory routine */
+    0,          /*tp_is_gc For PyObject_IS_GC */
+    0,          /*tp_bases*/
+    0,          /*tp_mro method resolution order */
+    0,          /*tp_cache*/
+    0,          /*tp_subclasses*/
+    0           /*tp_weaklist*/
+};
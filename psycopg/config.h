@@ -160,6 +160,16 @@ static double round(double num)
 #define isinf(x) (!finite((x)) && (x)==(x))
 #endif
 
+/* vectorized kernels: SSE2 is part of the x86_64 baseline, AVX2 is chosen
+ * at runtime if the compiler allows per-function targets and cpu detection */
+#if defined(__x86_64__) || defined(_M_X64)
+#define PSYCOPG_HAVE_SSE2 1
+#if defined(__clang__) || (defined(__GNUC__) \
+    && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define PSYCOPG_HAVE_AVX2 1
+#endif
+#endif
+
 /* decorators for the gcc cpychecker plugin */
 #if defined(WITH_CPYCHECKER_RETURNS_BORROWED_REF_ATTRIBUTE)
 #define BORROWED \
@@ -62,6 +62,9 @@ extern "C" {
 /* Hard limit on the notices stored by the Python connection */
 #define CONN_NOTICES_LIMIT 50
 
+/* Number of slots in the cache of the parsed queries */
+#define CONN_QUERY_CACHE_SIZE 128
+
 /* we need the initial date style to be ISO, for typecasters; if the user
    later change it, she must know what she's doing... these are the queries we
    need to issue */
@@ -120,6 +123,24 @@ typedef struct {
 
     int autocommit;
 
+    /* functions converting between unicode and the connection encoding,
+     * set together with codec. The C functions are used for the most common
+     * encodings, else the Python codec functions. */
+    PyObject *(*cdecoder)(const char *, Py_ssize_t, const char *);
+    PyObject *(*cencoder)(PyObject *);
+    PyObject *pydecoder;
+    PyObject *pyencoder;
+
+    /* the queries parsed by the cursors: tuples (query, parsed) in the slot
+     * given by the query hash */
+    PyObject *query_cache[CONN_QUERY_CACHE_SIZE];
+    long int query_cache_hits;
+    long int query_cache_misses;
+
+    /* strings and buffers longer than this are sent to the server as query
+     * parameters instead of being quoted in the query: 0 to disable */
+    long int params_threshold;
+
 } connectionObject;
 
 /* map isolation level values into a numeric const */
@@ -130,6 +151,9 @@ typedef struct {
 
 /* C-callable functions in connection_int.c and connection_ext.c */
 HIDDEN PyObject *conn_text_from_chars(connectionObject *pgconn, const char *str);
+HIDDEN PyObject *conn_encode(connectionObject *self, PyObject *u);
+HIDDEN PyObject *conn_decode(connectionObject *self,
+                             const char *str, Py_ssize_t len);
 HIDDEN int  conn_get_standard_conforming_strings(PGconn *pgconn);
 RAISES_NEG HIDDEN int  conn_get_isolation_level(connectionObject *self);
 HIDDEN int  conn_get_protocol_version(PGconn *pgconn);
@@ -138,6 +162,7 @@ HIDDEN PGcancel *conn_get_cancel(PGconn *pgconn);
 HIDDEN void conn_notice_process(connectionObject *self);
 HIDDEN void conn_notice_clean(connectionObject *self);
 HIDDEN void conn_notifies_process(connectionObject *self);
+HIDDEN void conn_clear_query_cache(connectionObject *self);
 RAISES_NEG HIDDEN int  conn_setup(connectionObject *self, PGconn *pgconn);
 HIDDEN int  conn_connect(connectionObject *self, long int async);
 HIDDEN void conn_close(connectionObject *self);
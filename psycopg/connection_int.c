@@ -66,6 +66,70 @@ conn_text_from_chars(connectionObject *self, const char *str)
 #endif
 }
 
+/* Encode a unicode object into bytes in the connection encoding.
+ *
+ * Use utf8 if the connection is NULL or its encoding is not known yet.
+ */
+PyObject *
+conn_encode(connectionObject *self, PyObject *u)
+{
+    PyObject *t, *rv;
+
+    if (self && self->cencoder) {
+        return self->cencoder(u);
+    }
+    else if (self && self->pyencoder) {
+        /* the codec functions return a tuple (output, length consumed) */
+        if (!(t = PyObject_CallFunctionObjArgs(self->pyencoder, u, NULL))) {
+            return NULL;
+        }
+        if ((rv = PyTuple_GetItem(t, 0))) {
+            Py_INCREF(rv);
+        }
+        Py_DECREF(t);
+        return rv;
+    }
+    else if (self && self->codec) {
+        return PyUnicode_AsEncodedString(u, self->codec, NULL);
+    }
+    else {
+        return PyUnicode_AsUTF8String(u);
+    }
+}
+
+/* Decode a buffer in the connection encoding into a unicode object.
+ *
+ * Use utf8 if the connection is NULL or its encoding is not known yet.
+ */
+PyObject *
+conn_decode(connectionObject *self, const char *str, Py_ssize_t len)
+{
+    PyObject *b, *t, *rv = NULL;
+
+    if (self && self->cdecoder) {
+        return self->cdecoder(str, len, NULL);
+    }
+    else if (self && self->pydecoder) {
+        if (!(b = Bytes_FromStringAndSize(str, len))) {
+            return NULL;
+        }
+        if ((t = PyObject_CallFunctionObjArgs(self->pydecoder, b, NULL))) {
+            if ((rv = PyTuple_GetItem(t, 0))) {
+                Py_INCREF(rv);
+            }
+            Py_DECREF(t);
+        }
+        Py_DECREF(b);
+        return rv;
+    }
+    else if (self && self->codec) {
+        return PyUnicode_Decode(str, len, self->codec, NULL);
+    }
+    else {
+        return PyUnicode_DecodeUTF8(str, len, NULL);
+    }
+}
+
 /* conn_notice_callback - process notices */
 
 static void
@@ -162,6 +226,19 @@ conn_notice_clean(connectionObject *self)
 }
 
 
+/* conn_clear_query_cache - drop the parsed queries cached */
+
+void
+conn_clear_query_cache(connectionObject *self)
+{
+    int i;
+
+    for (i = 0; i < CONN_QUERY_CACHE_SIZE; i++) {
+        Py_CLEAR(self->query_cache[i]);
+    }
+}
+
+
 /* conn_notifies_process - make received notification available
  *
  * The function should be called with the connection lock and holding the GIL.
@@ -324,6 +401,83 @@ exit:
     return rv;
 }
 
+/* The functions converting from and to a codec.
+ *
+ * The most common codecs are implemented by C functions. For the others the
+ * Python codec functions are looked up once and stored in the connection.
+ */
+typedef struct {
+    PyObject *pydecoder;
+    PyObject *pyencoder;
+    PyObject *(*cdecoder)(const char *, Py_ssize_t, const char *);
+    PyObject *(*cencoder)(PyObject *);
+} conn_codec_funcs;
+
+/* Fill 'funcs' with the functions for 'codec'.
+ *
+ * Return 0 in case of success, else -1 and set an exception.
+ */
+RAISES_NEG static int
+conn_get_codec_funcs(const char *codec, conn_codec_funcs *funcs)
+{
+    memset(funcs, 0, sizeof(*funcs));
+
+    if (0 == strcmp(codec, "utf_8")) {
+        funcs->cdecoder = PyUnicode_DecodeUTF8;
+        funcs->cencoder = PyUnicode_AsUTF8String;
+    }
+    else if (0 == strcmp(codec, "ascii")) {
+        funcs->cdecoder = PyUnicode_DecodeASCII;
+        funcs->cencoder = PyUnicode_AsASCIIString;
+    }
+    else if (0 == strcmp(codec, "iso8859_1")) {
+        funcs->cdecoder = PyUnicode_DecodeLatin1;
+        funcs->cencoder = PyUnicode_AsLatin1String;
+    }
+    else {
+        if (!(funcs->pydecoder = PyCodec_Decoder(codec))) {
+            return -1;
+        }
+        if (!(funcs->pyencoder = PyCodec_Encoder(codec))) {
+            Py_CLEAR(funcs->pydecoder);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Store the codec functions into the connection.
+ *
+ * Steal the references in 'funcs' and fill it with the previous values,
+ * which should be released with conn_clear_codec_funcs(). It doesn't need
+ * the GIL.
+ */
+static void
+conn_swap_codec_funcs(connectionObject *self, conn_codec_funcs *funcs)
+{
+    conn_codec_funcs tmp;
+
+    tmp.pydecoder = self->pydecoder;
+    tmp.pyencoder = self->pyencoder;
+    tmp.cdecoder = self->cdecoder;
+    tmp.cencoder = self->cencoder;
+
+    self->pydecoder = funcs->pydecoder;
+    self->pyencoder = funcs->pyencoder;
+    self->cdecoder = funcs->cdecoder;
+    self->cencoder = funcs->cencoder;
+
+    *funcs = tmp;
+}
+
+static void
+conn_clear_codec_funcs(conn_codec_funcs *funcs)
+{
+    Py_CLEAR(funcs->pydecoder);
+    Py_CLEAR(funcs->pyencoder);
+}
+
 /* Read the client encoding from the connection.
  *
  * Store the encoding in the pgconn->encoding field and the name of the
@@ -337,6 +491,7 @@ conn_read_encoding(connectionObject *self, PGconn *pgconn)
 {
     char *enc = NULL, *codec = NULL;
     const char *tmp;
+    conn_codec_funcs funcs = {NULL, NULL, NULL, NULL};
     int rv = -1;
 
     tmp = PQparameterStatus(pgconn, "client_encoding");
@@ -355,6 +510,9 @@ conn_read_encoding(connectionObject *self, PGconn *pgconn)
     if (0 > conn_encoding_to_codec(enc, &codec)) {
         goto exit;
     }
+    if (0 > conn_get_codec_funcs(codec, &funcs)) {
+        goto exit;
+    }
 
     /* Good, success: store the encoding/codec in the connection. */
     PyMem_Free(self->encoding);
@@ -365,11 +523,14 @@ conn_read_encoding(connectionObject *self, PGconn *pgconn)
     self->codec = codec;
     codec = NULL;
 
+    conn_swap_codec_funcs(self, &funcs);
+
     rv = 0;
 
 exit:
     PyMem_Free(enc);
     PyMem_Free(codec);
+    conn_clear_codec_funcs(&funcs);
     return rv;
 }
 
@@ -1137,6 +1298,7 @@ conn_set_client_encoding(connectionObject *self, const char *enc)
     int res = -1;
     char *codec = NULL;
     char *clean_enc = NULL;
+    conn_codec_funcs funcs = {NULL, NULL, NULL, NULL};
 
     /* If the current encoding is equal to the requested one we don't
        issue any query to the backend */
@@ -1145,6 +1307,7 @@ conn_set_client_encoding(connectionObject *self, const char *enc)
     /* We must know what python codec this encoding is. */
     if (0 > clear_encoding_name(enc, &clean_enc)) { goto exit; }
     if (0 > conn_encoding_to_codec(clean_enc, &codec)) { goto exit; }
+    if (0 > conn_get_codec_funcs(codec, &funcs)) { goto exit; }
 
     Py_BEGIN_ALLOW_THREADS;
     pthread_mutex_lock(&self->lock);
@@ -1175,6 +1338,7 @@ conn_set_client_encoding(connectionObject *self, const char *enc)
         PyMem_Free(tmp);
         codec = NULL;
     }
+    conn_swap_codec_funcs(self, &funcs);
 
     Dprintf("conn_set_client_encoding: set encoding to %s (codec: %s)",
             self->encoding, self->codec);
@@ -1185,10 +1349,15 @@ endlock:
 
     if (res < 0)
         pq_complete_error(self, &pgres, &error);
+    else {
+        /* the cached unicode queries were encoded with the old codec */
+        conn_clear_query_cache(self);
+    }
 
 exit:
     PyMem_Free(clean_enc);
     PyMem_Free(codec);
+    conn_clear_codec_funcs(&funcs);
 
     return res;
 }
@@ -973,6 +973,15 @@ static struct PyMemberDef connectionObject_members[] = {
     {"server_version", T_INT,
         offsetof(connectionObject, server_version), READONLY,
         "Server version."},
+    {"query_cache_hits", T_LONG,
+        offsetof(connectionObject, query_cache_hits), READONLY,
+        "Number of queries found already parsed."},
+    {"query_cache_misses", T_LONG,
+        offsetof(connectionObject, query_cache_misses), READONLY,
+        "Number of queries parsed."},
+    {"params_threshold", T_LONG,
+        offsetof(connectionObject, params_threshold), 0,
+        "Size above which strings and buffers are sent as query parameters."},
 #endif
     {NULL}
 };
@@ -1084,6 +1093,9 @@ connection_dealloc(PyObject* obj)
     Py_CLEAR(self->notifies);
     Py_CLEAR(self->string_types);
     Py_CLEAR(self->binary_types);
+    Py_CLEAR(self->pydecoder);
+    Py_CLEAR(self->pyencoder);
+    conn_clear_query_cache(self);
 
     pthread_mutex_destroy(&(self->lock));
 
@@ -61,6 +61,8 @@ struct cursorObject {
 
     PyObject *casts;       /* an array (tuple) of typecast functions */
     PyObject *caster;      /* the current typecaster object */
+    PyObject *itercols;    /* columns of the iterated batch already cast */
+    long int itercols_row; /* the first row of the batch in itercols */
 
     PyObject  *copyfile;   /* file-like used during COPY TO/FROM ops */
     Py_ssize_t copysize;   /* size of the copy buffer during COPY TO/FROM ops */
@@ -69,6 +71,10 @@ struct cursorObject {
 
     PyObject *tuple_factory;    /* factory for result tuples */
     PyObject *tzinfo_factory;   /* factory for tzinfo objects */
+    PyObject *tzinfo_cache;     /* tzinfo objects by offset in minutes */
+    PyObject *tzinfo_cache_factory; /* the tzinfo_factory filling the cache */
+    PyObject *tzinfo_last;      /* last tzinfo used, borrowed from the cache */
+    int tzinfo_last_offset;     /* offset in minutes of tzinfo_last */
 
     PyObject *query;      /* last query executed */
 
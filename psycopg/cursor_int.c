@@ -87,4 +87,8 @@ curs_reset(cursorObject *self)
     tmp = self->casts;
     self->casts = NULL;
     Py_XDECREF(tmp);
+
+    tmp = self->itercols;
+    self->itercols = NULL;
+    Py_XDECREF(tmp);
 }
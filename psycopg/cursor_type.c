@@ -33,6 +33,9 @@
 #include "psycopg/typecast.h"
 #include "psycopg/microprotocols.h"
 #include "psycopg/microprotocols_proto.h"
+#include "psycopg/adapter_binary.h"
+#include "psycopg/adapter_qstring.h"
+#include "psycopg/pgtypes.h"
 
 #include <string.h>
 
@@ -77,183 +80,78 @@ exit:
 
 /* execute method - executes a query */
 
-/* mogrify a query string and build argument array or dict */
+/* the buffer where the query is merged with its arguments
+ *
+ * The data is written on the stack while it fits, then on the heap, growing
+ * the buffer geometrically.
+ */
+typedef struct {
+    char *data;
+    Py_ssize_t len;
+    Py_ssize_t size;
+    char stack[512];
+} querybuf;
 
 RAISES_NEG static int
-_mogrify(PyObject *var, PyObject *fmt, cursorObject *curs, PyObject **new)
+querybuf_init(querybuf *qb, Py_ssize_t size)
 {
-    PyObject *key, *value, *n;
-    const char *d, *c;
-    Py_ssize_t index = 0;
-    int force = 0, kind = 0;
-
-    /* from now on we'll use n and replace its value in *new only at the end,
-       just before returning. we also init *new to NULL to exit with an error
-       if we can't complete the mogrification */
-    n = *new = NULL;
-    c = Bytes_AsString(fmt);
-
-    while(*c) {
-        if (*c++ != '%') {
-            /* a regular character */
-            continue;
+    qb->len = 0;
+    if (size <= (Py_ssize_t)sizeof(qb->stack)) {
+        qb->data = qb->stack;
+        qb->size = sizeof(qb->stack);
+    }
+    else {
+        if (!(qb->data = PyMem_Malloc(size))) {
+            PyErr_NoMemory();
+            return -1;
         }
+        qb->size = size;
+    }
+    return 0;
+}
 
-        switch (*c) {
-
-        /* handle plain percent symbol in format string */
-        case '%':
-            ++c;
-            force = 1;
-            break;
-
-        /* if we find '%(' then this is a dictionary, we:
-           1/ find the matching ')' and extract the key name
-           2/ locate the value in the dictionary (or return an error)
-           3/ mogrify the value into something usefull (quoting)...
-           4/ ...and add it to the new dictionary to be used as argument
-        */
-        case '(':
-            /* check if some crazy guy mixed formats */
-            if (kind == 2) {
-                Py_XDECREF(n);
-                psyco_set_error(ProgrammingError, curs,
-                   "argument formats can't be mixed", NULL, NULL);
-                return -1;
-            }
-            kind = 1;
-
-            /* let's have d point the end of the argument */
-            for (d = c + 1; *d && *d != ')' && *d != '%'; d++);
-
-            if (*d == ')') {
-                if (!(key = Text_FromUTF8AndSize(c+1, (Py_ssize_t)(d-c-1)))) {
-                    Py_XDECREF(n);
-                    return -1;
-                }
-
-                /*  if value is NULL we did not find the key (or this is not a
-                    dictionary): let python raise a KeyError */
-                if (!(value = PyObject_GetItem(var, key))) {
-                    Py_DECREF(key); /* destroy key */
-                    Py_XDECREF(n);  /* destroy n */
-                    return -1;
-                }
-                /* key has refcnt 1, value the original value + 1 */
-
-                Dprintf("_mogrify: value refcnt: "
-                  FORMAT_CODE_PY_SSIZE_T " (+1)", Py_REFCNT(value));
-
-                if (n == NULL) {
-                    if (!(n = PyDict_New())) {
-                        Py_DECREF(key);
-                        Py_DECREF(value);
-                        return -1;
-                    }
-                }
-
-                if (0 == PyDict_Contains(n, key)) {
-                    PyObject *t = NULL;
-
-                    /* None is always converted to NULL; this is an
-                       optimization over the adapting code and can go away in
-                       the future if somebody finds a None adapter useful. */
-                    if (value == Py_None) {
-                        Py_INCREF(psyco_null);
-                        t = psyco_null;
-                        PyDict_SetItem(n, key, t);
-                        /* t is a new object, refcnt = 1, key is at 2 */
-                    }
-                    else {
-                        t = microprotocol_getquoted(value, curs->conn);
-                        if (t != NULL) {
-                            PyDict_SetItem(n, key, t);
-                            /* both key and t refcnt +1, key is at 2 now */
-                        }
-                        else {
-                            /* no adapter found, raise a BIG exception */
-                            Py_DECREF(key);
-                            Py_DECREF(value);
-                            Py_DECREF(n);
-                            return -1;
-                        }
-                    }
-
-                    Py_XDECREF(t); /* t dies here */
-                }
-                Py_DECREF(value);
-                Py_DECREF(key); /* key has the original refcnt now */
-                Dprintf("_mogrify: after value refcnt: "
-                    FORMAT_CODE_PY_SSIZE_T, Py_REFCNT(value));
-            }
-            else {
-                /* we found %( but not a ) */
-                Py_XDECREF(n);
-                psyco_set_error(ProgrammingError, curs,
-                   "incomplete placeholder: '%(' without ')'", NULL, NULL);
-                return -1;
-            }
-            c = d + 1;  /* after the ) */
-            break;
-
-        default:
-            /* this is a format that expects a tuple; it is much easier,
-               because we don't need to check the old/new dictionary for
-               keys */
-
-            /* check if some crazy guy mixed formats */
-            if (kind == 1) {
-                Py_XDECREF(n);
-                psyco_set_error(ProgrammingError, curs,
-                  "argument formats can't be mixed", NULL, NULL);
-                return -1;
-            }
-            kind = 2;
+static void
+querybuf_free(querybuf *qb)
+{
+    if (qb->data != qb->stack) {
+        PyMem_Free(qb->data);
+    }
+    qb->data = NULL;
+}
 
-            value = PySequence_GetItem(var, index);
-            /* value has refcnt inc'ed by 1 here */
+RAISES_NEG static int
+querybuf_append(querybuf *qb, const char *s, Py_ssize_t len)
+{
+    if (len > qb->size - qb->len) {
+        Py_ssize_t size = qb->size;
+        char *data;
 
-            /*  if value is NULL this is not a sequence or the index is wrong;
-                anyway we let python set its own exception */
-            if (value == NULL) {
-                Py_XDECREF(n);
+        while (len > size - qb->len) {
+            if (size > PY_SSIZE_T_MAX / 2) {
+                PyErr_NoMemory();
                 return -1;
             }
+            size *= 2;
+        }
 
-            if (n == NULL) {
-                if (!(n = PyTuple_New(PyObject_Length(var)))) {
-                    Py_DECREF(value);
-                    return -1;
-                }
+        if (qb->data == qb->stack) {
+            if ((data = PyMem_Malloc(size))) {
+                memcpy(data, qb->data, qb->len);
             }
-
-            /* let's have d point just after the '%' */
-            if (value == Py_None) {
-                Py_INCREF(psyco_null);
-                PyTuple_SET_ITEM(n, index, psyco_null);
-                Py_DECREF(value);
-            }
-            else {
-                PyObject *t = microprotocol_getquoted(value, curs->conn);
-
-                if (t != NULL) {
-                    PyTuple_SET_ITEM(n, index, t);
-                    Py_DECREF(value);
-                }
-                else {
-                    Py_DECREF(n);
-                    Py_DECREF(value);
-                    return -1;
-                }
-            }
-            index += 1;
         }
+        else {
+            data = PyMem_Realloc(qb->data, size);
+        }
+        if (!data) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        qb->data = data;
+        qb->size = size;
     }
 
-    if (force && n == NULL)
-        n = PyTuple_New(0);
-    *new = n;
-
+    memcpy(qb->data + qb->len, s, len);
+    qb->len += len;
     return 0;
 }
 
@@ -276,8 +174,7 @@ static PyObject *_psyco_curs_validate_sql_basic(
         Py_INCREF(sql);
     }
     else if (PyUnicode_Check(sql)) {
-        char *enc = self->conn->codec;
-        sql = PyUnicode_AsEncodedString(sql, enc, NULL);
+        sql = conn_encode(self->conn, sql);
         /* if there was an error during the encoding from unicode to the
            target encoding, we just let the exception propagate */
         if (sql == NULL) { goto fail; }
@@ -294,70 +191,528 @@ static PyObject *_psyco_curs_validate_sql_basic(
         return NULL;
 }
 
-/* Merge together a query string and its arguments.
+/* The parsed queries are tuples (query, kind, items, names):
+ *
+ * - query: the query encoded in the connection encoding;
+ * - kind: one of the QUERY_KIND_* values below;
+ * - items: a bytes string containing an array of queryitem, the literal
+ *   parts of the query each optionally followed by a placeholder;
+ * - names: for QUERY_KIND_MAPPING, the tuple of the arguments names.
  *
- * The arguments have been already adapted to SQL.
+ * The connection caches the parsed queries in a table of
+ * CONN_QUERY_CACHE_SIZE slots chosen by the query hash: a query evicts the
+ * one in its slot. Queries longer than QUERY_CACHE_MAXLEN, which are probably
+ * generated, are not cached.
+ */
+
+#define QUERY_KIND_NONE 0       /* nothing to merge: the query is unchanged */
+#define QUERY_KIND_MAPPING 1    /* '%(name)s' placeholders */
+#define QUERY_KIND_SEQUENCE 2   /* '%s' placeholders */
+#define QUERY_KIND_PERCENT 3    /* no placeholder but '%%' */
+
+#define QUERY_CACHE_MAXLEN 65536
+
+typedef struct {
+    Py_ssize_t start;   /* the literal part of the query */
+    Py_ssize_t end;
+    Py_ssize_t arg;     /* the index of the argument following, or -1 */
+} queryitem;
+
+/* _psyco_curs_parse_query - find the placeholders in a query
  *
- * Return a new reference to a string with the merged query,
- * NULL and set an exception if any happened.
+ * Return a new reference to the parsed query, NULL if the query has invalid
+ * placeholders.
  */
 static PyObject *
-_psyco_curs_merge_query_args(cursorObject *self,
-                             PyObject *query, PyObject *args)
+_psyco_curs_parse_query(cursorObject *self, PyObject *query)
 {
-    PyObject *fquery;
+    querybuf qb;
+    queryitem item;
+    PyObject *keys = NULL, *names = NULL, *items = NULL, *rv = NULL;
+    PyObject *key, *idx;
+    const char *fmt, *c, *d, *end;
+    Py_ssize_t nargs = 0, pos = 0;
+    int force = 0, kind = QUERY_KIND_NONE;
+
+    fmt = c = Bytes_AS_STRING(query);
+    end = fmt + Bytes_GET_SIZE(query);
+
+    if (0 > querybuf_init(&qb, 0)) { return NULL; }
+
+    item.start = 0;
+    while ((c = memchr(c, '%', end - c))) {
+        item.end = c - fmt;
+        c++;
+
+        /* handle plain percent symbol in format string: the first one ends
+           the literal part */
+        if (c < end && *c == '%') {
+            item.end++;
+            item.arg = -1;
+            if (0 > querybuf_append(&qb, (char *)&item, sizeof(item))) {
+                goto exit;
+            }
+            item.start = ++c - fmt;
+            force = 1;
+            continue;
+        }
 
-    /* if PyString_Format() return NULL an error occured: if the error is
-       a TypeError we need to check the exception.args[0] string for the
-       values:
+        if (c < end && *c == '(') {
+            /* a '%(name)s' placeholder: a key appearing several times in the
+               query refers to the same argument */
+            if (kind == QUERY_KIND_SEQUENCE) {
+                psyco_set_error(ProgrammingError, self,
+                   "argument formats can't be mixed", NULL, NULL);
+                goto exit;
+            }
+            kind = QUERY_KIND_MAPPING;
 
-           "not enough arguments for format string"
-           "not all arguments converted"
+            /* let's have d point the end of the argument */
+            for (d = c + 1; d < end && *d != ')' && *d != '%'; d++);
 
-       and return the appropriate ProgrammingError. we do that by grabbing
-       the curren exception (we will later restore it if the type or the
-       strings do not match.) */
+            if (d == end || *d != ')') {
+                /* we found %( but not a ) */
+                psyco_set_error(ProgrammingError, self,
+                   "incomplete placeholder: '%(' without ')'", NULL, NULL);
+                goto exit;
+            }
 
-    if (!(fquery = Bytes_Format(query, args))) {
-        PyObject *err, *arg, *trace;
-        int pe = 0;
+            if (!keys && !(keys = PyDict_New())) { goto exit; }
+            if (!(key = Text_FromUTF8AndSize(c + 1, (Py_ssize_t)(d - c - 1)))) {
+                goto exit;
+            }
+            if ((idx = PyDict_GetItem(keys, key))) {
+                item.arg = PyInt_AsLong(idx);
+            }
+            else {
+                item.arg = nargs++;
+                if (!(idx = PyInt_FromSsize_t(item.arg))
+                        || 0 > PyDict_SetItem(keys, key, idx)) {
+                    Py_XDECREF(idx);
+                    Py_DECREF(key);
+                    goto exit;
+                }
+                Py_DECREF(idx);
+            }
+            Py_DECREF(key);
+            c = d + 1;  /* after the ) */
+        }
+        else {
+            /* a '%s' placeholder: the next item of the sequence */
+            if (kind == QUERY_KIND_MAPPING) {
+                psyco_set_error(ProgrammingError, self,
+                  "argument formats can't be mixed", NULL, NULL);
+                goto exit;
+            }
+            kind = QUERY_KIND_SEQUENCE;
+            item.arg = nargs++;
+        }
 
-        PyErr_Fetch(&err, &arg, &trace);
+        /* the placeholder must be terminated by the 's' conversion */
+        if (c == end) {
+            PyErr_SetString(PyExc_ValueError, "incomplete format");
+            goto exit;
+        }
+        if (*c != 's') {
+            PyErr_Format(PyExc_ValueError,
+              "unsupported format character '%c' (0x%x) "
+              "at index " FORMAT_CODE_PY_SSIZE_T,
+              *c, (unsigned char)*c, (Py_ssize_t)(c - fmt));
+            goto exit;
+        }
 
-        if (err && PyErr_GivenExceptionMatches(err, PyExc_TypeError)) {
-            Dprintf("psyco_curs_execute: TypeError exception catched");
-            PyErr_NormalizeException(&err, &arg, &trace);
+        if (0 > querybuf_append(&qb, (char *)&item, sizeof(item))) {
+            goto exit;
+        }
+        item.start = ++c - fmt;
+    }
 
-            if (PyObject_HasAttrString(arg, "args")) {
-                PyObject *args = PyObject_GetAttrString(arg, "args");
-                PyObject *str = PySequence_GetItem(args, 0);
-                const char *s = Bytes_AS_STRING(str);
+    /* the literal part after the last placeholder */
+    item.end = end - fmt;
+    item.arg = -1;
+    if (0 > querybuf_append(&qb, (char *)&item, sizeof(item))) { goto exit; }
 
-                Dprintf("psyco_curs_execute:     -> %s", s);
+    if (kind == QUERY_KIND_NONE && force) {
+        kind = QUERY_KIND_PERCENT;
+    }
 
-                if (!strcmp(s, "not enough arguments for format string")
-                  || !strcmp(s, "not all arguments converted")) {
-                    Dprintf("psyco_curs_execute:     -> got a match");
-                    psyco_set_error(ProgrammingError, self,
-                                     s, NULL, NULL);
-                    pe = 1;
-                }
+    /* the names of the arguments in order */
+    if (kind == QUERY_KIND_MAPPING) {
+        if (!(names = PyTuple_New(nargs))) { goto exit; }
+        while (PyDict_Next(keys, &pos, &key, &idx)) {
+            Py_INCREF(key);
+            PyTuple_SET_ITEM(names, PyInt_AsLong(idx), key);
+        }
+    }
+    else {
+        Py_INCREF(Py_None);
+        names = Py_None;
+    }
+
+    if (kind == QUERY_KIND_NONE) {
+        Py_INCREF(Py_None);
+        items = Py_None;
+    }
+    else if (!(items = Bytes_FromStringAndSize(qb.data, qb.len))) {
+        goto exit;
+    }
+    rv = Py_BuildValue("(OiOO)", query, kind, items, names);
+
+exit:
+    Py_XDECREF(keys);
+    Py_XDECREF(names);
+    Py_XDECREF(items);
+    querybuf_free(&qb);
+
+    return rv;
+}
+
+/* Return 1 if the query `b` found in the cache is the same as `a`. */
+static int
+_psyco_curs_same_query(PyObject *a, PyObject *b)
+{
+    if (a == b) { return 1; }
+    if (Py_TYPE(a) != Py_TYPE(b)) { return 0; }
+
+    if (Bytes_CheckExact(a)) {
+        return Bytes_GET_SIZE(a) == Bytes_GET_SIZE(b)
+            && 0 == memcmp(Bytes_AS_STRING(a), Bytes_AS_STRING(b),
+                Bytes_GET_SIZE(a));
+    }
+#if PY_MAJOR_VERSION < 3
+    return PyUnicode_GET_SIZE(a) == PyUnicode_GET_SIZE(b)
+        && 0 == memcmp(PyUnicode_AS_UNICODE(a), PyUnicode_AS_UNICODE(b),
+            PyUnicode_GET_DATA_SIZE(a));
+#else
+    {
+        int rv = PyObject_RichCompareBool(a, b, Py_EQ);
+        if (rv < 0) { PyErr_Clear(); rv = 0; }
+        return rv;
+    }
+#endif
+}
+
+/* Return the parsed query for `operation`, from the connection cache if
+ * possible, else validating and parsing it.
+ *
+ * If `parse` is false the arguments are not going to be merged: a query
+ * whose placeholders can't be parsed is returned as it is.
+ */
+static PyObject *
+_psyco_curs_get_query(cursorObject *self, PyObject *operation, int parse)
+{
+    connectionObject *conn = self->conn;
+    PyObject **slot = NULL;
+    PyObject *query, *rv;
+    Py_hash_t hash;
+
+    if (Bytes_CheckExact(operation) || PyUnicode_CheckExact(operation)) {
+        if (-1 == (hash = PyObject_Hash(operation))) { return NULL; }
+        slot = &conn->query_cache[(size_t)hash % CONN_QUERY_CACHE_SIZE];
+        if (*slot && _psyco_curs_same_query(
+                operation, PyTuple_GET_ITEM(*slot, 0))) {
+            conn->query_cache_hits++;
+            rv = PyTuple_GET_ITEM(*slot, 1);
+            Py_INCREF(rv);
+            return rv;
+        }
+        conn->query_cache_misses++;
+    }
+
+    if (!(query = _psyco_curs_validate_sql_basic(self, operation))) {
+        return NULL;
+    }
+
+    if (!(rv = _psyco_curs_parse_query(self, query))) {
+        if (!parse) {
+            /* the query can't be merged but nobody asked to */
+            PyErr_Clear();
+            rv = Py_BuildValue("(OiOO)",
+                query, QUERY_KIND_NONE, Py_None, Py_None);
+        }
+        goto exit;
+    }
+
+    if (slot && Bytes_GET_SIZE(query) <= QUERY_CACHE_MAXLEN) {
+        PyObject *entry, *old = *slot;
+        if (!(entry = PyTuple_Pack(2, operation, rv))) {
+            Py_CLEAR(rv);
+            goto exit;
+        }
+        *slot = entry;
+        Py_XDECREF(old);
+    }
+
+exit:
+    Py_DECREF(query);
+    return rv;
+}
+
+/* Return the size of a string or buffer `obj`, -1 on error. */
+static Py_ssize_t
+_psyco_curs_buffer_size(PyObject *obj)
+{
+    binarybuf b;
+    Py_ssize_t rv;
+
+    if (Bytes_Check(obj)) { return Bytes_GET_SIZE(obj); }
+
+    if (0 > binary_buffer_get(obj, &b)) { return -1; }
+    rv = b.len;
+    binary_buffer_release(&b);
+    return rv;
+}
+
+/* Check if an argument of the query should be sent as a parameter.
+ *
+ * Only the strings and buffers adapted by the default adapters and longer
+ * than the connection params_threshold qualify: the text ones are passed in
+ * the connection encoding, the binary ones as bytea in binary format, with
+ * no escaping. Return a new reference to a tuple (oid, bytes or buffer),
+ * to None if the value should be quoted, NULL on error.
+ */
+static PyObject *
+_psyco_curs_param_arg(cursorObject *self, PyObject *value)
+{
+    PyObject *obj = NULL, *rv = NULL;
+    PyTypeObject *adapter;
+    long int oid;
+    Py_ssize_t size;
+
+    if (Py_TYPE(value) == &binaryType) {
+        /* explicit Binary() wrapper */
+        value = ((binaryObject *)value)->wrapped;
+        if (value == Py_None) { goto none; }
+        adapter = NULL;
+        oid = BYTEAOID;
+    }
+    else if (PyUnicode_CheckExact(value)
+#if PY_MAJOR_VERSION < 3
+            || PyString_CheckExact(value)
+#endif
+            ) {
+        adapter = &qstringType;
+        /* unspecified: the server infers the type from the context, failing
+         * where there is none (e.g. "$1 IS NULL"), unlike a quoted literal */
+        oid = 0;
+    }
+    else if (Bytes_CheckExact(value)
+#if HAS_MEMORYVIEW
+            || PyByteArray_CheckExact(value)
+#endif
+#if PY_VERSION_HEX >= 0x02070000
+            || PyMemoryView_Check(value)
+#endif
+#if HAS_BUFFER
+            || PyBuffer_Check(value)
+#endif
+            ) {
+        adapter = &binaryType;
+        oid = BYTEAOID;
+    }
+    else {
+        goto none;
+    }
+
+    /* the user may have registered a different adapter for the type */
+    if (adapter) {
+        switch (microprotocols_has_adapter(value, adapter)) {
+        case 1:
+            break;
+        case 0:
+            goto none;
+        default:
+            return NULL;
+        }
+    }
+
+    if (oid != BYTEAOID && PyUnicode_Check(value)) {
+        /* no encoding produces more than 4 bytes per char: don't encode
+           the strings that can't be long enough */
+#if PY_VERSION_HEX >= 0x03030000
+        size = PyUnicode_GET_LENGTH(value);
+#else
+        size = PyUnicode_GET_SIZE(value);
+#endif
+        if (size <= self->conn->params_threshold / 4) { goto none; }
+        if (!(obj = conn_encode(self->conn, value))) { goto exit; }
+    }
+    else {
+        Py_INCREF(value);
+        obj = value;
+    }
+
+    if (0 > (size = _psyco_curs_buffer_size(obj))) { goto exit; }
+    if (size <= self->conn->params_threshold || size > INT_MAX) {
+        goto none;
+    }
 
-                Py_DECREF(args);
-                Py_DECREF(str);
+    rv = Py_BuildValue("(lO)", oid, obj);
+    goto exit;
+
+none:
+    Py_INCREF(Py_None);
+    rv = Py_None;
+
+exit:
+    Py_XDECREF(obj);
+    return rv;
+}
+
+/* Adapt an argument of the query. Return a new reference to bytes.
+ *
+ * If `params` is not NULL the value may be appended to it as a parameter
+ * (see _psyco_curs_param_arg): in this case return its placeholder.
+ */
+static PyObject *
+_psyco_curs_quote_arg(cursorObject *self, PyObject *value, PyObject *params)
+{
+    PyObject *rv;
+
+    /* None is always converted to NULL; this is an optimization over the
+       adapting code and can go away in the future if somebody finds a None
+       adapter useful. */
+    if (value == Py_None) {
+        Py_INCREF(psyco_null);
+        return psyco_null;
+    }
+
+    if (params) {
+        if (!(rv = _psyco_curs_param_arg(self, value))) { return NULL; }
+        if (rv != Py_None) {
+            if (0 > PyList_Append(params, rv)) {
+                Py_DECREF(rv);
+                return NULL;
             }
+            Py_DECREF(rv);
+            return Bytes_FromFormat("$%d", (int)PyList_GET_SIZE(params));
         }
+        Py_DECREF(rv);
+    }
+
+    if (!(rv = microprotocol_getquoted(value, self->conn))) {
+        return NULL;
+    }
+    if (!Bytes_CheckExact(rv)) {
+        PyErr_Format(PyExc_ValueError,
+            "only bytes values expected, got %s", Py_TYPE(rv)->tp_name);
+        Py_CLEAR(rv);
+    }
+    return rv;
+}
 
-        /* if we did not manage our own exception, restore old one */
-        if (pe == 1) {
-            Py_XDECREF(err); Py_XDECREF(arg); Py_XDECREF(trace);
+/* _psyco_curs_merge_query - merge a parsed query with its arguments
+ *
+ * Write the literal parts of the query and the quoted arguments into a
+ * single buffer. The arguments are the items of the sequence `vars` for
+ * '%s' placeholders or of the mapping `vars` for '%(name)s' ones.
+ *
+ * If `params` is a list, the arguments to send out of the query are
+ * appended to it (see _psyco_curs_quote_arg).
+ *
+ * Return a new reference to the merged query, or to the query itself if
+ * there is nothing to merge; NULL on error.
+ */
+static PyObject *
+_psyco_curs_merge_query(cursorObject *self, PyObject *parsed, PyObject *vars,
+                        PyObject *params)
+{
+    PyObject *query = PyTuple_GET_ITEM(parsed, 0);
+    int kind = (int)PyInt_AsLong(PyTuple_GET_ITEM(parsed, 1));
+    PyObject *items = PyTuple_GET_ITEM(parsed, 2);
+    PyObject *names = PyTuple_GET_ITEM(parsed, 3);
+    PyObject **quoted = NULL;
+    PyObject *value, *t = NULL, *rv = NULL;
+    const char *fmt = Bytes_AS_STRING(query);
+    queryitem item;
+    querybuf qb;
+    Py_ssize_t i, nitems, nquoted = 0, nused = 0, nargs;
+
+    if (kind == QUERY_KIND_NONE) {
+        Py_INCREF(query);
+        return query;
+    }
+
+    if (0 > querybuf_init(&qb, 2 * Bytes_GET_SIZE(query))) { return NULL; }
+
+    /* the arguments of a mapping are adapted once, however many times
+       they appear in the query */
+    if (kind == QUERY_KIND_MAPPING) {
+        nquoted = PyTuple_GET_SIZE(names);
+        if (!(quoted = PyMem_Malloc(nquoted * sizeof(PyObject *)))) {
+            PyErr_NoMemory();
+            goto exit;
+        }
+        memset(quoted, 0, nquoted * sizeof(PyObject *));
+    }
+
+    nitems = Bytes_GET_SIZE(items) / sizeof(queryitem);
+    for (i = 0; i < nitems; i++) {
+        /* the array in the bytes string may be not aligned */
+        memcpy(&item, Bytes_AS_STRING(items) + i * sizeof(queryitem),
+            sizeof(queryitem));
+
+        if (0 > querybuf_append(
+                &qb, fmt + item.start, item.end - item.start)) {
+            goto exit;
+        }
+        if (item.arg < 0) { continue; }
+
+        if (kind == QUERY_KIND_MAPPING) {
+            if (!quoted[item.arg]) {
+                /* if value is NULL we did not find the key (or this is not
+                   a dictionary): let python raise a KeyError */
+                if (!(value = PyObject_GetItem(
+                        vars, PyTuple_GET_ITEM(names, item.arg)))) {
+                    goto exit;
+                }
+                quoted[item.arg] = _psyco_curs_quote_arg(
+                    self, value, params);
+                Py_DECREF(value);
+                if (!quoted[item.arg]) { goto exit; }
+            }
+            t = quoted[item.arg];
+            Py_INCREF(t);
         }
         else {
-            PyErr_Restore(err, arg, trace);
+            /* if value is NULL this is not a sequence or the index is
+               wrong; anyway we let python set its own exception */
+            if (!(value = PySequence_GetItem(vars, item.arg))) { goto exit; }
+            nused++;
+            t = _psyco_curs_quote_arg(self, value, params);
+            Py_DECREF(value);
+            if (!t) { goto exit; }
         }
+
+        if (0 > querybuf_append(&qb, Bytes_AS_STRING(t), Bytes_GET_SIZE(t))) {
+            goto exit;
+        }
+        Py_CLEAR(t);
     }
 
-    return fquery;
+    /* all the items of a sequence must be used */
+    if (kind == QUERY_KIND_SEQUENCE) {
+        if (0 > (nargs = PyObject_Length(vars))) { goto exit; }
+        if (nused < nargs) {
+            PyErr_SetString(PyExc_TypeError,
+                "not all arguments converted during string formatting");
+            goto exit;
+        }
+    }
+
+    rv = Bytes_FromStringAndSize(qb.data, qb.len);
+
+exit:
+    Py_XDECREF(t);
+    if (quoted) {
+        for (i = 0; i < nquoted; i++) {
+            Py_XDECREF(quoted[i]);
+        }
+        PyMem_Free(quoted);
+    }
+    querybuf_free(&qb);
+
+    return rv;
 }
 
 #define psyco_curs_execute_doc \
@@ -369,9 +724,11 @@ _psyco_curs_execute(cursorObject *self,
 {
     int res = -1;
     int tmp;
-    PyObject *fquery, *cvt = NULL;
+    PyObject *fquery, *params = NULL;
+    int merge = (vars && vars != Py_None);
 
-    operation = _psyco_curs_validate_sql_basic(self, operation);
+    /* the query encoded and parsed, or NULL */
+    operation = _psyco_curs_get_query(self, operation, merge);
 
     /* Any failure from here forward should 'goto fail' rather than 'return 0'
        directly. */
@@ -391,48 +748,42 @@ _psyco_curs_execute(cursorObject *self,
        objects to be substituted (bound variables). we try to be smart and do
        the right thing (i.e., what the user expects) */
 
-    if (vars && vars != Py_None)
-    {
-        if (0 > _mogrify(vars, operation, self, &cvt)) { goto exit; }
-    }
-
-    if (vars && cvt) {
-        if (!(fquery = _psyco_curs_merge_query_args(self, operation, cvt))) {
+    if (merge) {
+        /* the long strings may be sent as parameters: not in the DECLARE
+           of a named cursor, nor with the callback of green connections,
+           which sends the query as text */
+        if (self->conn->params_threshold > 0 && self->name == NULL
+                && self->conn->protocol >= 3 && !psyco_green()) {
+            if (!(params = PyList_New(0))) { goto exit; }
+        }
+        if (!(fquery = _psyco_curs_merge_query(
+                self, operation, vars, params))) {
             goto exit;
         }
+        if (params && PyList_GET_SIZE(params) == 0) { Py_CLEAR(params); }
+    }
+    else {
+        fquery = PyTuple_GET_ITEM(operation, 0);
+        Py_INCREF(fquery);
+    }
 
-        if (self->name != NULL) {
-            self->query = Bytes_FromFormat(
-                "DECLARE \"%s\" CURSOR %s HOLD FOR %s",
-                self->name,
-                self->withhold ? "WITH" : "WITHOUT",
-                Bytes_AS_STRING(fquery));
-            Py_DECREF(fquery);
-        }
-        else {
-            self->query = fquery;
-        }
+    if (self->name != NULL) {
+        self->query = Bytes_FromFormat(
+            "DECLARE \"%s\" CURSOR %s HOLD FOR %s",
+            self->name,
+            self->withhold ? "WITH" : "WITHOUT",
+            Bytes_AS_STRING(fquery));
+        Py_DECREF(fquery);
+        if (!self->query) { goto exit; }
     }
     else {
-        if (self->name != NULL) {
-            self->query = Bytes_FromFormat(
-                "DECLARE \"%s\" CURSOR %s HOLD FOR %s",
-                self->name,
-                self->withhold ? "WITH" : "WITHOUT",
-                Bytes_AS_STRING(operation));
-        }
-        else {
-            /* Transfer reference ownership of the str in operation to
-               self->query, clearing the local variable to prevent cleanup from
-               DECREFing it */
-            self->query = operation;
-            operation = NULL;
-        }
+        self->query = fquery;
     }
 
     /* At this point, the SQL statement must be str, not unicode */
 
-    tmp = pq_execute(self, Bytes_AS_STRING(self->query), async);
+    tmp = pq_execute_params(
+        self, Bytes_AS_STRING(self->query), params, async);
     Dprintf("psyco_curs_execute: res = %d, pgres = %p", tmp, self->pgres);
     if (tmp < 0) { goto exit; }
 
@@ -443,7 +794,7 @@ exit:
        by the caller was overwritten with either NULL or a new
        reference */
     Py_XDECREF(operation);
-    Py_XDECREF(cvt);
+    Py_XDECREF(params);
 
     return res;
 }
@@ -558,9 +909,11 @@ static PyObject *
 _psyco_curs_mogrify(cursorObject *self,
                    PyObject *operation, PyObject *vars)
 {
-    PyObject *fquery = NULL, *cvt = NULL;
+    PyObject *fquery = NULL;
+    int merge = (vars && vars != Py_None);
 
-    operation = _psyco_curs_validate_sql_basic(self, operation);
+    /* the query encoded and parsed, or NULL */
+    operation = _psyco_curs_get_query(self, operation, merge);
     if (operation == NULL) { goto cleanup; }
 
     Dprintf("psyco_curs_mogrify: starting mogrify");
@@ -569,30 +922,16 @@ _psyco_curs_mogrify(cursorObject *self,
        objects to be substituted (bound variables). we try to be smart and do
        the right thing (i.e., what the user expects) */
 
-    if (vars && vars != Py_None)
-    {
-        if (0 > _mogrify(vars, operation, self, &cvt)) {
-            goto cleanup;
-        }
-    }
-
-    if (vars && cvt) {
-        if (!(fquery = _psyco_curs_merge_query_args(self, operation, cvt))) {
-            goto cleanup;
-        }
-
-        Dprintf("psyco_curs_mogrify: cvt->refcnt = " FORMAT_CODE_PY_SSIZE_T
-            ", fquery->refcnt = " FORMAT_CODE_PY_SSIZE_T,
-            Py_REFCNT(cvt), Py_REFCNT(fquery));
+    if (merge) {
+        fquery = _psyco_curs_merge_query(self, operation, vars, NULL);
     }
     else {
-        fquery = operation;
+        fquery = PyTuple_GET_ITEM(operation, 0);
         Py_INCREF(fquery);
     }
 
 cleanup:
     Py_XDECREF(operation);
-    Py_XDECREF(cvt);
 
     return fquery;
 }
@@ -664,9 +1003,86 @@ _psyco_curs_prefetch(cursorObject *self)
     return i;
 }
 
+/* Cast the values of the columns using a column typecaster.
+ *
+ * Return a tuple with a list of 'size' values starting from 'row' for each
+ * column using a column typecaster and None for the other columns. Return
+ * None if no column uses a column typecaster, NULL on error.
+ */
+static PyObject *
+_psyco_curs_cast_columns(cursorObject *self, int row, int size)
+{
+    int i, j, n;
+    const char **strs = NULL;
+    Py_ssize_t *lens = NULL;
+    PyObject *cols = NULL, *rv = NULL;
+
+    n = PQnfields(self->pgres);
+    for (i = 0; i < n; i++) {
+        if (((typecastObject *)PyTuple_GET_ITEM(self->casts, i))->column) {
+            break;
+        }
+    }
+    if (i == n) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    if (!(strs = PyMem_New(const char *, size))
+            || !(lens = PyMem_New(Py_ssize_t, size))) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+
+    if (!(cols = PyTuple_New(n))) { goto exit; }
+    for (i = 0; i < n; i++) {
+        PyObject *cast = PyTuple_GET_ITEM(self->casts, i);
+        PyObject *col;
+
+        if (!((typecastObject *)cast)->column) {
+            Py_INCREF(Py_None);
+            PyTuple_SET_ITEM(cols, i, Py_None);
+            continue;
+        }
+
+        for (j = 0; j < size; j++) {
+            if (PQgetisnull(self->pgres, row + j, i)) {
+                strs[j] = NULL;
+                lens[j] = 0;
+            }
+            else {
+                strs[j] = PQgetvalue(self->pgres, row + j, i);
+                lens[j] = PQgetlength(self->pgres, row + j, i);
+            }
+        }
+
+        Dprintf("_psyco_curs_cast_columns: column %d, rows %d", i, size);
+        if (!(col = typecast_cast_column(cast, strs, lens, size,
+                (PyObject *)self))) {
+            goto exit;
+        }
+        PyTuple_SET_ITEM(cols, i, col);
+    }
+
+    rv = cols;
+    cols = NULL;
+
+exit:
+    PyMem_Free(strs);
+    PyMem_Free(lens);
+    Py_XDECREF(cols);
+    return rv;
+}
+
+/* Fill a row with the values of the record 'row'.
+ *
+ * 'cols' is the result of _psyco_curs_cast_columns(), or NULL; 'colrow' is
+ * the position of the record in its lists.
+ */
 RAISES_NEG static int
 _psyco_curs_buildrow_fill(cursorObject *self, PyObject *res,
-                          int row, int n, int istuple)
+                          int row, int n, int istuple,
+                          PyObject *cols, int colrow)
 {
     int i, len, err;
     const char *str;
@@ -674,21 +1090,28 @@ _psyco_curs_buildrow_fill(cursorObject *self, PyObject *res,
     int rv = -1;
 
     for (i=0; i < n; i++) {
-        if (PQgetisnull(self->pgres, row, i)) {
-            str = NULL;
-            len = 0;
+        if (cols && PyTuple_GET_ITEM(cols, i) != Py_None) {
+            /* the value was already cast together with its column */
+            val = PyList_GET_ITEM(PyTuple_GET_ITEM(cols, i), colrow);
+            Py_INCREF(val);
         }
         else {
-            str = PQgetvalue(self->pgres, row, i);
-            len = PQgetlength(self->pgres, row, i);
-        }
+            if (PQgetisnull(self->pgres, row, i)) {
+                str = NULL;
+                len = 0;
+            }
+            else {
+                str = PQgetvalue(self->pgres, row, i);
+                len = PQgetlength(self->pgres, row, i);
+            }
 
-        Dprintf("_psyco_curs_buildrow: row %ld, element %d, len %d",
-                self->row, i, len);
+            Dprintf("_psyco_curs_buildrow: row %ld, element %d, len %d",
+                    self->row, i, len);
 
-        if (!(val = typecast_cast(PyTuple_GET_ITEM(self->casts, i), str, len,
-                            (PyObject*)self))) {
-            goto exit;
+            if (!(val = typecast_cast(PyTuple_GET_ITEM(self->casts, i),
+                                str, len, (PyObject*)self))) {
+                goto exit;
+            }
         }
 
         Dprintf("_psyco_curs_buildrow: val->refcnt = "
@@ -712,7 +1135,7 @@ exit:
 }
 
 static PyObject *
-_psyco_curs_buildrow(cursorObject *self, int row)
+_psyco_curs_buildrow(cursorObject *self, int row, PyObject *cols, int colrow)
 {
     int n;
     int istuple;
@@ -730,7 +1153,8 @@ _psyco_curs_buildrow(cursorObject *self, int row)
     }
     if (!t) { goto exit; }
 
-    if (0 <= _psyco_curs_buildrow_fill(self, t, row, n, istuple)) {
+    if (0 <= _psyco_curs_buildrow_fill(self, t, row, n, istuple,
+            cols, colrow)) {
         rv = t;
         t = NULL;
     }
@@ -770,7 +1194,7 @@ psyco_curs_fetchone(cursorObject *self, PyObject *args)
         return Py_None;
     }
 
-    res = _psyco_curs_buildrow(self, self->row);
+    res = _psyco_curs_buildrow(self, self->row, NULL, 0);
     self->row++; /* move the counter to next line */
 
     /* if the query was async aggresively free pgres, to allow
@@ -785,12 +1209,14 @@ psyco_curs_fetchone(cursorObject *self, PyObject *args)
 
 /* Efficient cursor.next() implementation for named cursors.
  *
- * Fetch several records at time. Return NULL when the cursor is exhausted.
+ * Fetch several records at time, casting the columns using a column
+ * typecaster once per batch. Return NULL when the cursor is exhausted.
  */
 static PyObject *
 psyco_curs_next_named(cursorObject *self)
 {
     PyObject *res;
+    PyObject *cols;
 
     Dprintf("psyco_curs_next_named");
     EXC_IF_CURS_CLOSED(self);
@@ -817,7 +1243,19 @@ psyco_curs_next_named(cursorObject *self)
         return NULL;
     }
 
-    res = _psyco_curs_buildrow(self, self->row);
+    /* the batch is dropped by curs_reset() when a new result arrives */
+    if (!self->itercols) {
+        if (!(self->itercols = _psyco_curs_cast_columns(self, self->row,
+                (int)(self->rowcount - self->row)))) {
+            return NULL;
+        }
+        self->itercols_row = self->row;
+    }
+    cols = self->itercols != Py_None && self->row >= self->itercols_row ?
+        self->itercols : NULL;
+
+    res = _psyco_curs_buildrow(self, self->row, cols,
+        (int)(self->row - self->itercols_row));
     self->row++; /* move the counter to next line */
 
     /* if the query was async aggresively free pgres, to allow
@@ -846,6 +1284,7 @@ psyco_curs_fetchmany(cursorObject *self, PyObject *args, PyObject *kwords)
     int i;
     PyObject *list = NULL;
     PyObject *row = NULL;
+    PyObject *cols = NULL;
     PyObject *rv = NULL;
 
     PyObject *pysize = NULL;
@@ -894,9 +1333,13 @@ psyco_curs_fetchmany(cursorObject *self, PyObject *args, PyObject *kwords)
     }
 
     if (!(list = PyList_New(size))) { goto exit; }
+    if (!(cols = _psyco_curs_cast_columns(self, self->row, size))) {
+        goto exit;
+    }
 
     for (i = 0; i < size; i++) {
-        row = _psyco_curs_buildrow(self, self->row);
+        row = _psyco_curs_buildrow(self, self->row,
+            cols != Py_None ? cols : NULL, i);
         self->row++;
 
         if (row == NULL) { goto exit; }
@@ -919,6 +1362,7 @@ psyco_curs_fetchmany(cursorObject *self, PyObject *args, PyObject *kwords)
 exit:
     Py_XDECREF(list);
     Py_XDECREF(row);
+    Py_XDECREF(cols);
 
     return rv;
 }
@@ -939,6 +1383,7 @@ psyco_curs_fetchall(cursorObject *self, PyObject *args)
     int i, size;
     PyObject *list = NULL;
     PyObject *row = NULL;
+    PyObject *cols = NULL;
     PyObject *rv = NULL;
 
     EXC_IF_CURS_CLOSED(self);
@@ -964,9 +1409,13 @@ psyco_curs_fetchall(cursorObject *self, PyObject *args)
     }
 
     if (!(list = PyList_New(size))) { goto exit; }
+    if (!(cols = _psyco_curs_cast_columns(self, self->row, size))) {
+        goto exit;
+    }
 
     for (i = 0; i < size; i++) {
-        row = _psyco_curs_buildrow(self, self->row);
+        row = _psyco_curs_buildrow(self, self->row,
+            cols != Py_None ? cols : NULL, i);
         self->row++;
         if (row == NULL) { goto exit; }
 
@@ -988,6 +1437,7 @@ psyco_curs_fetchall(cursorObject *self, PyObject *args)
 exit:
     Py_XDECREF(list);
     Py_XDECREF(row);
+    Py_XDECREF(cols);
 
     return rv;
 }
@@ -1749,6 +2199,7 @@ cursor_setup(cursorObject *self, connectionObject *conn, const char *name)
     self->lastoid = InvalidOid;
 
     self->casts = NULL;
+    self->itercols = NULL;
     self->notice = NULL;
 
     self->string_types = NULL;
@@ -1790,10 +2241,13 @@ cursor_dealloc(PyObject* obj)
 
     Py_CLEAR(self->conn);
     Py_CLEAR(self->casts);
+    Py_CLEAR(self->itercols);
     Py_CLEAR(self->description);
     Py_CLEAR(self->pgstatus);
     Py_CLEAR(self->tuple_factory);
     Py_CLEAR(self->tzinfo_factory);
+    Py_CLEAR(self->tzinfo_cache);
+    Py_CLEAR(self->tzinfo_cache_factory);
     Py_CLEAR(self->query);
     Py_CLEAR(self->string_types);
     Py_CLEAR(self->binary_types);
@@ -1865,10 +2319,13 @@ cursor_traverse(cursorObject *self, visitproc visit, void *arg)
     Py_VISIT(self->description);
     Py_VISIT(self->pgstatus);
     Py_VISIT(self->casts);
+    Py_VISIT(self->itercols);
     Py_VISIT(self->caster);
     Py_VISIT(self->copyfile);
     Py_VISIT(self->tuple_factory);
     Py_VISIT(self->tzinfo_factory);
+    Py_VISIT(self->tzinfo_cache);
+    Py_VISIT(self->tzinfo_cache_factory);
     Py_VISIT(self->query);
     Py_VISIT(self->string_types);
     Py_VISIT(self->binary_types);
@@ -30,19 +30,144 @@
 #include "psycopg/microprotocols_proto.h"
 #include "psycopg/cursor.h"
 #include "psycopg/connection.h"
+#include "psycopg/adapter_pint.h"
+#include "psycopg/adapter_pfloat.h"
+#include "psycopg/adapter_pboolean.h"
+#include "psycopg/adapter_qstring.h"
+#include "psycopg/adapter_binary.h"
 
 
 /** the adapters registry **/
 
 PyObject *psyco_adapters;
 
+/* The adapters resolved for ISQLQuote, by type: the adapter registered for
+ * the type or for its first superclass having one, or None if the object
+ * must adapt itself. The cache keeps the types alive, so it is dropped when
+ * it grows too much (think of classes generated in a loop). */
+static PyObject *psyco_adapters_cache;
+
+#define ADAPTERS_CACHE_MAX 500
+
+static void
+_clear_adapters_cache(void)
+{
+    if (psyco_adapters_cache) {
+        PyDict_Clear(psyco_adapters_cache);
+    }
+}
+
+/* The registry is a dict subclass invalidating the cache on every change,
+ * either done by register_adapter() or on the dict directly. */
+
+static PyMappingMethods adaptersObject_as_mapping;
+
+static int
+adapters_ass_subscript(PyObject *self, PyObject *key, PyObject *value)
+{
+    int rv = PyDict_Type.tp_as_mapping->mp_ass_subscript(self, key, value);
+    _clear_adapters_cache();
+    return rv;
+}
+
+/* call the dict method `name` and clear the cache */
+static PyObject *
+adapters_call_dict_method(PyObject *self, const char *name,
+                          PyObject *args, PyObject *kwargs)
+{
+    PyObject *descr, *meth, *rv;
+
+    if (!(descr = PyDict_GetItemString(PyDict_Type.tp_dict, name))) {
+        PyErr_SetString(PyExc_AttributeError, name);
+        return NULL;
+    }
+    if (!(meth = Py_TYPE(descr)->tp_descr_get(
+            descr, self, (PyObject *)Py_TYPE(self)))) {
+        return NULL;
+    }
+    rv = PyObject_Call(meth, args, kwargs);
+    Py_DECREF(meth);
+    _clear_adapters_cache();
+    return rv;
+}
+
+#define ADAPTERS_METHOD(name) \
+static PyObject * \
+adapters_ ## name(PyObject *self, PyObject *args, PyObject *kwargs) \
+{ \
+    return adapters_call_dict_method(self, #name, args, kwargs); \
+}
+
+ADAPTERS_METHOD(clear)
+ADAPTERS_METHOD(pop)
+ADAPTERS_METHOD(popitem)
+ADAPTERS_METHOD(setdefault)
+ADAPTERS_METHOD(update)
+
+#undef ADAPTERS_METHOD
+
+static struct PyMethodDef adaptersObject_methods[] = {
+    {"clear", (PyCFunction)adapters_clear, METH_VARARGS|METH_KEYWORDS, NULL},
+    {"pop", (PyCFunction)adapters_pop, METH_VARARGS|METH_KEYWORDS, NULL},
+    {"popitem", (PyCFunction)adapters_popitem,
+     METH_VARARGS|METH_KEYWORDS, NULL},
+    {"setdefault", (PyCFunction)adapters_setdefault,
+     METH_VARARGS|METH_KEYWORDS, NULL},
+    {"update", (PyCFunction)adapters_update, METH_VARARGS|METH_KEYWORDS, NULL},
+    {NULL}
+};
+
+static PyTypeObject adaptersType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "psycopg2._psycopg.Adapters",
+    sizeof(PyDictObject),
+    0,
+    0,          /*tp_dealloc*/
+    0,          /*tp_print*/
+    0,          /*tp_getattr*/
+    0,          /*tp_setattr*/
+    0,          /*tp_compare*/
+    0,          /*tp_repr*/
+    0,          /*tp_as_number*/
+    0,          /*tp_as_sequence*/
+    &adaptersObject_as_mapping, /*tp_as_mapping*/
+    0,          /*tp_hash */
+    0,          /*tp_call*/
+    0,          /*tp_str*/
+    0,          /*tp_getattro*/
+    0,          /*tp_setattro*/
+    0,          /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE, /*tp_flags*/
+    "The registry of the adapters", /*tp_doc*/
+    0,          /*tp_traverse*/
+    0,          /*tp_clear*/
+    0,          /*tp_richcompare*/
+    0,          /*tp_weaklistoffset*/
+    0,          /*tp_iter*/
+    0,          /*tp_iternext*/
+    adaptersObject_methods, /*tp_methods*/
+    0,          /*tp_members*/
+    0,          /*tp_getset*/
+    &PyDict_Type, /*tp_base*/
+};
+
 /* microprotocols_init - initialize the adapters dictionary */
 
 int
 microprotocols_init(PyObject *dict)
 {
+    /* the registry mapping methods are the dict ones, but the assignment */
+    adaptersObject_as_mapping = *PyDict_Type.tp_as_mapping;
+    adaptersObject_as_mapping.mp_ass_subscript = adapters_ass_subscript;
+
+    Py_TYPE(&adaptersType) = &PyType_Type;
+    if (PyType_Ready(&adaptersType) == -1) { return -1; }
+
+    if (!(psyco_adapters_cache = PyDict_New())) { return -1; }
+
     /* create adapters dictionary and put it in module namespace */
-    if ((psyco_adapters = PyDict_New()) == NULL) {
+    if ((psyco_adapters = PyObject_CallObject(
+            (PyObject *)&adaptersType, NULL)) == NULL) {
         return -1;
     }
 
@@ -68,6 +193,7 @@ microprotocols_add(PyTypeObject *type, PyObject *proto, PyObject *cast)
 
     if (!(key = PyTuple_Pack(2, (PyObject*)type, proto))) { goto exit; }
     if (0 != PyDict_SetItem(psyco_adapters, key, cast)) { goto exit; }
+    _clear_adapters_cache();
 
     rv = 0;
 
@@ -111,30 +237,64 @@ _get_superclass_adapter(PyObject *obj, PyObject *proto)
                 "microprotocols_adapt: using '%s' adapter to adapt '%s'",
                 ((PyTypeObject *)st)->tp_name, type->tp_name);
 
-            /* register this adapter as good for the subclass too,
-             * so that the next time it will be found in the fast path */
-
-            /* Well, no, maybe this is not a good idea.
-             * It would become a leak in case of dynamic
-             * classes generated in a loop (think namedtuples). */
-
-            /* key = PyTuple_Pack(2, (PyObject*)type, proto);
-             * PyDict_SetItem(psyco_adapters, key, adapter);
-             * Py_DECREF(key);
-             */
+            /* don't register this adapter as good for the subclass too:
+             * it would become a leak in case of dynamic classes generated
+             * in a loop (think namedtuples). The resolution cache is
+             * bounded instead. */
             return adapter;
         }
     }
     return Py_None;
 }
 
+/* Return the adapter registered for the type of `obj` or for its most
+ * specific superclass, or None if the object must adapt itself.
+ *
+ * Return a new reference, NULL on error. The adapters for ISQLQuote are
+ * cached by type, so in the common case this is a single lookup.
+ */
+static PyObject *
+_get_adapter(PyObject *obj, PyObject *proto)
+{
+    PyObject *type = (PyObject *)Py_TYPE(obj);
+    PyObject *adapter, *key;
+    int cache = (proto == (PyObject *)&isqlquoteType);
+
+    if (cache && (adapter = PyDict_GetItem(psyco_adapters_cache, type))) {
+        Py_INCREF(adapter);
+        return adapter;
+    }
+
+    /* look for an adapter in the registry */
+    if (!(key = PyTuple_Pack(2, type, proto))) { return NULL; }
+    adapter = PyDict_GetItem(psyco_adapters, key);
+    Py_DECREF(key);
+
+    /* Check if a superclass can be adapted and use the same adapter. */
+    if (!adapter && !(adapter = _get_superclass_adapter(obj, proto))) {
+        return NULL;
+    }
+
+    if (cache) {
+        if (PyDict_Size(psyco_adapters_cache) >= ADAPTERS_CACHE_MAX) {
+            PyDict_Clear(psyco_adapters_cache);
+        }
+        if (0 != PyDict_SetItem(psyco_adapters_cache, type, adapter)) {
+            return NULL;
+        }
+    }
+
+    Py_INCREF(adapter);
+    return adapter;
+}
+
 
 /* microprotocols_adapt - adapt an object to the built-in protocol */
 
 PyObject *
 microprotocols_adapt(PyObject *obj, PyObject *proto, PyObject *alt)
 {
-    PyObject *adapter, *adapted, *key, *meth;
+    PyObject *adapter, *adapted, *meth;
     char buffer[256];
 
     /* we don't check for exact type conformance as specified in PEP 246
@@ -144,26 +304,19 @@ microprotocols_adapt(PyObject *obj, PyObject *proto, PyObject *alt)
     Dprintf("microprotocols_adapt: trying to adapt %s",
         Py_TYPE(obj)->tp_name);
 
-    /* look for an adapter in the registry */
-    if (!(key = PyTuple_Pack(2, Py_TYPE(obj), proto))) { return NULL; }
-    adapter = PyDict_GetItem(psyco_adapters, key);
-    Py_DECREF(key);
-    if (adapter) {
-        adapted = PyObject_CallFunctionObjArgs(adapter, obj, NULL);
-        return adapted;
-    }
-
-    /* Check if a superclass can be adapted and use the same adapter. */
-    if (!(adapter = _get_superclass_adapter(obj, proto))) {
-        return NULL;
-    }
+    if (!(adapter = _get_adapter(obj, proto))) { return NULL; }
     if (Py_None != adapter) {
         adapted = PyObject_CallFunctionObjArgs(adapter, obj, NULL);
+        Py_DECREF(adapter);
         return adapted;
     }
+    Py_DECREF(adapter);
 
-    /* try to have the protocol adapt this object*/
-    if ((meth = PyObject_GetAttrString(proto, "__adapt__"))) {
+    /* try to have the protocol adapt this object: ISQLQuote can't */
+    if (proto == (PyObject *)&isqlquoteType) {
+        /* ISQLQuote.__adapt__ doesn't exist. */
+    }
+    else if ((meth = PyObject_GetAttrString(proto, "__adapt__"))) {
         adapted = PyObject_CallFunctionObjArgs(meth, obj, NULL);
         Py_DECREF(meth);
         if (adapted && adapted != Py_None) return adapted;
@@ -207,6 +360,114 @@ microprotocols_adapt(PyObject *obj, PyObject *proto, PyObject *alt)
     return NULL;
 }
 
+/* Return 1 if the type of obj is still adapted by the adapter `adapter`,
+ * 0 if the user has registered a different one, -1 on error. */
+int
+microprotocols_has_adapter(PyObject *obj, PyTypeObject *adapter)
+{
+    PyObject *cur;
+    int rv;
+
+    if (!(cur = _get_adapter(obj, (PyObject *)&isqlquoteType))) {
+        return -1;
+    }
+    rv = (cur == (PyObject *)adapter);
+    Py_DECREF(cur);
+
+    return rv;
+}
+
+/* _getquoted_builtin - quote the most common builtin types in C.
+ *
+ * Objects of exact type int, long, float, bool, str, unicode and (on
+ * Python 3) bytes are quoted without creating an adapter, producing the
+ * same result of the default adapters. If the user has registered a
+ * different adapter for the type, the object is left to the registry.
+ *
+ * Return the quoted bytes string, NULL on error or a new reference to
+ * Py_NotImplemented if the object must be adapted.
+ */
+static PyObject *
+_getquoted_builtin(PyObject *obj, connectionObject *conn)
+{
+    PyTypeObject *type = Py_TYPE(obj);
+    PyTypeObject *adapter;
+    PyObject *rv = NULL, *str = NULL;
+    char *s, *buffer;
+    Py_ssize_t len, qlen;
+
+    if (type == &PyBool_Type) { adapter = &pbooleanType; }
+#if PY_MAJOR_VERSION < 3
+    else if (type == &PyInt_Type) { adapter = &pintType; }
+    else if (type == &PyString_Type) { adapter = &qstringType; }
+#else
+    else if (type == &PyBytes_Type) { adapter = &binaryType; }
+#endif
+    else if (type == &PyLong_Type) { adapter = &pintType; }
+    else if (type == &PyFloat_Type) { adapter = &pfloatType; }
+    /* unicode needs the connection encoding, else it's not worth */
+    else if (type == &PyUnicode_Type && conn) { adapter = &qstringType; }
+    else { goto notimpl; }
+
+    switch (microprotocols_has_adapter(obj, adapter)) {
+    case 1:
+        break;
+    case 0:
+        goto notimpl;
+    default:
+        return NULL;
+    }
+
+    if (type == &PyBool_Type) {
+#ifdef PSYCOPG_NEW_BOOLEAN
+        return Bytes_FromString(obj == Py_True ? "true" : "false");
+#else
+        return Bytes_FromString(obj == Py_True ? "'t'" : "'f'");
+#endif
+    }
+
+    if (adapter == &pintType) {
+        return pint_quote(obj);
+    }
+
+    if (adapter == &pfloatType) {
+        return pfloat_quote(obj);
+    }
+
+#if PY_MAJOR_VERSION > 2
+    if (type == &PyBytes_Type) {
+        return binary_quote_buffer(
+            PyBytes_AS_STRING(obj), PyBytes_GET_SIZE(obj), conn);
+    }
+#endif
+
+    /* a string: encode it if unicode and escape it */
+    if (type == &PyUnicode_Type) {
+        if (!(str = conn_encode(conn, obj))) { goto exit; }
+    }
+    else {
+        Py_INCREF(obj);
+        str = obj;
+    }
+
+    Bytes_AsStringAndSize(str, &s, &len);
+    if (!(buffer = psycopg_escape_string(
+            (PyObject *)conn, s, len, NULL, &qlen))) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+    rv = Bytes_FromStringAndSize(buffer, qlen);
+    PyMem_Free(buffer);
+
+exit:
+    Py_XDECREF(str);
+    return rv;
+
+notimpl:
+    Py_INCREF(Py_NotImplemented);
+    return Py_NotImplemented;
+}
+
 /* microprotocol_getquoted - utility function that adapt and call getquoted.
  *
  * Return a bytes string, NULL on error.
@@ -219,6 +480,12 @@ microprotocol_getquoted(PyObject *obj, connectionObject *conn)
     PyObject *prepare = NULL;
     PyObject *adapted;
 
+    /* quote the most common builtins without going through an adapter */
+    if (!(res = _getquoted_builtin(obj, conn))) { return NULL; }
+    if (res != Py_NotImplemented) { return res; }
+    Py_DECREF(res);
+    res = NULL;
+
     if (!(adapted = microprotocols_adapt(obj, (PyObject*)&isqlquoteType, NULL))) {
        goto exit;
     }
@@ -251,9 +518,7 @@ microprotocol_getquoted(PyObject *obj, connectionObject *conn)
     /* Convert to bytes. */
     if (res && PyUnicode_CheckExact(res)) {
         PyObject *b;
-        const char *codec;
-        codec = (conn && conn->codec) ? conn->codec : "utf8";
-        b = PyUnicode_AsEncodedString(res, codec, NULL);
+        b = conn_encode(conn, res);
         Py_DECREF(res);
         res = b;
     }
@@ -52,6 +52,7 @@ HIDDEN int microprotocols_add(
 
 HIDDEN PyObject *microprotocols_adapt(
     PyObject *obj, PyObject *proto, PyObject *alt);
+HIDDEN int microprotocols_has_adapter(PyObject *obj, PyTypeObject *adapter);
 HIDDEN PyObject *microprotocol_getquoted(
     PyObject *obj, connectionObject *conn);
 
@@ -38,6 +38,7 @@
 #include "psycopg/green.h"
 #include "psycopg/typecast.h"
 #include "psycopg/pgtypes.h"
+#include "psycopg/adapter_binary.h"
 
 #include <string.h>
 
@@ -834,13 +835,123 @@ pq_flush(connectionObject *conn)
     return res;
 }
 
+/* the parameters of a query, in the arrays passed to libpq */
+
+typedef struct {
+    int n;
+    Oid *types;
+    const char **values;
+    int *lengths;
+    int *formats;
+    binarybuf *bufs;
+} pqparams;
+
+static void
+pq_params_free(pqparams *p)
+{
+    int i;
+
+    if (p->bufs) {
+        for (i = 0; i < p->n; i++) {
+            binary_buffer_release(&p->bufs[i]);
+        }
+    }
+    PyMem_Free(p->types);
+    PyMem_Free(p->values);
+    PyMem_Free(p->lengths);
+    PyMem_Free(p->formats);
+    PyMem_Free(p->bufs);
+}
+
+/* pq_params_init - fill the libpq arrays from a list of (oid, value)
+
+   The bytea values are passed in binary format pointing to the object
+   buffer, the other ones must be bytes and are passed in text format.
+   The buffers stay locked until pq_params_free() is called, so the
+   parameters can be sent without holding the GIL. */
+
+RAISES_NEG static int
+pq_params_init(pqparams *p, PyObject *params)
+{
+    PyObject *item, *obj;
+    int i;
+
+    memset(p, 0, sizeof(pqparams));
+    if (!params) { return 0; }
+
+    p->n = (int)PyList_GET_SIZE(params);
+    p->types = PyMem_Malloc(p->n * sizeof(Oid));
+    p->values = PyMem_Malloc(p->n * sizeof(char *));
+    p->lengths = PyMem_Malloc(p->n * sizeof(int));
+    p->formats = PyMem_Malloc(p->n * sizeof(int));
+    p->bufs = PyMem_Malloc(p->n * sizeof(binarybuf));
+    if (!(p->types && p->values && p->lengths && p->formats && p->bufs)) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    memset(p->bufs, 0, p->n * sizeof(binarybuf));
+
+    for (i = 0; i < p->n; i++) {
+        item = PyList_GET_ITEM(params, i);
+        p->types[i] = (Oid)PyInt_AsLong(PyTuple_GET_ITEM(item, 0));
+        obj = PyTuple_GET_ITEM(item, 1);
+
+        if (p->types[i] == BYTEAOID) {
+            if (0 > binary_buffer_get(obj, &p->bufs[i])) { goto error; }
+            p->values[i] = p->bufs[i].buf;
+            p->lengths[i] = (int)p->bufs[i].len;
+            p->formats[i] = 1;
+        }
+        else {
+            p->values[i] = Bytes_AS_STRING(obj);
+            p->lengths[i] = (int)Bytes_GET_SIZE(obj);
+            p->formats[i] = 0;
+        }
+    }
+
+    return 0;
+
+error:
+    pq_params_free(p);
+    memset(p, 0, sizeof(pqparams));
+    return -1;
+}
+
 /* pq_execute - execute a query, possibly asynchronously
 
    this fucntion locks the connection object
    this function call Py_*_ALLOW_THREADS macros */
 
+static int _pq_execute(cursorObject *curs, const char *query,
+                       pqparams *params, int async);
+
 RAISES_NEG int
 pq_execute(cursorObject *curs, const char *query, int async)
+{
+    return _pq_execute(curs, query, NULL, async);
+}
+
+/* pq_execute_params - execute a query with out-of-line parameters
+
+   params is a list of (oid, value) pairs, referred in the query as $1, $2...
+   or NULL to execute a plain query. Not supported by green connections. */
+
+RAISES_NEG int
+pq_execute_params(cursorObject *curs, const char *query, PyObject *params,
+                  int async)
+{
+    pqparams p;
+    int rv;
+
+    if (0 > pq_params_init(&p, params)) { return -1; }
+    rv = _pq_execute(curs, query, params ? &p : NULL, async);
+    pq_params_free(&p);
+    return rv;
+}
+
+static int
+_pq_execute(cursorObject *curs, const char *query, pqparams *params,
+            int async)
 {
     PGresult *pgres = NULL;
     char *error = NULL;
@@ -874,7 +985,12 @@ pq_execute(cursorObject *curs, const char *query, int async)
         IFCLEARPGRES(curs->pgres);
         Dprintf("pq_execute: executing SYNC query: pgconn = %p", curs->conn->pgconn);
         Dprintf("    %-.200s", query);
-        if (!psyco_green()) {
+        if (params) {
+            curs->pgres = PQexecParams(curs->conn->pgconn, query,
+                params->n, params->types, params->values, params->lengths,
+                params->formats, 0);
+        }
+        else if (!psyco_green()) {
             curs->pgres = PQexec(curs->conn->pgconn, query);
         }
         else {
@@ -911,7 +1027,11 @@ pq_execute(cursorObject *curs, const char *query, int async)
         Dprintf("    %-.200s", query);
 
         IFCLEARPGRES(curs->pgres);
-        if (PQsendQuery(curs->conn->pgconn, query) == 0) {
+        if (0 == (params
+                ? PQsendQueryParams(curs->conn->pgconn, query,
+                    params->n, params->types, params->values, params->lengths,
+                    params->formats, 0)
+                : PQsendQuery(curs->conn->pgconn, query))) {
             pthread_mutex_unlock(&(curs->conn->lock));
             Py_BLOCK_THREADS;
             PyErr_SetString(OperationalError,
@@ -1244,7 +1364,7 @@ _pq_copy_in_v3(cursorObject *curs)
         if (PyUnicode_Check(o)) {
             PyObject *tmp;
             Dprintf("_pq_copy_in_v3: encoding in %s", curs->conn->codec);
-            if (!(tmp = PyUnicode_AsEncodedString(o, curs->conn->codec, NULL))) {
+            if (!(tmp = conn_encode(curs->conn, o))) {
                 Dprintf("_pq_copy_in_v3: encoding() failed");
                 error = 1;
                 break;
@@ -1363,7 +1483,7 @@ _pq_copy_out_v3(cursorObject *curs)
 
         if (len > 0 && buffer) {
             if (is_text) {
-                obj = PyUnicode_Decode(buffer, len, curs->conn->codec, NULL);
+                obj = conn_decode(curs->conn, buffer, len);
             } else {
                 obj = Bytes_FromStringAndSize(buffer, len);
             }
@@ -116,6 +116,20 @@ typedef struct {
 /* the Decimal type, used by the DECIMAL typecaster */
 HIDDEN PyObject *psyco_GetDecimalType(void);
 
+/* the array.array type, used by the packed array typecasters */
+HIDDEN PyObject *psyco_GetArrayType(void);
+
+/* the json functions, used by the json typecasters and adapter */
+HIDDEN PyObject *psyco_GetJsonLoads(void);
+HIDDEN PyObject *psyco_GetJsonDumps(void);
+
+/* the uuid.UUID type and its is_safe default, used by the uuid typecaster */
+HIDDEN PyObject *psyco_GetUUIDType(void);
+HIDDEN PyObject *psyco_GetUUIDSafeUnknown(void);
+
+/* the ipaddress classes, used by the inet and cidr typecasters */
+HIDDEN PyObject *psyco_GetIPAddressTypes(void);
+
 /* forward declaration */
 typedef struct cursorObject cursorObject;
 
@@ -125,6 +139,7 @@ RAISES HIDDEN void psyco_set_error(PyObject *exc, cursorObject *curs, const char
 
 HIDDEN char *psycopg_escape_string(PyObject *conn,
               const char *from, Py_ssize_t len, char *to, Py_ssize_t *tolen);
+HIDDEN int psycopg_ascii_safe(PyObject *conn);
 HIDDEN char *psycopg_escape_identifier_easy(const char *from, Py_ssize_t len);
 HIDDEN int psycopg_strdup(char **to, const char *from, Py_ssize_t len);
 HIDDEN int psycopg_is_text_file(PyObject *f);
@@ -133,6 +148,14 @@ STEALS(1) HIDDEN PyObject * psycopg_ensure_bytes(PyObject *obj);
 
 STEALS(1) HIDDEN PyObject * psycopg_ensure_text(PyObject *obj);
 
+STEALS(1) HIDDEN PyObject * psycopg_quote_number(PyObject *str);
+
+HIDDEN int psycopg_simd_level(void);
+HIDDEN void psycopg_hex_encode(const unsigned char *from, Py_ssize_t len,
+              char *to);
+HIDDEN Py_ssize_t psycopg_hex_decode(const char *from, Py_ssize_t len,
+              char *to);
+
 /* Exceptions docstrings */
 #define Error_doc \
 "Base class for error exceptions."
@@ -44,6 +44,12 @@
 #include "psycopg/adapter_pdecimal.h"
 #include "psycopg/adapter_asis.h"
 #include "psycopg/adapter_list.h"
+#include "psycopg/adapter_hstore.h"
+#include "psycopg/adapter_sqlin.h"
+#include "psycopg/adapter_json.h"
+#include "psycopg/adapter_uuid.h"
+#include "psycopg/adapter_ipaddress.h"
+#include "psycopg/adapter_range.h"
 #include "psycopg/typecast_binary.h"
 
 #ifdef HAVE_MXDATETIME
@@ -123,7 +129,7 @@ psyco_connect(PyObject *self, PyObject *args, PyObject *keywds)
 "  * `conn_or_curs`: A connection, cursor or None"
 
 #define typecast_from_python_doc \
-"new_type(oids, name, castobj) -> new type object\n\n" \
+"new_type(oids, name, castobj, raw=False, column=False) -> new type object\n\n" \
 "Create a new binding object. The object can be used with the\n" \
 "`register_type()` function to bind PostgreSQL objects to python objects.\n\n" \
 ":Parameters:\n" \
@@ -132,7 +138,10 @@ psyco_connect(PyObject *self, PyObject *args, PyObject *keywds)
 "  * `adapter`: Callable to perform type conversion.\n" \
 "    It must have the signature ``fun(value, cur)`` where ``value`` is\n" \
 "    the string representation returned by PostgreSQL (`!None` if ``NULL``)\n" \
-"    and ``cur`` is the cursor from which data are read."
+"    and ``cur`` is the cursor from which data are read.\n" \
+"  * `raw`: If true pass ``value`` as bytes instead of string.\n" \
+"  * `column`: If true ``value`` is a list of values and the callable\n" \
+"    must return a list of objects of the same length."
 
 #define typecast_array_from_python_doc \
 "new_array_type(oids, name, baseobj) -> new type object\n\n" \
@@ -143,6 +152,38 @@ psyco_connect(PyObject *self, PyObject *args, PyObject *keywds)
 "  * `name`: Name for the new type\n" \
 "  * `baseobj`: Adapter to perform type conversion of a single array item."
 
+#define typecast_composite_from_python_doc \
+"new_composite_type(oids, name, atttypes, ctor) -> new type object\n\n" \
+"Create a new binding object to parse a composite type.\n\n" \
+"The object can be used with `register_type()`.\n\n" \
+":Parameters:\n" \
+"  * `oids`: Tuple of ``oid`` of the PostgreSQL types to convert.\n" \
+"  * `name`: Name for the new type\n" \
+"  * `atttypes`: Tuple of ``oid`` of the type attributes.\n" \
+"  * `ctor`: Callable receiving the attributes values and returning the\n" \
+"    Python object. If not specified the object will be a tuple."
+
+#define typecast_range_from_python_doc \
+"new_range_type(oids, name, subtype, ctor) -> new type object\n\n" \
+"Create a new binding object to parse a range type.\n\n" \
+"The object can be used with `register_type()`.\n\n" \
+":Parameters:\n" \
+"  * `oids`: Tuple of ``oid`` of the PostgreSQL types to convert.\n" \
+"  * `name`: Name for the new type\n" \
+"  * `subtype`: ``oid`` of the range subtype, used to cast the bounds.\n" \
+"  * `ctor`: Callable receiving lower, upper, bounds and returning the\n" \
+"    Python object. Empty ranges are created calling ``ctor(empty=True)``."
+
+#define typecast_json_from_python_doc \
+"new_json_type(oids, name, loads) -> new type object\n\n" \
+"Create a new binding object to parse json documents.\n\n" \
+"The object can be used with `register_type()`.\n\n" \
+":Parameters:\n" \
+"  * `oids`: Tuple of ``oid`` of the PostgreSQL types to convert.\n" \
+"  * `name`: Name for the new type\n" \
+"  * `loads`: Function to parse the json string. If not specified\n" \
+"    use `!json.loads()`."
+
 static PyObject *
 psyco_register_type(PyObject *self, PyObject *args)
 {
@@ -713,6 +754,211 @@ psyco_GetDecimalType(void)
 }
 
 
+/* psyco_GetArrayType
+
+   Return a new reference to the array.array type, used by the packed array
+   typecasters.
+*/
+
+PyObject *
+psyco_GetArrayType(void)
+{
+    static PyObject *cachedType = NULL;
+    PyObject *arrayType = NULL;
+    PyObject *array;
+
+    /* Use the cached object if running from the main interpreter. */
+    int can_cache = psyco_is_main_interp();
+    if (can_cache && cachedType) {
+        Py_INCREF(cachedType);
+        return cachedType;
+    }
+
+    if ((array = PyImport_ImportModule("array"))) {
+        arrayType = PyObject_GetAttrString(array, "array");
+        Py_DECREF(array);
+    }
+
+    /* Store the object from future uses. */
+    if (can_cache && !cachedType && arrayType) {
+        Py_INCREF(arrayType);
+        cachedType = arrayType;
+    }
+
+    return arrayType;
+}
+
+
+/* psyco_GetJsonLoads, psyco_GetJsonDumps
+
+   Return a new reference to the loads/dumps function of the json module, used
+   by the json typecasters and adapter. Fall back on simplejson if json is not
+   available.
+*/
+
+static PyObject *
+psyco_get_json_function(PyObject **cached, const char *name)
+{
+    PyObject *json, *func = NULL;
+
+    /* Use the cached object if running from the main interpreter. */
+    int can_cache = psyco_is_main_interp();
+    if (can_cache && *cached) {
+        Py_INCREF(*cached);
+        return *cached;
+    }
+
+    if (!(json = PyImport_ImportModule("json"))) {
+        if (!PyErr_ExceptionMatches(PyExc_ImportError)) { return NULL; }
+        PyErr_Clear();
+        if (!(json = PyImport_ImportModule("simplejson"))) { return NULL; }
+    }
+    func = PyObject_GetAttrString(json, name);
+    Py_DECREF(json);
+
+    /* Store the object from future uses. */
+    if (can_cache && !*cached && func) {
+        Py_INCREF(func);
+        *cached = func;
+    }
+
+    return func;
+}
+
+PyObject *
+psyco_GetJsonLoads(void)
+{
+    static PyObject *cachedFunc = NULL;
+    return psyco_get_json_function(&cachedFunc, "loads");
+}
+
+PyObject *
+psyco_GetJsonDumps(void)
+{
+    static PyObject *cachedFunc = NULL;
+    return psyco_get_json_function(&cachedFunc, "dumps");
+}
+
+
+/* psyco_GetUUIDType, psyco_GetUUIDSafeUnknown
+
+   Return a new reference to the uuid.UUID type and to the uuid.SafeUUID.unknown
+   value, used by the uuid typecaster to build the objects without calling
+   UUID.__init__(). SafeUUID is only available from Python 3.7: return None if
+   it is missing.
+*/
+
+PyObject *
+psyco_GetUUIDType(void)
+{
+    static PyObject *cachedType = NULL;
+    PyObject *uuidType = NULL;
+    PyObject *uuid;
+
+    /* Use the cached object if running from the main interpreter. */
+    int can_cache = psyco_is_main_interp();
+    if (can_cache && cachedType) {
+        Py_INCREF(cachedType);
+        return cachedType;
+    }
+
+    if ((uuid = PyImport_ImportModule("uuid"))) {
+        uuidType = PyObject_GetAttrString(uuid, "UUID");
+        Py_DECREF(uuid);
+    }
+
+    /* Store the object from future uses. */
+    if (can_cache && !cachedType && uuidType) {
+        Py_INCREF(uuidType);
+        cachedType = uuidType;
+    }
+
+    return uuidType;
+}
+
+PyObject *
+psyco_GetUUIDSafeUnknown(void)
+{
+    static PyObject *cachedValue = NULL;
+    PyObject *value = NULL;
+    PyObject *uuid, *safe;
+
+    /* Use the cached object if running from the main interpreter. */
+    int can_cache = psyco_is_main_interp();
+    if (can_cache && cachedValue) {
+        Py_INCREF(cachedValue);
+        return cachedValue;
+    }
+
+    if (!(uuid = PyImport_ImportModule("uuid"))) { return NULL; }
+    if ((safe = PyObject_GetAttrString(uuid, "SafeUUID"))) {
+        value = PyObject_GetAttrString(safe, "unknown");
+        Py_DECREF(safe);
+    }
+    else if (PyErr_ExceptionMatches(PyExc_AttributeError)) {
+        PyErr_Clear();
+        Py_INCREF(Py_None);
+        value = Py_None;
+    }
+    Py_DECREF(uuid);
+
+    /* Store the object from future uses. */
+    if (can_cache && !cachedValue && value) {
+        Py_INCREF(value);
+        cachedValue = value;
+    }
+
+    return value;
+}
+
+
+/* psyco_GetIPAddressTypes
+
+   Return a new reference to a tuple with the ipaddress classes IPv4Interface,
+   IPv6Interface, IPv4Network, IPv6Network, used by the inet and cidr
+   typecasters.
+*/
+
+PyObject *
+psyco_GetIPAddressTypes(void)
+{
+    static PyObject *cachedTypes = NULL;
+    PyObject *types = NULL;
+    PyObject *ipaddress;
+
+    /* Use the cached object if running from the main interpreter. */
+    int can_cache = psyco_is_main_interp();
+    if (can_cache && cachedTypes) {
+        Py_INCREF(cachedTypes);
+        return cachedTypes;
+    }
+
+    if ((ipaddress = PyImport_ImportModule("ipaddress"))) {
+        PyObject *v4i, *v6i, *v4n, *v6n;
+        v4i = PyObject_GetAttrString(ipaddress, "IPv4Interface");
+        v6i = PyObject_GetAttrString(ipaddress, "IPv6Interface");
+        v4n = PyObject_GetAttrString(ipaddress, "IPv4Network");
+        v6n = PyObject_GetAttrString(ipaddress, "IPv6Network");
+        if (v4i && v6i && v4n && v6n) {
+            types = PyTuple_Pack(4, v4i, v6i, v4n, v6n);
+        }
+        Py_XDECREF(v4i);
+        Py_XDECREF(v6i);
+        Py_XDECREF(v4n);
+        Py_XDECREF(v6n);
+        Py_DECREF(ipaddress);
+    }
+
+    /* Store the object from future uses. */
+    if (can_cache && !cachedTypes && types) {
+        Py_INCREF(types);
+        cachedTypes = types;
+    }
+
+    return types;
+}
+
+
 /* Create a namedtuple for cursor.description items
  *
  * Return None in case of expected errors (e.g. namedtuples not available)
@@ -768,6 +1014,12 @@ static PyMethodDef psycopgMethods[] = {
      METH_VARARGS|METH_KEYWORDS, typecast_from_python_doc},
     {"new_array_type", (PyCFunction)typecast_array_from_python,
      METH_VARARGS|METH_KEYWORDS, typecast_array_from_python_doc},
+    {"new_composite_type", (PyCFunction)typecast_composite_from_python,
+     METH_VARARGS|METH_KEYWORDS, typecast_composite_from_python_doc},
+    {"new_range_type", (PyCFunction)typecast_range_from_python,
+     METH_VARARGS|METH_KEYWORDS, typecast_range_from_python_doc},
+    {"new_json_type", (PyCFunction)typecast_json_from_python,
+     METH_VARARGS|METH_KEYWORDS, typecast_json_from_python_doc},
 
     {"AsIs",  (PyCFunction)psyco_AsIs,
      METH_VARARGS, psyco_AsIs_doc},
@@ -873,6 +1125,12 @@ INIT_MODULE(_psycopg)(void)
     Py_TYPE(&pdecimalType)   = &PyType_Type;
     Py_TYPE(&asisType)       = &PyType_Type;
     Py_TYPE(&listType)       = &PyType_Type;
+    Py_TYPE(&hstoreType)     = &PyType_Type;
+    Py_TYPE(&sqlinType)      = &PyType_Type;
+    Py_TYPE(&rangeType)      = &PyType_Type;
+    Py_TYPE(&jsonType)       = &PyType_Type;
+    Py_TYPE(&uuidType)       = &PyType_Type;
+    Py_TYPE(&ipaddressType)  = &PyType_Type;
     Py_TYPE(&chunkType)      = &PyType_Type;
     Py_TYPE(&NotifyType)     = &PyType_Type;
     Py_TYPE(&XidType)        = &PyType_Type;
@@ -889,6 +1147,12 @@ INIT_MODULE(_psycopg)(void)
     if (PyType_Ready(&pdecimalType) == -1) goto exit;
     if (PyType_Ready(&asisType) == -1) goto exit;
     if (PyType_Ready(&listType) == -1) goto exit;
+    if (PyType_Ready(&hstoreType) == -1) goto exit;
+    if (PyType_Ready(&sqlinType) == -1) goto exit;
+    if (PyType_Ready(&rangeType) == -1) goto exit;
+    if (PyType_Ready(&jsonType) == -1) goto exit;
+    if (PyType_Ready(&uuidType) == -1) goto exit;
+    if (PyType_Ready(&ipaddressType) == -1) goto exit;
     if (PyType_Ready(&chunkType) == -1) goto exit;
     if (PyType_Ready(&NotifyType) == -1) goto exit;
     if (PyType_Ready(&XidType) == -1) goto exit;
@@ -981,6 +1245,12 @@ INIT_MODULE(_psycopg)(void)
     PyModule_AddObject(module, "ISQLQuote", (PyObject*)&isqlquoteType);
     PyModule_AddObject(module, "Notify", (PyObject*)&NotifyType);
     PyModule_AddObject(module, "Xid", (PyObject*)&XidType);
+    PyModule_AddObject(module, "Hstore", (PyObject*)&hstoreType);
+    PyModule_AddObject(module, "SQL_IN", (PyObject*)&sqlinType);
+    PyModule_AddObject(module, "RangeAdapter", (PyObject*)&rangeType);
+    PyModule_AddObject(module, "Json", (PyObject*)&jsonType);
+    PyModule_AddObject(module, "Uuid", (PyObject*)&uuidType);
+    PyModule_AddObject(module, "IPAddress", (PyObject*)&ipaddressType);
 #ifdef PSYCOPG_EXTENSIONS
     PyModule_AddObject(module, "lobject", (PyObject*)&lobjectType);
 #endif
@@ -1021,6 +1291,12 @@ INIT_MODULE(_psycopg)(void)
     asisType.tp_alloc = PyType_GenericAlloc;
     qstringType.tp_alloc = PyType_GenericAlloc;
     listType.tp_alloc = PyType_GenericAlloc;
+    hstoreType.tp_alloc = PyType_GenericAlloc;
+    sqlinType.tp_alloc = PyType_GenericAlloc;
+    rangeType.tp_alloc = PyType_GenericAlloc;
+    jsonType.tp_alloc = PyType_GenericAlloc;
+    uuidType.tp_alloc = PyType_GenericAlloc;
+    ipaddressType.tp_alloc = PyType_GenericAlloc;
     chunkType.tp_alloc = PyType_GenericAlloc;
     pydatetimeType.tp_alloc = PyType_GenericAlloc;
     NotifyType.tp_alloc = PyType_GenericAlloc;
@@ -151,8 +151,6 @@ typedef unsigned long Py_uhash_t;
 
 #endif
 
-HIDDEN PyObject *Bytes_Format(PyObject *format, PyObject *args);
-
 /* Mangle the module name into the name of the module init function */
 #if PY_MAJOR_VERSION > 2
 #define INIT_MODULE(m) PyInit_ ## m
@@ -167,6 +167,120 @@ typecast_parse_time(const char* s, const char** t, Py_ssize_t* len,
     return cz;
 }
 
+/* Fast parsers for the values returned with DateStyle ISO, set by
+ * conn_setup. They only accept the exact formats emitted by the server and
+ * return -1 on anything else, leaving the caller to use the general parsers
+ * above (e.g. for BC dates or years after 9999).
+ */
+
+#define ISO_DIGIT(c) ((unsigned int)((unsigned char)(c) - '0'))
+
+/* Parse 'YYYY-MM-DD' into the arguments; return 0 or -1 if no match. */
+static int
+typecast_fast_parse_date(const char *s, Py_ssize_t len,
+                          int *year, int *month, int *day)
+{
+    unsigned int bad;
+
+    if (len != 10) { return -1; }
+
+    bad = (ISO_DIGIT(s[0]) > 9) | (ISO_DIGIT(s[1]) > 9)
+        | (ISO_DIGIT(s[2]) > 9) | (ISO_DIGIT(s[3]) > 9)
+        | (s[4] != '-') | (ISO_DIGIT(s[5]) > 9) | (ISO_DIGIT(s[6]) > 9)
+        | (s[7] != '-') | (ISO_DIGIT(s[8]) > 9) | (ISO_DIGIT(s[9]) > 9);
+    if (bad) { return -1; }
+
+    *year = ISO_DIGIT(s[0]) * 1000 + ISO_DIGIT(s[1]) * 100
+        + ISO_DIGIT(s[2]) * 10 + ISO_DIGIT(s[3]);
+    *month = ISO_DIGIT(s[5]) * 10 + ISO_DIGIT(s[6]);
+    *day = ISO_DIGIT(s[8]) * 10 + ISO_DIGIT(s[9]);
+    return 0;
+}
+
+/* Parse 'HH:MM:SS[.ffffff][+HH[:MM[:SS]]]' into the arguments.
+ *
+ * Return the number of fields parsed, with the same meaning of the return
+ * value of typecast_parse_time() (5 or more if there is a time zone), or -1
+ * if no match.
+ */
+static int
+typecast_fast_parse_time(const char *s, Py_ssize_t len,
+                          int *hh, int *mm, int *ss, int *us, int *tz)
+{
+    const char *end = s + len;
+    unsigned int bad;
+    int n = 3, usd = 0, tzsign, tzhh, tzmm = 0, tzss = 0;
+
+    if (len < 8) { return -1; }
+
+    bad = (ISO_DIGIT(s[0]) > 9) | (ISO_DIGIT(s[1]) > 9) | (s[2] != ':')
+        | (ISO_DIGIT(s[3]) > 9) | (ISO_DIGIT(s[4]) > 9) | (s[5] != ':')
+        | (ISO_DIGIT(s[6]) > 9) | (ISO_DIGIT(s[7]) > 9);
+    if (bad) { return -1; }
+
+    *hh = ISO_DIGIT(s[0]) * 10 + ISO_DIGIT(s[1]);
+    *mm = ISO_DIGIT(s[3]) * 10 + ISO_DIGIT(s[4]);
+    *ss = ISO_DIGIT(s[6]) * 10 + ISO_DIGIT(s[7]);
+    *us = *tz = 0;
+    s += 8;
+
+    if (s < end && *s == '.') {
+        for (s++; s < end && ISO_DIGIT(*s) <= 9 && usd < 6; s++, usd++) {
+            *us = *us * 10 + ISO_DIGIT(*s);
+        }
+        if (usd == 0) { return -1; }
+        while (usd++ < 6) { *us *= 10; }
+        n = 4;
+    }
+
+    if (s == end) { return n; }
+
+    /* time zone: sign and hours, then optional minutes and seconds */
+    if (end - s < 3 || (*s != '+' && *s != '-')
+            || ISO_DIGIT(s[1]) > 9 || ISO_DIGIT(s[2]) > 9) {
+        return -1;
+    }
+    tzsign = (*s == '-') ? -1 : 1;
+    tzhh = ISO_DIGIT(s[1]) * 10 + ISO_DIGIT(s[2]);
+    s += 3;
+    n = 5;
+
+    if (s < end) {
+        if (end - s < 3 || s[0] != ':'
+                || ISO_DIGIT(s[1]) > 9 || ISO_DIGIT(s[2]) > 9) {
+            return -1;
+        }
+        tzmm = ISO_DIGIT(s[1]) * 10 + ISO_DIGIT(s[2]);
+        s += 3;
+        n = 6;
+    }
+    if (s < end) {
+        if (end - s != 3 || s[0] != ':'
+                || ISO_DIGIT(s[1]) > 9 || ISO_DIGIT(s[2]) > 9) {
+            return -1;
+        }
+        tzss = ISO_DIGIT(s[1]) * 10 + ISO_DIGIT(s[2]);
+    }
+
+    *tz = tzsign * (3600 * tzhh + 60 * tzmm + tzss);
+    return n;
+}
+
+/* Parse 'YYYY-MM-DD HH:MM:SS...' into the arguments.
+ *
+ * Return the number of time fields parsed as typecast_fast_parse_time(),
+ * or -1 if no match.
+ */
+static int
+typecast_fast_parse_datetime(const char *s, Py_ssize_t len,
+                              int *year, int *month, int *day,
+                              int *hh, int *mm, int *ss, int *us, int *tz)
+{
+    if (len < 19 || s[10] != ' ') { return -1; }
+    if (0 != typecast_fast_parse_date(s, 10, year, month, day)) { return -1; }
+    return typecast_fast_parse_time(s + 11, len - 11, hh, mm, ss, us, tz);
+}
+
 /** include casting objects **/
 #include "psycopg/typecast_basic.c"
 #include "psycopg/typecast_binary.c"
@@ -177,6 +291,12 @@ typecast_parse_time(const char* s, const char** t, Py_ssize_t* len,
 #endif
 
 #include "psycopg/typecast_array.c"
+#include "psycopg/typecast_hstore.c"
+#include "psycopg/typecast_composite.c"
+#include "psycopg/typecast_range.c"
+#include "psycopg/typecast_json.c"
+#include "psycopg/typecast_uuid.c"
+#include "psycopg/typecast_inet.c"
 
 static long int typecast_default_DEFAULT[] = {0};
 static typecastObject_initlist typecast_default = {
@@ -219,6 +339,58 @@ static typecastObject_initlist typecast_pydatetime[] = {
     {NULL, NULL, NULL}
 };
 
+/* arrays of numbers into lists of array.array, not registered by default */
+static typecastObject_initlist typecast_packed[] = {
+    {"PACKEDINTEGERARRAY", typecast_INTEGERARRAY_types, typecast_PACKEDINTEGERARRAY_cast, "INTEGER"},
+    {"PACKEDLONGINTEGERARRAY", typecast_LONGINTEGERARRAY_types, typecast_PACKEDLONGINTEGERARRAY_cast, "LONGINTEGER"},
+    {"PACKEDFLOATARRAY", typecast_FLOATARRAY_types, typecast_PACKEDFLOATARRAY_cast, "FLOAT"},
+    {NULL, NULL, NULL}
+};
+
+#define typecast_DEC2FLOATARRAY_cast typecast_GENERIC_ARRAY_cast
+#define typecast_DEC2INTARRAY_cast typecast_GENERIC_ARRAY_cast
+
+/* alternative typecasters for numeric, not registered by default */
+static typecastObject_initlist typecast_decimal_alt[] = {
+    {"DEC2FLOAT", typecast_DECIMAL_types, typecast_DEC2FLOAT_cast},
+    {"DEC2INT", typecast_DECIMAL_types, typecast_DEC2INT_cast},
+    {"DEC2FLOATARRAY", typecast_DECIMALARRAY_types, typecast_DEC2FLOATARRAY_cast, "DEC2FLOAT"},
+    {"DEC2INTARRAY", typecast_DECIMALARRAY_types, typecast_DEC2INTARRAY_cast, "DEC2INT"},
+    {NULL, NULL, NULL}
+};
+
+/* hstore typecasters, registered by extras.register_hstore() */
+static typecastObject_initlist typecast_hstore[] = {
+    {"HSTORE", typecast_HSTORE_types, typecast_HSTORE_cast},
+    {"UNICODEHSTORE", typecast_HSTORE_types, typecast_UNICODEHSTORE_cast},
+    {NULL, NULL, NULL}
+};
+
+/* json typecasters, registered by default */
+static typecastObject_initlist typecast_json[] = {
+    {"JSON", typecast_JSON_types, typecast_JSON_cast},
+    {"JSONB", typecast_JSONB_types, typecast_JSONB_cast},
+    {"JSONARRAY", typecast_JSONARRAY_types, typecast_JSONARRAY_cast, "JSON"},
+    {"JSONBARRAY", typecast_JSONBARRAY_types, typecast_JSONBARRAY_cast, "JSONB"},
+    {NULL, NULL, NULL}
+};
+
+/* uuid typecasters, registered by extras.register_uuid() */
+static typecastObject_initlist typecast_uuid[] = {
+    {"UUID", typecast_UUID_types, typecast_UUID_cast},
+    {"UUIDARRAY", typecast_UUIDARRAY_types, typecast_UUIDARRAY_cast, "UUID"},
+    {NULL, NULL, NULL}
+};
+
+/* inet and cidr typecasters, registered by extras.register_ipaddress() */
+static typecastObject_initlist typecast_inet[] = {
+    {"INET", typecast_INET_types, typecast_INET_cast},
+    {"INETARRAY", typecast_INETARRAY_types, typecast_INETARRAY_cast, "INET"},
+    {"CIDR", typecast_CIDR_types, typecast_CIDR_cast},
+    {"CIDRARRAY", typecast_CIDRARRAY_types, typecast_CIDRARRAY_cast, "CIDR"},
+    {NULL, NULL, NULL}
+};
+
 #ifdef HAVE_MXDATETIME
 #define typecast_MXDATETIMEARRAY_cast typecast_GENERIC_ARRAY_cast
 #define typecast_MXDATEARRAY_cast typecast_GENERIC_ARRAY_cast
@@ -286,6 +458,61 @@ typecast_init(PyObject *dict)
     /* create and save a default cast object (but does not register it) */
     psyco_default_cast = typecast_from_c(&typecast_default, dict);
 
+    for (i = 0; typecast_packed[i].name != NULL; i++) {
+        Dprintf("typecast_init: initializing %s", typecast_packed[i].name);
+        t = (typecastObject *)typecast_from_c(&(typecast_packed[i]), dict);
+        if (t == NULL) { goto exit; }
+        PyDict_SetItem(dict, t->name, (PyObject *)t);
+        Py_DECREF((PyObject *)t);
+        t = NULL;
+    }
+
+    for (i = 0; typecast_decimal_alt[i].name != NULL; i++) {
+        Dprintf("typecast_init: initializing %s", typecast_decimal_alt[i].name);
+        t = (typecastObject *)typecast_from_c(&(typecast_decimal_alt[i]), dict);
+        if (t == NULL) { goto exit; }
+        PyDict_SetItem(dict, t->name, (PyObject *)t);
+        Py_DECREF((PyObject *)t);
+        t = NULL;
+    }
+
+    for (i = 0; typecast_hstore[i].name != NULL; i++) {
+        Dprintf("typecast_init: initializing %s", typecast_hstore[i].name);
+        t = (typecastObject *)typecast_from_c(&(typecast_hstore[i]), dict);
+        if (t == NULL) { goto exit; }
+        PyDict_SetItem(dict, t->name, (PyObject *)t);
+        Py_DECREF((PyObject *)t);
+        t = NULL;
+    }
+
+    for (i = 0; typecast_json[i].name != NULL; i++) {
+        Dprintf("typecast_init: initializing %s", typecast_json[i].name);
+        t = (typecastObject *)typecast_from_c(&(typecast_json[i]), dict);
+        if (t == NULL) { goto exit; }
+        if (typecast_add((PyObject *)t, NULL, 0) < 0) { goto exit; }
+        PyDict_SetItem(dict, t->name, (PyObject *)t);
+        Py_DECREF((PyObject *)t);
+        t = NULL;
+    }
+
+    for (i = 0; typecast_uuid[i].name != NULL; i++) {
+        Dprintf("typecast_init: initializing %s", typecast_uuid[i].name);
+        t = (typecastObject *)typecast_from_c(&(typecast_uuid[i]), dict);
+        if (t == NULL) { goto exit; }
+        PyDict_SetItem(dict, t->name, (PyObject *)t);
+        Py_DECREF((PyObject *)t);
+        t = NULL;
+    }
+
+    for (i = 0; typecast_inet[i].name != NULL; i++) {
+        Dprintf("typecast_init: initializing %s", typecast_inet[i].name);
+        t = (typecastObject *)typecast_from_c(&(typecast_inet[i]), dict);
+        if (t == NULL) { goto exit; }
+        PyDict_SetItem(dict, t->name, (PyObject *)t);
+        Py_DECREF((PyObject *)t);
+        t = NULL;
+    }
+
     /* register the date/time typecasters with their original names */
 #ifdef HAVE_MXDATETIME
     if (0 == psyco_typecast_mxdatetime_init()) {
@@ -425,6 +652,9 @@ typecast_dealloc(PyObject *obj)
     Py_CLEAR(self->name);
     Py_CLEAR(self->pcast);
     Py_CLEAR(self->bcast);
+    Py_CLEAR(self->atttypes);
+    Py_CLEAR(self->ctor);
+    Py_CLEAR(self->loads);
 
     Py_TYPE(obj)->tp_free(obj);
 }
@@ -438,6 +668,9 @@ typecast_traverse(PyObject *obj, visitproc visit, void *arg)
     Py_VISIT(self->name);
     Py_VISIT(self->pcast);
     Py_VISIT(self->bcast);
+    Py_VISIT(self->atttypes);
+    Py_VISIT(self->ctor);
+    Py_VISIT(self->loads);
     return 0;
 }
 
@@ -571,7 +804,13 @@ typecast_new(PyObject *name, PyObject *values, PyObject *cast, PyObject *base)
 
     obj->pcast = NULL;
     obj->ccast = NULL;
+    obj->raw = 0;
+    obj->column = 0;
     obj->bcast = base;
+    obj->atttypes = NULL;
+    obj->ctor = NULL;
+    obj->ctor_tuple = 0;
+    obj->loads = NULL;
 
     if (obj->bcast) Py_INCREF(obj->bcast);
 
@@ -592,17 +831,50 @@ PyObject *
 typecast_from_python(PyObject *self, PyObject *args, PyObject *keywds)
 {
     PyObject *v, *name = NULL, *cast = NULL, *base = NULL;
+    typecastObject *obj;
+    int raw = 0, column = 0;
 
-    static char *kwlist[] = {"values", "name", "castobj", "baseobj", NULL};
+    static char *kwlist[] = {"values", "name", "castobj", "baseobj",
+        "raw", "column", NULL};
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O!|O!OO", kwlist,
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O!|O!OOii", kwlist,
                                      &PyTuple_Type, &v,
                                      &Text_Type, &name,
-                                     &cast, &base)) {
+                                     &cast, &base, &raw, &column)) {
+        return NULL;
+    }
+
+    /* if the caster is implemented in C, call it directly on the data
+     * instead of going through the Python call */
+    if (cast && PyObject_TypeCheck(cast, &typecastType)
+            && ((typecastObject *)cast)->ccast) {
+        typecastObject *other = (typecastObject *)cast;
+
+        if (!base) { base = other->bcast; }
+        if ((obj = (typecastObject *)typecast_new(name, v, NULL, base))) {
+            obj->ccast = other->ccast;
+            Py_XINCREF(other->atttypes);
+            obj->atttypes = other->atttypes;
+            Py_XINCREF(other->ctor);
+            obj->ctor = other->ctor;
+            obj->ctor_tuple = other->ctor_tuple;
+            Py_XINCREF(other->loads);
+            obj->loads = other->loads;
+        }
+        return (PyObject *)obj;
+    }
+
+    if (column && !(cast && PyCallable_Check(cast))) {
+        PyErr_SetString(PyExc_TypeError,
+            "a column typecaster requires a callable castobj");
         return NULL;
     }
 
-    return typecast_new(name, v, cast, base);
+    if ((obj = (typecastObject *)typecast_new(name, v, cast, base))) {
+        obj->raw = raw;
+        obj->column = column;
+    }
+    return (PyObject *)obj;
 }
 
 PyObject *
@@ -628,6 +900,153 @@ typecast_array_from_python(PyObject *self, PyObject *args, PyObject *keywds)
     return (PyObject *)obj;
 }
 
+/* Return 1 if the instances of `ctor` can be built as the _make() method
+ * of a named tuple does, with no __new__ or __init__ to call.
+ *
+ * The first class defining __new__ in the mro must be the one created by
+ * namedtuple(), which defines _make too: a subclass may customize it.
+ */
+static int
+typecast_ctor_is_namedtuple(PyObject *ctor)
+{
+    PyTypeObject *type;
+    PyObject *mro, *dict;
+    Py_ssize_t i;
+
+    if (!PyType_Check(ctor)) { return 0; }
+    type = (PyTypeObject *)ctor;
+    if (!PyType_IsSubtype(type, &PyTuple_Type)
+            || type->tp_init != PyTuple_Type.tp_init) {
+        return 0;
+    }
+
+    mro = type->tp_mro;
+    for (i = 0; i < PyTuple_GET_SIZE(mro); i++) {
+        if (!PyType_Check(PyTuple_GET_ITEM(mro, i))) { continue; }
+        dict = ((PyTypeObject *)PyTuple_GET_ITEM(mro, i))->tp_dict;
+        if (PyDict_GetItemString(dict, "__new__")) {
+            return NULL != PyDict_GetItemString(dict, "_make");
+        }
+    }
+    return 0;
+}
+
+PyObject *
+typecast_composite_from_python(PyObject *self, PyObject *args, PyObject *keywds)
+{
+    PyObject *values, *name, *atttypes, *ctor = Py_None;
+    typecastObject *obj = NULL;
+    Py_ssize_t i;
+
+    static char *kwlist[] = {"values", "name", "atttypes", "ctor", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O!O!O!|O", kwlist,
+                                     &PyTuple_Type, &values,
+                                     &Text_Type, &name,
+                                     &PyTuple_Type, &atttypes,
+                                     &ctor)) {
+        return NULL;
+    }
+
+    for (i = 0; i < PyTuple_GET_SIZE(atttypes); i++) {
+        if (!PyInt_Check(PyTuple_GET_ITEM(atttypes, i))
+                && !PyLong_Check(PyTuple_GET_ITEM(atttypes, i))) {
+            PyErr_SetString(PyExc_TypeError, "atttypes must contain oids");
+            return NULL;
+        }
+    }
+
+    if (!(obj = (typecastObject *)typecast_new(name, values, NULL, NULL))) {
+        return NULL;
+    }
+
+    obj->ccast = typecast_COMPOSITE_cast;
+    Py_INCREF(atttypes);
+    obj->atttypes = atttypes;
+
+    /* named tuples are built as their _make() method does, with no call */
+    if (ctor != Py_None && ctor != (PyObject *)&PyTuple_Type) {
+        Py_INCREF(ctor);
+        obj->ctor = ctor;
+        obj->ctor_tuple = typecast_ctor_is_namedtuple(ctor);
+    }
+
+    return (PyObject *)obj;
+}
+
+PyObject *
+typecast_range_from_python(PyObject *self, PyObject *args, PyObject *keywds)
+{
+    PyObject *values, *name, *subtype, *ctor;
+    typecastObject *obj = NULL;
+
+    static char *kwlist[] = {"values", "name", "subtype", "ctor", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O!O!OO", kwlist,
+                                     &PyTuple_Type, &values,
+                                     &Text_Type, &name,
+                                     &subtype, &ctor)) {
+        return NULL;
+    }
+
+    if (!PyInt_Check(subtype) && !PyLong_Check(subtype)) {
+        PyErr_SetString(PyExc_TypeError, "subtype must be an oid");
+        return NULL;
+    }
+
+    if (!PyCallable_Check(ctor)) {
+        PyErr_SetString(PyExc_TypeError, "ctor must be a callable");
+        return NULL;
+    }
+
+    if (!(obj = (typecastObject *)typecast_new(name, values, NULL, NULL))) {
+        return NULL;
+    }
+
+    obj->ccast = typecast_RANGE_cast;
+    if (!(obj->atttypes = PyTuple_Pack(1, subtype))) {
+        Py_DECREF(obj);
+        return NULL;
+    }
+    Py_INCREF(ctor);
+    obj->ctor = ctor;
+
+    return (PyObject *)obj;
+}
+
+PyObject *
+typecast_json_from_python(PyObject *self, PyObject *args, PyObject *keywds)
+{
+    PyObject *values, *name, *loads = Py_None;
+    typecastObject *obj = NULL;
+
+    static char *kwlist[] = {"values", "name", "loads", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O!O!|O", kwlist,
+                                     &PyTuple_Type, &values,
+                                     &Text_Type, &name,
+                                     &loads)) {
+        return NULL;
+    }
+
+    if (loads != Py_None && !PyCallable_Check(loads)) {
+        PyErr_SetString(PyExc_TypeError, "loads must be a callable");
+        return NULL;
+    }
+
+    if (!(obj = (typecastObject *)typecast_new(name, values, NULL, NULL))) {
+        return NULL;
+    }
+
+    obj->ccast = typecast_JSON_cast;
+    if (loads != Py_None) {
+        Py_INCREF(loads);
+        obj->loads = loads;
+    }
+
+    return (PyObject *)obj;
+}
+
 PyObject *
 typecast_from_c(typecastObject_initlist *type, PyObject *dict)
 {
@@ -670,12 +1089,51 @@ typecast_from_c(typecastObject_initlist *type, PyObject *dict)
     return (PyObject *)obj;
 }
 
+/* Return the Python object passed to a Python typecaster for a value.
+ *
+ * The value is passed as a string, or as bytes if the typecaster was created
+ * with the 'raw' flag; NULL is passed as None.
+ */
+static PyObject *
+typecast_pcast_value(typecastObject *self, const char *str, Py_ssize_t len,
+                     PyObject *curs)
+{
+    /* XXX we have bytes in the adapters and strings in the typecasters.
+     * are you sure this is ok?
+     * Notice that this way it is about impossible to create a python
+     * typecaster on a binary type, unless it is created as raw. */
+    if (!str) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+#if PY_MAJOR_VERSION < 3
+    return PyString_FromStringAndSize(str, len);
+#else
+    if (self->raw) {
+        return Bytes_FromStringAndSize(str, len);
+    }
+    return conn_decode(((cursorObject *)curs)->conn, str, len);
+#endif
+}
+
 PyObject *
 typecast_cast(PyObject *obj, const char *str, Py_ssize_t len, PyObject *curs)
 {
     PyObject *old, *res = NULL;
     typecastObject *self = (typecastObject *)obj;
 
+    /* a column typecaster is called on a single value column */
+    if (self->column) {
+        PyObject *col;
+        if (!(col = typecast_cast_column(obj, &str, &len, 1, curs))) {
+            return NULL;
+        }
+        res = PyList_GET_ITEM(col, 0);
+        Py_INCREF(res);
+        Py_DECREF(col);
+        return res;
+    }
+
     Py_INCREF(obj);
     old = ((cursorObject*)curs)->caster;
     ((cursorObject*)curs)->caster = obj;
@@ -685,23 +1143,7 @@ typecast_cast(PyObject *obj, const char *str, Py_ssize_t len, PyObject *curs)
     }
     else if (self->pcast) {
         PyObject *s;
-        /* XXX we have bytes in the adapters and strings in the typecasters.
-         * are you sure this is ok?
-         * Notice that this way it is about impossible to create a python
-         * typecaster on a binary type. */
-        if (str) {
-#if PY_MAJOR_VERSION < 3
-            s = PyString_FromStringAndSize(str, len);
-#else
-            s = PyUnicode_Decode(str, len,
-                ((cursorObject *)curs)->conn->codec, NULL);
-#endif
-        }
-        else {
-            Py_INCREF(Py_None);
-            s = Py_None;
-        }
-        if (s) {
+        if ((s = typecast_pcast_value(self, str, len, curs))) {
             res = PyObject_CallFunctionObjArgs(self->pcast, s, curs, NULL);
             Py_DECREF(s);
         }
@@ -715,3 +1157,57 @@ typecast_cast(PyObject *obj, const char *str, Py_ssize_t len, PyObject *curs)
 
     return res;
 }
+
+/* Cast 'n' values at once using a column typecaster.
+ *
+ * The Python caster receives the list of the values and the cursor and must
+ * return a list of the same length. Return the list of the casted values.
+ */
+PyObject *
+typecast_cast_column(PyObject *obj,
+    const char **strs, const Py_ssize_t *lens, Py_ssize_t n, PyObject *curs)
+{
+    PyObject *old, *values = NULL, *res = NULL, *rv = NULL;
+    typecastObject *self = (typecastObject *)obj;
+    Py_ssize_t i;
+
+    if (!(values = PyList_New(n))) { return NULL; }
+    for (i = 0; i < n; i++) {
+        PyObject *s;
+        if (!(s = typecast_pcast_value(self, strs[i], lens[i], curs))) {
+            Py_DECREF(values);
+            return NULL;
+        }
+        PyList_SET_ITEM(values, i, s);
+    }
+
+    Py_INCREF(obj);
+    old = ((cursorObject*)curs)->caster;
+    ((cursorObject*)curs)->caster = obj;
+
+    res = PyObject_CallFunctionObjArgs(self->pcast, values, curs, NULL);
+
+    ((cursorObject*)curs)->caster = old;
+    Py_DECREF(obj);
+
+    if (!res) { goto exit; }
+    if (PyList_CheckExact(res)) {
+        rv = res;
+        res = NULL;
+    }
+    else if (!(rv = PySequence_List(res))) {
+        goto exit;
+    }
+
+    if (PyList_GET_SIZE(rv) != n) {
+        PyErr_Format(PyExc_ValueError,
+            "column typecaster returned %d values, %d expected",
+            (int)PyList_GET_SIZE(rv), (int)n);
+        Py_CLEAR(rv);
+    }
+
+exit:
+    Py_DECREF(values);
+    Py_XDECREF(res);
+    return rv;
+}
@@ -46,7 +46,17 @@ typedef struct {
 
     typecast_function  ccast;  /* the C casting function */
     PyObject          *pcast;  /* the python casting function */
+    int                raw;     /* pass bytes to pcast instead of strings */
+    int                column;  /* pcast receives and returns lists */
     PyObject          *bcast;  /* base cast, used by array typecasters */
+
+    /* used by composite and range typecasters */
+    PyObject *atttypes;  /* the oids of the attributes (range subtype) */
+    PyObject *ctor;      /* the callable to build the result */
+    int       ctor_tuple;  /* build the ctor instance as a tuple */
+
+    /* used by json typecasters */
+    PyObject *loads;     /* the function parsing the document, or NULL */
 } typecastObject;
 
 /* the initialization values are stored here */
@@ -82,9 +92,19 @@ HIDDEN PyObject *typecast_from_python(
     PyObject *self, PyObject *args, PyObject *keywds);
 HIDDEN PyObject *typecast_array_from_python(
     PyObject *self, PyObject *args, PyObject *keywds);
+HIDDEN PyObject *typecast_composite_from_python(
+    PyObject *self, PyObject *args, PyObject *keywds);
+HIDDEN PyObject *typecast_range_from_python(
+    PyObject *self, PyObject *args, PyObject *keywds);
+HIDDEN PyObject *typecast_json_from_python(
+    PyObject *self, PyObject *args, PyObject *keywds);
 
 /* the function used to dispatch typecasting calls */
 HIDDEN PyObject *typecast_cast(
     PyObject *self, const char *str, Py_ssize_t len, PyObject *curs);
 
+/* the function used to cast a column of values with a column typecaster */
+HIDDEN PyObject *typecast_cast_column(PyObject *self,
+    const char **strs, const Py_ssize_t *lens, Py_ssize_t n, PyObject *curs);
+
 #endif /* !defined(PSYCOPG_TYPECAST_H) */
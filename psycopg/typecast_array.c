@@ -56,10 +56,16 @@ typecast_array_cleanup(const char **str, Py_ssize_t *len)
 #define ASCAN_TOKEN  3
 #define ASCAN_QUOTED 4
 
+/* Return the next token of the array in 'str' from position 'pos'.
+ *
+ * Tokens containing escapes are unescaped into 'scratch', which must be at
+ * least as long as the string: it is reused for every token, so the caller
+ * must be done with a token before asking for the next one.
+ */
 static int
 typecast_array_tokenize(const char *str, Py_ssize_t strlength,
                         Py_ssize_t *pos, char** token,
-                        Py_ssize_t *length, int *quotes)
+                        Py_ssize_t *length, int *quotes, char *scratch)
 {
     /* FORTRAN glory */
     Py_ssize_t i, l;
@@ -134,11 +140,7 @@ typecast_array_tokenize(const char *str, Py_ssize_t strlength,
 
     if (res == ASCAN_QUOTED) {
         const char *j, *jj;
-        char *buffer = PyMem_Malloc(l+1);
-        if (buffer == NULL) {
-            PyErr_NoMemory();
-            return ASCAN_ERROR;
-        }
+        char *buffer = scratch;
 
         *token = buffer;
 
@@ -166,9 +168,27 @@ typecast_array_tokenize(const char *str, Py_ssize_t strlength,
     return res;
 }
 
+/* Cast a token with the base typecaster. */
+static PyObject *
+typecast_array_token(const char *token, Py_ssize_t length, int quotes,
+                     PyObject *curs, PyObject *base)
+{
+    if (!quotes && length == 4
+        && (token[0] == 'n' || token[0] == 'N')
+        && (token[1] == 'u' || token[1] == 'U')
+        && (token[2] == 'l' || token[2] == 'L')
+        && (token[3] == 'l' || token[3] == 'L'))
+    {
+        return typecast_cast(base, NULL, 0, curs);
+    } else {
+        return typecast_cast(base, token, length, curs);
+    }
+}
+
 RAISES_NEG static int
 typecast_array_scan(const char *str, Py_ssize_t strlength,
-                    PyObject *curs, PyObject *base, PyObject *array)
+                    PyObject *curs, PyObject *base, PyObject *array,
+                    char *scratch)
 {
     int state, quotes = 0;
     Py_ssize_t length = 0, pos = 0;
@@ -180,27 +200,17 @@ typecast_array_scan(const char *str, Py_ssize_t strlength,
     while (1) {
         token = NULL;
         state = typecast_array_tokenize(str, strlength,
-                                    &pos, &token, &length, &quotes);
+                            &pos, &token, &length, &quotes, scratch);
         Dprintf("typecast_array_scan: state = %d,"
                 " length = " FORMAT_CODE_PY_SSIZE_T ", token = '%s'",
                 state, length, token);
         if (state == ASCAN_TOKEN || state == ASCAN_QUOTED) {
             PyObject *obj;
-            if (!quotes && length == 4
-                && (token[0] == 'n' || token[0] == 'N')
-                && (token[1] == 'u' || token[1] == 'U')
-                && (token[2] == 'l' || token[2] == 'L')
-                && (token[3] == 'l' || token[3] == 'L'))
-            {
-                obj = typecast_cast(base, NULL, 0, curs);
-            } else {
-                obj = typecast_cast(base, token, length, curs);
+            if (!(obj = typecast_array_token(token, length, quotes,
+                    curs, base))) {
+                return -1;
             }
 
-            /* before anything else we free the memory */
-            if (state == ASCAN_QUOTED) PyMem_Free(token);
-            if (obj == NULL) return -1;
-
             PyList_Append(array, obj);
             Py_DECREF(obj);
         }
@@ -212,8 +222,10 @@ typecast_array_scan(const char *str, Py_ssize_t strlength,
             PyList_Append(array, sub);
             Py_DECREF(sub);
 
-            if (stack_index == MAX_DIMENSIONS)
+            if (stack_index == MAX_DIMENSIONS) {
+                PyErr_SetString(Error, "too many dimensions in array");
                 return -1;
+            }
 
             stack[stack_index++] = array;
             array = sub;
@@ -224,9 +236,11 @@ typecast_array_scan(const char *str, Py_ssize_t strlength,
         }
 
         else if (state == ASCAN_END) {
-            if (--stack_index < 0)
+            if (stack_index == 0) {
+                PyErr_SetString(Error, "unbalanced braces in array");
                 return -1;
-            array = stack[stack_index];
+            }
+            array = stack[--stack_index];
         }
 
         else if (state ==  ASCAN_EOF)
@@ -236,6 +250,122 @@ typecast_array_scan(const char *str, Py_ssize_t strlength,
     return 0;
 }
 
+/* Find the dimensions of the array in 'str', including the outer braces.
+ *
+ * PostgreSQL arrays are rectangular, so it is enough to count the items in
+ * the first sub-array of every level. Store the sizes in 'dims' and return
+ * the number of dimensions, or -1 if the string can't be sized.
+ */
+static int
+typecast_array_dims(const char *str, Py_ssize_t len, Py_ssize_t *dims)
+{
+    Py_ssize_t i;
+    int depth = 0, ndims = 0, counted = MAX_DIMENSIONS, q = 0;
+
+    for (i = 0; i < len && counted > 0; i++) {
+        if (q) {
+            /* inside quotes only look for the closing quote */
+            if (str[i] == '\\') { i++; }
+            else if (str[i] == '"') { q = 0; }
+            continue;
+        }
+
+        switch (str[i]) {
+        case '"':
+            q = 1;
+            break;
+
+        case '\\':
+            i++;
+            break;
+
+        case '{':
+            if (depth == ndims) {
+                if (ndims == MAX_DIMENSIONS) { return -1; }
+                dims[ndims++] = (i + 1 < len && str[i + 1] == '}') ? 0 : 1;
+            }
+            depth++;
+            break;
+
+        case '}':
+            /* the first sub-array closed at this level: its size is final */
+            if (--depth < counted) { counted = depth; }
+            break;
+
+        case ',':
+            if (depth - 1 < counted) { dims[depth - 1]++; }
+            break;
+        }
+    }
+
+    return (counted == 0) ? ndims : -1;
+}
+
+/* Scan the array into the pre-sized list 'array'.
+ *
+ * Return 0 on success, -1 on error, 1 if the items don't match the
+ * dimensions: in this case the caller should discard the list.
+ */
+RAISES_NEG static int
+typecast_array_scan_sized(const char *str, Py_ssize_t strlength,
+                    PyObject *curs, PyObject *base, PyObject *array,
+                    Py_ssize_t *dims, int ndims, char *scratch)
+{
+    int state, quotes = 0;
+    Py_ssize_t length = 0, pos = 0;
+    char *token;
+    PyObject *obj;
+
+    PyObject *stack[MAX_DIMENSIONS];
+    Py_ssize_t filled[MAX_DIMENSIONS];
+    int level = 0;
+
+    stack[0] = array;
+    filled[0] = 0;
+
+    while (1) {
+        state = typecast_array_tokenize(str, strlength,
+                            &pos, &token, &length, &quotes, scratch);
+
+        if (state == ASCAN_TOKEN || state == ASCAN_QUOTED) {
+            if (level != ndims - 1 || filled[level] >= dims[level]) {
+                return 1;
+            }
+            if (!(obj = typecast_array_token(token, length, quotes,
+                    curs, base))) {
+                return -1;
+            }
+            PyList_SET_ITEM(stack[level], filled[level]++, obj);
+        }
+
+        else if (state == ASCAN_BEGIN) {
+            if (level + 1 >= ndims || filled[level] >= dims[level]) {
+                return 1;
+            }
+            if (!(obj = PyList_New(dims[level + 1]))) { return -1; }
+            PyList_SET_ITEM(stack[level], filled[level]++, obj);
+
+            stack[++level] = obj;
+            filled[level] = 0;
+        }
+
+        else if (state == ASCAN_END) {
+            if (level == 0 || filled[level] != dims[level]) {
+                return 1;
+            }
+            level--;
+        }
+
+        else if (state == ASCAN_EOF) {
+            return (level == 0 && filled[0] == dims[0]) ? 0 : 1;
+        }
+
+        else {
+            return -1;
+        }
+    }
+}
+
 
 /** GENERIC - a generic typecaster that can be used when no special actions
     have to be taken on the single items **/
@@ -245,6 +375,10 @@ typecast_GENERIC_ARRAY_cast(const char *str, Py_ssize_t len, PyObject *curs)
 {
     PyObject *obj = NULL;
     PyObject *base = ((typecastObject*)((cursorObject*)curs)->caster)->bcast;
+    Py_ssize_t dims[MAX_DIMENSIONS];
+    int ndims, rv;
+    char stackbuf[256];
+    char *scratch, *heapbuf = NULL;
 
     Dprintf("typecast_GENERIC_ARRAY_cast: str = '%s',"
             " len = " FORMAT_CODE_PY_SSIZE_T, str, len);
@@ -260,25 +394,358 @@ typecast_GENERIC_ARRAY_cast(const char *str, Py_ssize_t len, PyObject *curs)
     Dprintf("typecast_GENERIC_ARRAY_cast: str = '%s',"
             " len = " FORMAT_CODE_PY_SSIZE_T, str, len);
 
-    if (!(obj = PyList_New(0))) { return NULL; }
+    /* a buffer to unescape the tokens into */
+    if (len < (Py_ssize_t)sizeof(stackbuf)) {
+        scratch = stackbuf;
+    }
+    else if (!(scratch = heapbuf = PyMem_Malloc(len + 1))) {
+        return PyErr_NoMemory();
+    }
+
+    /* scan the array skipping the first level of {}, into pre-sized lists
+     * if we can figure out its dimensions */
+    if (0 < (ndims = typecast_array_dims(str, len, dims))) {
+        if (!(obj = PyList_New(dims[0]))) { goto exit; }
+
+        rv = typecast_array_scan_sized(&str[1], len-2, curs, base, obj,
+            dims, ndims, scratch);
+        if (rv == 0) { goto exit; }
+
+        Py_CLEAR(obj);
+        if (rv < 0) { goto exit; }
+        Dprintf("typecast_GENERIC_ARRAY_cast: dimensions mismatch");
+    }
+
+    if (!(obj = PyList_New(0))) { goto exit; }
 
-    /* scan the array skipping the first level of {} */
-    if (typecast_array_scan(&str[1], len-2, curs, base, obj) < 0) {
+    if (typecast_array_scan(&str[1], len-2, curs, base, obj, scratch) < 0) {
         Py_CLEAR(obj);
     }
 
+exit:
+    PyMem_Free(heapbuf);
     return obj;
 }
 
+/** specialized parser for arrays of numbers and booleans **/
+
+/* The items of these arrays are never quoted: every row of items is
+ * delimited with memchr and its commas counted, so the lists are created
+ * with their final size and filled calling the item cast function directly.
+ * Strings that don't fit the expectations are handled by the GENERIC parser.
+ */
+
+typedef struct {
+    const char *s;          /* the current position in the string */
+    const char *end;        /* the end of the string */
+
+    typecast_function cast; /* the function to cast the items in lists */
+    char typecode;          /* or the array.array typecode for packed rows */
+    PyObject *arraytype;    /* the array.array type for packed rows */
+    PyObject *curs;
+
+    int bad;                /* set if the string can't be parsed here */
+} arrayParser;
+
+/* Find the end of a row of items starting at the parser position and count
+ * its items. Return the position of the closing '}' or NULL if the row is
+ * not made of plain items.
+ */
+static const char *
+typecast_array_row(arrayParser *ap, Py_ssize_t *size)
+{
+    const char *close, *p;
+    Py_ssize_t n = 1;
+    int odd = 0;
+
+    if (!(close = memchr(ap->s, '}', ap->end - ap->s))) { return NULL; }
+
+    /* a simple loop the compiler can vectorize */
+    for (p = ap->s; p < close; p++) {
+        n += (*p == ',');
+        odd |= (*p == '"') | (*p == '\\') | (*p == '{');
+    }
+    if (odd) { return NULL; }
+
+    *size = n;
+    return close;
+}
+
+/* Pack a row of numbers in an array.array with the parser typecode. */
+static PyObject *
+typecast_array_packed_row(arrayParser *ap)
+{
+    PyObject *rv = NULL;
+    PyObject *data;
+    char *buf;
+    char tmp[32];
+    const char *tok, *close;
+    char *end;
+    Py_ssize_t i, l, size, itemsize;
+    PY_LONG_LONG lval;
+    double dval;
+
+    if (!(close = typecast_array_row(ap, &size))) {
+        ap->bad = 1;
+        return NULL;
+    }
+
+    itemsize = (ap->typecode == 'd') ? (Py_ssize_t)sizeof(double)
+        : (ap->typecode == 'i') ? (Py_ssize_t)sizeof(int)
+        : (ap->typecode == 'l') ? (Py_ssize_t)sizeof(long)
+        : (Py_ssize_t)sizeof(PY_LONG_LONG);
+
+    if (!(data = Bytes_FromStringAndSize(NULL, size * itemsize))) {
+        return NULL;
+    }
+    buf = Bytes_AS_STRING(data);
+
+    for (i = 0; i < size; i++) {
+        for (tok = ap->s; ap->s < close && *ap->s != ','; ap->s++) {}
+        l = ap->s - tok;
+        ap->s++;    /* skip the comma, or the closing brace at the end */
+
+        if (l == 4 && 0 == strncmp(tok, "NULL", 4)) {
+            PyErr_SetString(DataError,
+                "can't store a NULL array item in array.array");
+            goto exit;
+        }
+
+        if (ap->typecode == 'd') {
+            if (0 == typecast_parse_double(tok, l, &dval)) {
+                ((double *)buf)[i] = dval;
+                continue;
+            }
+            if (l >= (Py_ssize_t)sizeof(tmp)) { ap->bad = 1; goto exit; }
+            memcpy(tmp, tok, l); tmp[l] = '\0';
+            dval = PyOS_string_to_double(tmp, &end, NULL);
+            if (end != tmp + l) {
+                PyErr_Clear();
+                ap->bad = 1;
+                goto exit;
+            }
+            ((double *)buf)[i] = dval;
+        }
+        else {
+            if (0 != typecast_parse_int(tok, l, &lval)) {
+                ap->bad = 1;
+                goto exit;
+            }
+            switch (ap->typecode) {
+            case 'i': ((int *)buf)[i] = (int)lval; break;
+            case 'l': ((long *)buf)[i] = (long)lval; break;
+            default: ((PY_LONG_LONG *)buf)[i] = lval; break;
+            }
+        }
+    }
+
+    rv = PyObject_CallFunction(ap->arraytype, "s#O",
+        &ap->typecode, (Py_ssize_t)1, data);
+
+exit:
+    Py_DECREF(data);
+    return rv;
+}
+
+/* Cast a row of items into a list with the parser cast function. */
+static PyObject *
+typecast_array_list_row(arrayParser *ap)
+{
+    PyObject *list;
+    PyObject *item;
+    const char *tok, *close;
+    Py_ssize_t i, size;
+
+    if (!(close = typecast_array_row(ap, &size))) {
+        ap->bad = 1;
+        return NULL;
+    }
+    if (!(list = PyList_New(size))) { return NULL; }
+
+    for (i = 0; i < size; i++) {
+        for (tok = ap->s; ap->s < close && *ap->s != ','; ap->s++) {}
+        if (ap->s - tok == 4 && 0 == strncmp(tok, "NULL", 4)) {
+            Py_INCREF(Py_None);
+            item = Py_None;
+        }
+        else if (ap->s == tok) {
+            ap->bad = 1;
+            goto error;
+        }
+        else if (!(item = ap->cast(tok, ap->s - tok, ap->curs))) {
+            goto error;
+        }
+        PyList_SET_ITEM(list, i, item);
+        ap->s++;    /* skip the comma, or the closing brace at the end */
+    }
+
+    return list;
+
+error:
+    Py_DECREF(list);
+    return NULL;
+}
+
+/* Parse a (sub-)array starting at the parser position. */
+static PyObject *
+typecast_array_parse_level(arrayParser *ap, int depth)
+{
+    PyObject *list = NULL;
+    PyObject *sub;
+
+    if (ap->s >= ap->end || *ap->s != '{' || depth >= MAX_DIMENSIONS) {
+        ap->bad = 1;
+        return NULL;
+    }
+    ap->s++;
+
+    /* empty array */
+    if (ap->s < ap->end && *ap->s == '}') {
+        ap->s++;
+        return ap->typecode
+            ? PyObject_CallFunction(ap->arraytype, "s#",
+                &ap->typecode, (Py_ssize_t)1)
+            : PyList_New(0);
+    }
+
+    /* a row of items */
+    if (ap->s < ap->end && *ap->s != '{') {
+        return ap->typecode
+            ? typecast_array_packed_row(ap) : typecast_array_list_row(ap);
+    }
+
+    /* a list of sub-arrays */
+    if (!(list = PyList_New(0))) { return NULL; }
+    while (1) {
+        if (!(sub = typecast_array_parse_level(ap, depth + 1))) {
+            goto error;
+        }
+        if (0 > PyList_Append(list, sub)) {
+            Py_DECREF(sub);
+            goto error;
+        }
+        Py_DECREF(sub);
+
+        if (ap->s < ap->end && *ap->s == ',') {
+            ap->s++;
+        }
+        else if (ap->s < ap->end && *ap->s == '}') {
+            ap->s++;
+            return list;
+        }
+        else {
+            ap->bad = 1;
+            goto error;
+        }
+    }
+
+error:
+    Py_XDECREF(list);
+    return NULL;
+}
+
+/* Parse an array of numbers or booleans into lists of 'cast' items, or into
+ * lists of array.array with the given typecode if 'typecode' is not 0.
+ *
+ * Return NULL with 'bad' set if the string should be handled by the GENERIC
+ * parser.
+ */
+static PyObject *
+typecast_array_parse(const char *str, Py_ssize_t len, PyObject *curs,
+                     typecast_function cast, char typecode, int *bad)
+{
+    PyObject *rv = NULL;
+    arrayParser ap;
+
+    if (str[0] == '[')
+        typecast_array_cleanup(&str, &len);
+
+    ap.s = str;
+    ap.end = str + len;
+    ap.cast = cast;
+    ap.typecode = typecode;
+    ap.arraytype = NULL;
+    ap.curs = curs;
+    ap.bad = 0;
+
+    if (typecode && !(ap.arraytype = psyco_GetArrayType())) {
+        return NULL;
+    }
+
+    rv = typecast_array_parse_level(&ap, 0);
+    if (rv && ap.s != ap.end) {
+        Py_CLEAR(rv);
+        ap.bad = 1;
+    }
+    if (ap.bad) {
+        PyErr_Clear();
+    }
+
+    Py_XDECREF(ap.arraytype);
+    *bad = ap.bad;
+    return rv;
+}
+
+#define TYPECAST_FAST_ARRAY(name, itemcast) \
+static PyObject * \
+typecast_##name##ARRAY_cast(const char *str, Py_ssize_t len, PyObject *curs) \
+{ \
+    PyObject *rv; \
+    int bad = 0; \
+    if (str == NULL) {Py_INCREF(Py_None); return Py_None;} \
+    rv = typecast_array_parse(str, len, curs, itemcast, 0, &bad); \
+    if (bad) { \
+        Dprintf("typecast_" #name "ARRAY_cast: using the generic parser"); \
+        return typecast_GENERIC_ARRAY_cast(str, len, curs); \
+    } \
+    return rv; \
+}
+
+TYPECAST_FAST_ARRAY(INTEGER, typecast_INTEGER_cast)
+TYPECAST_FAST_ARRAY(LONGINTEGER, typecast_LONGINTEGER_cast)
+TYPECAST_FAST_ARRAY(FLOAT, typecast_FLOAT_cast)
+TYPECAST_FAST_ARRAY(BOOLEAN, typecast_BOOLEAN_cast)
+
+/** PACKED - arrays of numbers into lists of array.array **/
+
+#define TYPECAST_PACKED_ARRAY(name, typecode) \
+static PyObject * \
+typecast_PACKED##name##ARRAY_cast(const char *str, Py_ssize_t len, \
+                                  PyObject *curs) \
+{ \
+    PyObject *rv; \
+    int bad = 0; \
+    if (str == NULL) {Py_INCREF(Py_None); return Py_None;} \
+    rv = typecast_array_parse(str, len, curs, NULL, typecode, &bad); \
+    if (bad) { \
+        PyErr_SetString(DataError, "unable to parse array"); \
+    } \
+    return rv; \
+}
+
+TYPECAST_PACKED_ARRAY(INTEGER, 'i')
+TYPECAST_PACKED_ARRAY(FLOAT, 'd')
+#if SIZEOF_LONG >= 8
+TYPECAST_PACKED_ARRAY(LONGINTEGER, 'l')
+#elif PY_VERSION_HEX >= 0x03030000
+TYPECAST_PACKED_ARRAY(LONGINTEGER, 'q')
+#else
+static PyObject *
+typecast_PACKEDLONGINTEGERARRAY_cast(const char *str, Py_ssize_t len,
+                                     PyObject *curs)
+{
+    if (str == NULL) {Py_INCREF(Py_None); return Py_None;}
+    PyErr_SetString(NotSupportedError,
+        "array.array can't store 64 bits integers on this platform");
+    return NULL;
+}
+#endif
+
 /** almost all the basic array typecasters are derived from GENERIC **/
 
-#define typecast_LONGINTEGERARRAY_cast typecast_GENERIC_ARRAY_cast
-#define typecast_INTEGERARRAY_cast typecast_GENERIC_ARRAY_cast
-#define typecast_FLOATARRAY_cast typecast_GENERIC_ARRAY_cast
 #define typecast_DECIMALARRAY_cast typecast_GENERIC_ARRAY_cast
 #define typecast_STRINGARRAY_cast typecast_GENERIC_ARRAY_cast
 #define typecast_UNICODEARRAY_cast typecast_GENERIC_ARRAY_cast
-#define typecast_BOOLEANARRAY_cast typecast_GENERIC_ARRAY_cast
 #define typecast_DATETIMEARRAY_cast typecast_GENERIC_ARRAY_cast
 #define typecast_DATEARRAY_cast typecast_GENERIC_ARRAY_cast
 #define typecast_TIMEARRAY_cast typecast_GENERIC_ARRAY_cast
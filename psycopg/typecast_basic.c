@@ -23,6 +23,46 @@
  * License for more details.
  */
 
+#include <float.h>
+
+/* Parse an optionally signed decimal integer from a buffer of known length.
+ *
+ * Return 0 and store the number in 'val' if the whole buffer was parsed and
+ * the number fits in a long long, else return -1 without setting an
+ * exception: the caller can fall back on the Python parser.
+ */
+static int
+typecast_parse_int(const char *s, Py_ssize_t len, PY_LONG_LONG *val)
+{
+    const char *end = s + len;
+    unsigned PY_LONG_LONG acc = 0;
+    int neg = 0;
+
+    if (len > 0) {
+        if (*s == '-') { neg = 1; s++; }
+        else if (*s == '+') { s++; }
+    }
+
+    /* up to 19 digits can't overflow the unsigned accumulator */
+    if (s == end || end - s > 19) { return -1; }
+
+    for (; s < end; s++) {
+        unsigned int d = (unsigned char)*s - '0';
+        if (d > 9) { return -1; }
+        acc = acc * 10 + d;
+    }
+
+    if (neg) {
+        if (acc > (unsigned PY_LONG_LONG)PY_LLONG_MAX + 1) { return -1; }
+        *val = acc ? -(PY_LONG_LONG)(acc - 1) - 1 : 0;
+    }
+    else {
+        if (acc > (unsigned PY_LONG_LONG)PY_LLONG_MAX) { return -1; }
+        *val = (PY_LONG_LONG)acc;
+    }
+    return 0;
+}
+
 /** INTEGER - cast normal integers (4 bytes) to python int **/
 
 #if PY_MAJOR_VERSION < 3
@@ -30,8 +70,18 @@ static PyObject *
 typecast_INTEGER_cast(const char *s, Py_ssize_t len, PyObject *curs)
 {
     char buffer[12];
+    PY_LONG_LONG val;
 
     if (s == NULL) {Py_INCREF(Py_None); return Py_None;}
+
+    /* PyInt_FromLong returns the small ints from the interpreter cache */
+    if (0 == typecast_parse_int(s, len, &val)) {
+        if (val >= LONG_MIN && val <= LONG_MAX) {
+            return PyInt_FromLong((long)val);
+        }
+        return PyLong_FromLongLong(val);
+    }
+
     if (s[len] != '\0') {
         strncpy(buffer, s, (size_t) len); buffer[len] = '\0';
         s = buffer;
@@ -48,8 +98,20 @@ static PyObject *
 typecast_LONGINTEGER_cast(const char *s, Py_ssize_t len, PyObject *curs)
 {
     char buffer[24];
+    PY_LONG_LONG val;
 
     if (s == NULL) {Py_INCREF(Py_None); return Py_None;}
+
+    if (0 == typecast_parse_int(s, len, &val)) {
+#if PY_MAJOR_VERSION > 2
+        /* PyLong_FromLong returns the small ints from the interpreter cache */
+        if (val >= LONG_MIN && val <= LONG_MAX) {
+            return PyLong_FromLong((long)val);
+        }
+#endif
+        return PyLong_FromLongLong(val);
+    }
+
     if (s[len] != '\0') {
         strncpy(buffer, s, (size_t) len); buffer[len] = '\0';
         s = buffer;
@@ -57,14 +119,100 @@ typecast_LONGINTEGER_cast(const char *s, Py_ssize_t len, PyObject *curs)
     return PyLong_FromString((char *)s, NULL, 0);
 }
 
+/* Parse a decimal number into a double, only if it can be done exactly.
+ *
+ * Numbers with up to 15 significant digits and a small exponent are exactly
+ * computed with a single multiplication or division between two doubles
+ * (Clinger's fast path). Return 0 and set 'val' on success, else -1 without
+ * setting an exception: the caller should use the slower correctly rounded
+ * parser.
+ */
+static int
+typecast_parse_double(const char *s, Py_ssize_t len, double *val)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *end = s + len;
+    PY_LONG_LONG mant = 0;
+    int neg = 0, ndigits = 0, exp = 0, eneg = 0, edigits = 0, e = 0;
+    double d;
+
+    if (s < end && (*s == '-' || *s == '+')) { neg = (*s++ == '-'); }
+
+    for (; s < end && (unsigned int)(*s - '0') <= 9; s++, ndigits++) {
+        mant = mant * 10 + (*s - '0');
+        if (ndigits >= 15) { return -1; }
+    }
+    if (s < end && *s == '.') {
+        for (s++; s < end && (unsigned int)(*s - '0') <= 9; s++, ndigits++) {
+            mant = mant * 10 + (*s - '0');
+            exp--;
+            if (ndigits >= 15) { return -1; }
+        }
+    }
+    if (ndigits == 0) { return -1; }
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        s++;
+        if (s < end && (*s == '-' || *s == '+')) { eneg = (*s++ == '-'); }
+        for (; s < end && (unsigned int)(*s - '0') <= 9; s++, edigits++) {
+            e = e * 10 + (*s - '0');
+            if (edigits >= 3) { return -1; }
+        }
+        if (edigits == 0) { return -1; }
+        exp += eneg ? -e : e;
+    }
+    if (s != end || exp < -22 || exp > 22) { return -1; }
+
+    d = (double)mant;
+    d = (exp < 0) ? d / pow10[-exp] : d * pow10[exp];
+    *val = neg ? -d : d;
+    return 0;
+#else
+    /* the intermediate results may be more precise than double */
+    return -1;
+#endif
+}
+
 /** FLOAT - cast floating point numbers to python float **/
 
 static PyObject *
 typecast_FLOAT_cast(const char *s, Py_ssize_t len, PyObject *curs)
 {
     PyObject *str = NULL, *flo = NULL;
+    double d;
+#if PY_VERSION_HEX >= 0x02070000
+    char buffer[32];
+    const char *p = s;
+    char *end;
+#endif
 
     if (s == NULL) {Py_INCREF(Py_None); return Py_None;}
+
+    if (0 == typecast_parse_double(s, len, &d)) {
+        return PyFloat_FromDouble(d);
+    }
+
+#if PY_VERSION_HEX >= 0x02070000
+    /* Parse the raw buffer: the values returned by libpq are terminated, the
+     * array elements usually need a copy on the stack. */
+    if (s[len] != '\0' && len < (Py_ssize_t)sizeof(buffer)) {
+        memcpy(buffer, s, (size_t) len); buffer[len] = '\0';
+        p = buffer;
+    }
+    if (p[len] == '\0') {
+        d = PyOS_string_to_double(p, &end, NULL);
+        if (end == p + len) {
+            if (d == -1.0 && PyErr_Occurred()) { return NULL; }
+            return PyFloat_FromDouble(d);
+        }
+        /* let Python deal with the garbage and raise the right error */
+        PyErr_Clear();
+    }
+#endif
+
     if (!(str = Text_FromUTF8AndSize(s, len))) { return NULL; }
 #if PY_MAJOR_VERSION < 3
     flo = PyFloat_FromString(str, NULL);
@@ -93,12 +241,9 @@ typecast_STRING_cast(const char *s, Py_ssize_t len, PyObject *curs)
 static PyObject *
 typecast_UNICODE_cast(const char *s, Py_ssize_t len, PyObject *curs)
 {
-    char *enc;
-
     if (s == NULL) {Py_INCREF(Py_None); return Py_None;}
 
-    enc = ((cursorObject*)curs)->conn->codec;
-    return PyUnicode_Decode(s, len, enc, NULL);
+    return conn_decode(((cursorObject*)curs)->conn, s, len);
 }
 
 /** BOOLEAN - cast boolean value into right python object **/
@@ -126,24 +271,71 @@ typecast_DECIMAL_cast(const char *s, Py_ssize_t len, PyObject *curs)
 {
     PyObject *res = NULL;
     PyObject *decimalType;
-    char *buffer;
+    PyObject *str;
 
     if (s == NULL) {Py_INCREF(Py_None); return Py_None;}
 
-    if ((buffer = PyMem_Malloc(len+1)) == NULL)
-        return PyErr_NoMemory();
-    strncpy(buffer, s, (size_t) len); buffer[len] = '\0';
-    decimalType = psyco_GetDecimalType();
     /* Fall back on float if decimal is not available */
-    if (decimalType != NULL) {
-        res = PyObject_CallFunction(decimalType, "s", buffer);
-        Py_DECREF(decimalType);
+    if (!(decimalType = psyco_GetDecimalType())) {
+        return typecast_FLOAT_cast(s, len, curs);
     }
-    else {
-        res = PyObject_CallFunction((PyObject*)&PyFloat_Type, "s", buffer);
+
+    /* Decimal parses the string as it is, NaN included: pass it the Python
+     * string straight away, no copy and no format to parse. */
+    if ((str = Text_FromUTF8AndSize(s, len))) {
+        res = PyObject_CallFunctionObjArgs(decimalType, str, NULL);
+        Py_DECREF(str);
     }
-    PyMem_Free(buffer);
+    Py_DECREF(decimalType);
+
+    return res;
+}
 
+/** DEC2FLOAT - cast numeric values into Python float **/
+
+#define typecast_DEC2FLOAT_cast typecast_FLOAT_cast
+
+/** DEC2INT - cast numeric values without fractional part into Python int **/
+
+static PyObject *
+typecast_DEC2INT_cast(const char *s, Py_ssize_t len, PyObject *curs)
+{
+    PyObject *res = NULL;
+    PyObject *str;
+    PY_LONG_LONG val;
+    Py_ssize_t i, j;
+
+    if (s == NULL) {Py_INCREF(Py_None); return Py_None;}
+
+    /* drop a fractional part made of zeros only, e.g. from numeric(10,2) */
+    for (i = 0; i < len && s[i] != '.'; i++) {}
+    for (j = i + 1; j < len && s[j] == '0'; j++) {}
+    if (j < len) {
+        PyErr_SetString(DataError,
+            "can't convert to int a numeric with fractional part");
+        return NULL;
+    }
+
+    /* NaN and, from PostgreSQL 14, the infinities have no int value */
+    j = (i > 0 && (s[0] == '-' || s[0] == '+'));
+    if (j >= i || s[j] < '0' || s[j] > '9') {
+        PyErr_SetString(DataError,
+            "can't convert to int a numeric NaN or infinity");
+        return NULL;
+    }
+
+    if (0 == typecast_parse_int(s, i, &val)) {
+        if (val >= LONG_MIN && val <= LONG_MAX) {
+            return PyInt_FromLong((long)val);
+        }
+        return PyLong_FromLongLong(val);
+    }
+
+    /* too large for a long long */
+    if ((str = Text_FromUTF8AndSize(s, i))) {
+        res = PyNumber_Long(str);
+        Py_DECREF(str);
+    }
     return res;
 }
 
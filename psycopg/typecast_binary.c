@@ -233,7 +233,16 @@ psycopg_parse_hex(const char *bufin, Py_ssize_t sizein, Py_ssize_t *sizeout)
      * user input (because we are parsing the output format of a buffer) so we
      * don't expect errors. On bad input we reserve the right to return a bad
      * output, not an error.
+     *
+     * The bulk of the well formed input is decoded by the vectorized kernel;
+     * the loop below takes care of the tail and of any unexpected char.
      */
+    {
+        Py_ssize_t done = psycopg_hex_decode(pi, bufend - pi, po);
+        pi += done;
+        po += done >> 1;
+    }
+
     while (pi < bufend) {
         char c;
         while (-1 == (c = hex_lut[*pi++ & '\x7f'])) {
@@ -0,0 +1,180 @@
+/* typecast_composite.c - composite types typecasters
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+/* Return the next attribute of the record in 's', stopping at 'end'.
+ *
+ * Return the pointer to the separator after the attribute, or NULL if the
+ * attribute is not well formed. An empty attribute is a NULL and is returned
+ * with 'tok' set to NULL. Quoted attributes are unescaped into 'scratch',
+ * which must be as long as the string scanned plus one.
+ */
+static const char *
+typecast_composite_token(const char *s, const char *end,
+                         const char **tok, Py_ssize_t *toklen, char *scratch)
+{
+    const char *start = s;
+    char *d = scratch;
+    int closed = 0;
+
+    if (s == end || *s == ',') {
+        /* empty attribute: NULL */
+        *tok = NULL;
+        *toklen = 0;
+        return s;
+    }
+
+    if (*s != '"') {
+        while (s < end && *s != ',') { s++; }
+        *tok = start;
+        *toklen = s - start;
+        return s;
+    }
+
+    /* quoted attribute: quotes are doubled, backslashes may escape */
+    for (s++; s < end; s++) {
+        if (*s == '"') {
+            if (s + 1 < end && s[1] == '"') {
+                *d++ = *++s;
+            }
+            else {
+                closed = 1;
+                s++;
+                break;
+            }
+        }
+        else if (*s == '\\') {
+            if (++s == end) { break; }
+            *d++ = *s;
+        }
+        else {
+            *d++ = *s;
+        }
+    }
+
+    /* the closing quote must be followed by the separator */
+    if (!closed || (s < end && *s != ',')) {
+        return NULL;
+    }
+
+    *d = '\0';
+    *tok = scratch;
+    *toklen = d - scratch;
+    return s;
+}
+
+/** COMPOSITE - cast a record into a tuple, using the attributes casters **/
+
+static PyObject *
+typecast_COMPOSITE_cast(const char *str, Py_ssize_t len, PyObject *curs)
+{
+    typecastObject *self =
+        (typecastObject *)((cursorObject*)curs)->caster;
+    PyObject *values = NULL, *args = NULL, *rv = NULL;
+    PyObject *cast, *val;
+    const char *s, *end, *tok;
+    Py_ssize_t toklen, nattrs, n, i;
+    char stackbuf[256];
+    char *scratch, *heapbuf = NULL;
+
+    if (str == NULL) { Py_INCREF(Py_None); return Py_None; }
+
+    if (len < 2 || str[0] != '(' || str[len - 1] != ')') {
+        PyErr_SetString(InterfaceError,
+            "can't parse type: the record is not in parens");
+        return NULL;
+    }
+
+    if (len < (Py_ssize_t)sizeof(stackbuf)) {
+        scratch = stackbuf;
+    }
+    else if (!(scratch = heapbuf = PyMem_Malloc(len + 1))) {
+        return PyErr_NoMemory();
+    }
+
+    /* count the attributes between the parens before casting any: a record
+     * of the wrong size is reported as such, not by a failing caster */
+    s = str + 1;
+    end = str + len - 1;
+    for (n = 1; ; n++) {
+        const char *start = s;
+        if (!(s = typecast_composite_token(s, end, &tok, &toklen, scratch))) {
+            PyErr_Format(InterfaceError,
+                "can't parse type: bad attribute at char %d",
+                (int)(start - str));
+            goto exit;
+        }
+        if (s == end) { break; }
+        s++;    /* the comma */
+    }
+
+    nattrs = PyTuple_GET_SIZE(self->atttypes);
+    if (n != nattrs) {
+        PyObject *name;
+        Py_INCREF(self->name);
+        if ((name = psycopg_ensure_bytes(self->name))) {
+            PyErr_Format(DataError,
+                "expecting %d components for the type %s, %d found instead",
+                (int)nattrs, Bytes_AS_STRING(name), (int)n);
+            Py_DECREF(name);
+        }
+        goto exit;
+    }
+
+    if (!(values = PyTuple_New(nattrs))) { goto exit; }
+    s = str + 1;
+    for (i = 0; i < nattrs; i++) {
+        s = typecast_composite_token(s, end, &tok, &toklen, scratch) + 1;
+
+        /* as in CompositeCaster.tokenize(), an empty quoted attribute is
+         * a NULL too */
+        if (!toklen) { tok = NULL; }
+
+        cast = curs_get_cast((cursorObject *)curs,
+            PyTuple_GET_ITEM(self->atttypes, i));
+        if (!(val = typecast_cast(cast, tok, toklen, curs))) {
+            goto exit;
+        }
+        PyTuple_SET_ITEM(values, i, val);
+    }
+
+    /* build the result */
+    if (!self->ctor) {
+        rv = values;
+        values = NULL;
+    }
+    else if (self->ctor_tuple) {
+        if (!(args = PyTuple_Pack(1, values))) { goto exit; }
+        rv = PyTuple_Type.tp_new((PyTypeObject *)self->ctor, args, NULL);
+    }
+    else {
+        rv = PyObject_Call(self->ctor, values, NULL);
+    }
+
+exit:
+    Py_XDECREF(values);
+    Py_XDECREF(args);
+    PyMem_Free(heapbuf);
+    return rv;
+}
@@ -40,6 +40,80 @@ psyco_typecast_datetime_init(void)
     return 0;
 }
 
+/* Return a new reference to the tzinfo for an offset in minutes.
+ *
+ * The objects returned by the cursor tzinfo_factory are cached on the cursor
+ * until the factory is changed, so the factory is called once per offset.
+ * The last tzinfo returned is checked first: the values in a result usually
+ * have the same offset (e.g. all UTC).
+ */
+static PyObject *
+typecast_get_tzinfo(cursorObject *curs, int offset)
+{
+    PyObject *key;
+    PyObject *tzinfo;
+
+    if (curs->tzinfo_cache_factory != curs->tzinfo_factory) {
+        curs->tzinfo_last = NULL;
+        Py_CLEAR(curs->tzinfo_cache);
+        Py_CLEAR(curs->tzinfo_cache_factory);
+    }
+    else if (curs->tzinfo_last && curs->tzinfo_last_offset == offset) {
+        Py_INCREF(curs->tzinfo_last);
+        return curs->tzinfo_last;
+    }
+
+    if (!curs->tzinfo_cache) {
+        if (!(curs->tzinfo_cache = PyDict_New())) { return NULL; }
+        Py_INCREF(curs->tzinfo_factory);
+        curs->tzinfo_cache_factory = curs->tzinfo_factory;
+    }
+
+    if (!(key = PyInt_FromLong(offset))) { return NULL; }
+    if ((tzinfo = PyDict_GetItem(curs->tzinfo_cache, key))) {
+        Py_INCREF(tzinfo);
+    }
+    else {
+        tzinfo = PyObject_CallFunction(curs->tzinfo_factory, "i", offset);
+        if (tzinfo && 0 > PyDict_SetItem(curs->tzinfo_cache, key, tzinfo)) {
+            Py_CLEAR(tzinfo);
+        }
+    }
+    Py_DECREF(key);
+
+    if (tzinfo) {
+        curs->tzinfo_last = tzinfo;
+        curs->tzinfo_last_offset = offset;
+    }
+    return tzinfo;
+}
+
+/* Return 1 if the values can be passed to the datetime C API constructors.
+ *
+ * Python 2 constructors don't validate their arguments, so we check them
+ * ourselves; on failure the caller goes through the Python constructor,
+ * which raises the appropriate error.
+ */
+static int
+typecast_datetime_valid(int y, int m, int d,
+        int hh, int mm, int ss, int us, PyObject *tzinfo)
+{
+    static const int mdays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    if (y < 1 || y > 9999 || m < 1 || m > 12 || d < 1) { return 0; }
+    if (d > mdays[m - 1]) {
+        if (!(m == 2 && d == 29
+                && y % 4 == 0 && (y % 100 != 0 || y % 400 == 0))) {
+            return 0;
+        }
+    }
+    if (hh < 0 || hh > 23 || mm < 0 || mm > 59 || ss < 0 || ss > 59
+            || us < 0 || us > 999999) {
+        return 0;
+    }
+    return tzinfo == Py_None || PyTZInfo_Check(tzinfo);
+}
+
 /** DATE - cast a date into a date python object **/
 
 static PyObject *
@@ -50,7 +124,13 @@ typecast_PYDATE_cast(const char *str, Py_ssize_t len, PyObject *curs)
 
     if (str == NULL) {Py_INCREF(Py_None); return Py_None;}
 
-    if (!strcmp(str, "infinity") || !strcmp(str, "-infinity")) {
+    /* most of the dates are in the ISO format: check for it first */
+    if (0 == typecast_fast_parse_date(str, len, &y, &m, &d)) {
+        n = 3;
+    }
+
+    else if ((len == 8 && !strncmp(str, "infinity", 8))
+            || (len == 9 && !strncmp(str, "-infinity", 9))) {
         if (str[0] == '-') {
             obj = PyObject_GetAttrString(
                 (PyObject*)PyDateTimeAPI->DateType, "min");
@@ -59,6 +139,7 @@ typecast_PYDATE_cast(const char *str, Py_ssize_t len, PyObject *curs)
             obj = PyObject_GetAttrString(
                 (PyObject*)PyDateTimeAPI->DateType, "max");
         }
+        return obj;
     }
 
     else {
@@ -67,12 +148,19 @@ typecast_PYDATE_cast(const char *str, Py_ssize_t len, PyObject *curs)
                 "n = %d, len = " FORMAT_CODE_PY_SSIZE_T ", "
                 "y = %d, m = %d, d = %d",
                  n, len, y, m, d);
-        if (n != 3) {
-            PyErr_SetString(DataError, "unable to parse date");
-            return NULL;
+    }
+
+    if (n != 3) {
+        PyErr_SetString(DataError, "unable to parse date");
+        return NULL;
+    }
+    else {
+        if (y > 9999) y = 9999;
+        if (typecast_datetime_valid(y, m, d, 0, 0, 0, 0, Py_None)) {
+            obj = PyDateTimeAPI->Date_FromDate(
+                y, m, d, PyDateTimeAPI->DateType);
         }
         else {
-            if (y > 9999) y = 9999;
             obj = PyObject_CallFunction(
                 (PyObject*)PyDateTimeAPI->DateType, "iii", y, m, d);
         }
@@ -94,8 +182,16 @@ typecast_PYDATETIME_cast(const char *str, Py_ssize_t len, PyObject *curs)
 
     if (str == NULL) {Py_INCREF(Py_None); return Py_None;}
 
+    /* most of the timestamps are in the ISO format: check for it first */
+    n = typecast_fast_parse_datetime(str, len,
+        &y, &m, &d, &hh, &mm, &ss, &us, &tz);
+    if (n >= 0) {
+        Dprintf("typecast_PYDATETIME_cast: ISO fast path, n = %d", n);
+    }
+
     /* check for infinity */
-    if (!strcmp(str, "infinity") || !strcmp(str, "-infinity")) {
+    else if ((len == 8 && !strncmp(str, "infinity", 8))
+            || (len == 9 && !strncmp(str, "-infinity", 9))) {
         if (str[0] == '-') {
             obj = PyObject_GetAttrString(
                 (PyObject*)PyDateTimeAPI->DateTimeType, "min");
@@ -104,6 +200,7 @@ typecast_PYDATETIME_cast(const char *str, Py_ssize_t len, PyObject *curs)
             obj = PyObject_GetAttrString(
                 (PyObject*)PyDateTimeAPI->DateTimeType, "max");
         }
+        return obj;
     }
 
     else {
@@ -129,40 +226,46 @@ typecast_PYDATETIME_cast(const char *str, Py_ssize_t len, PyObject *curs)
                 return NULL;
             }
         }
+    }
 
-        if (ss > 59) {
-            mm += 1;
-            ss -= 60;
-        }
-        if (y > 9999)
-            y = 9999;
-
-        tzinfo_factory = ((cursorObject *)curs)->tzinfo_factory;
-        if (n >= 5 && tzinfo_factory != Py_None) {
-            /* we have a time zone, calculate minutes and create
-               appropriate tzinfo object calling the factory */
-            Dprintf("typecast_PYDATETIME_cast: UTC offset = %ds", tz);
-
-            /* The datetime module requires that time zone offsets be
-               a whole number of minutes, so truncate the seconds to the
-               closest minute. */
-            // printf("%d %d %d\n", tz, tzmin, round(tz / 60.0));
-            tzinfo = PyObject_CallFunction(tzinfo_factory, "i",
-                (int)round(tz / 60.0));
-        } else {
-            Py_INCREF(Py_None);
-            tzinfo = Py_None;
+    if (ss > 59) {
+        mm += 1;
+        ss -= 60;
+    }
+    if (y > 9999)
+        y = 9999;
+
+    tzinfo_factory = ((cursorObject *)curs)->tzinfo_factory;
+    if (n >= 5 && tzinfo_factory != Py_None) {
+        /* we have a time zone, calculate minutes and create
+           appropriate tzinfo object calling the factory */
+        Dprintf("typecast_PYDATETIME_cast: UTC offset = %ds", tz);
+
+        /* The datetime module requires that time zone offsets be
+           a whole number of minutes, so truncate the seconds to the
+           closest minute. */
+        tzinfo = typecast_get_tzinfo((cursorObject *)curs,
+            (int)round(tz / 60.0));
+    } else {
+        Py_INCREF(Py_None);
+        tzinfo = Py_None;
+    }
+    if (tzinfo != NULL) {
+        if (typecast_datetime_valid(y, m, d, hh, mm, ss, us, tzinfo)) {
+            obj = PyDateTimeAPI->DateTime_FromDateAndTime(
+                y, m, d, hh, mm, ss, us, tzinfo,
+                PyDateTimeAPI->DateTimeType);
         }
-        if (tzinfo != NULL) {
+        else {
             obj = PyObject_CallFunction(
                 (PyObject*)PyDateTimeAPI->DateTimeType, "iiiiiiiO",
                 y, m, d, hh, mm, ss, us, tzinfo);
-            Dprintf("typecast_PYDATETIME_cast: tzinfo: %p, refcnt = "
-                FORMAT_CODE_PY_SSIZE_T,
-                tzinfo, Py_REFCNT(tzinfo)
-              );
-            Py_DECREF(tzinfo);
         }
+        Dprintf("typecast_PYDATETIME_cast: tzinfo: %p, refcnt = "
+            FORMAT_CODE_PY_SSIZE_T,
+            tzinfo, Py_REFCNT(tzinfo)
+          );
+        Py_DECREF(tzinfo);
     }
     return obj;
 }
@@ -179,7 +282,9 @@ typecast_PYTIME_cast(const char *str, Py_ssize_t len, PyObject *curs)
 
     if (str == NULL) {Py_INCREF(Py_None); return Py_None;}
 
-    n = typecast_parse_time(str, NULL, &len, &hh, &mm, &ss, &us, &tz);
+    if (0 > (n = typecast_fast_parse_time(str, len, &hh, &mm, &ss, &us, &tz))) {
+        n = typecast_parse_time(str, NULL, &len, &hh, &mm, &ss, &us, &tz);
+    }
     Dprintf("typecast_PYTIME_cast: n = %d, len = " FORMAT_CODE_PY_SSIZE_T ", "
             "hh = %d, mm = %d, ss = %d, us = %d, tz = %d",
             n, len, hh, mm, ss, us, tz);
@@ -201,15 +306,22 @@ typecast_PYTIME_cast(const char *str, Py_ssize_t len, PyObject *curs)
         /* The datetime module requires that time zone offsets be
            a whole number of minutes, so truncate the seconds to the
            closest minute. */
-        tzinfo = PyObject_CallFunction(tzinfo_factory, "i",
+        tzinfo = typecast_get_tzinfo((cursorObject *)curs,
             (int)round(tz / 60.0));
     } else {
         Py_INCREF(Py_None);
         tzinfo = Py_None;
     }
     if (tzinfo != NULL) {
-        obj = PyObject_CallFunction((PyObject*)PyDateTimeAPI->TimeType, "iiiiO",
-                                    hh, mm, ss, us, tzinfo);
+        if (typecast_datetime_valid(1, 1, 1, hh, mm, ss, us, tzinfo)) {
+            obj = PyDateTimeAPI->Time_FromTime(
+                hh, mm, ss, us, tzinfo, PyDateTimeAPI->TimeType);
+        }
+        else {
+            obj = PyObject_CallFunction(
+                (PyObject*)PyDateTimeAPI->TimeType, "iiiiO",
+                hh, mm, ss, us, tzinfo);
+        }
         Py_DECREF(tzinfo);
     }
     return obj;
@@ -0,0 +1,199 @@
+/* typecast_hstore.c - hstore typecasters
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+/* hstore has no fixed oid: the typecasters are registered with the oids
+ * found in the database by extras.register_hstore() */
+static long int typecast_HSTORE_types[] = {0};
+
+#define HSTORE_ISSPACE(c) \
+    ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r' \
+        || (c) == '\f' || (c) == '\v')
+
+/* Scan a quoted hstore string starting after the opening quote in 's'.
+ *
+ * Return the pointer past the closing quote, or NULL if the string is not
+ * terminated. The content is returned in 'tok', 'toklen': if it contains
+ * escapes it is unescaped into 'scratch', which must be as long as the
+ * string scanned.
+ */
+static const char *
+typecast_hstore_token(const char *s, const char *end,
+                      const char **tok, Py_ssize_t *toklen, char *scratch)
+{
+    const char *start = s;
+    char *d = NULL;
+
+    for (; s < end; s++) {
+        if (*s == '"') {
+            if (d) {
+                *tok = scratch;
+                *toklen = d - scratch;
+            }
+            else {
+                *tok = start;
+                *toklen = s - start;
+            }
+            return s + 1;
+        }
+        else if (*s == '\\') {
+            if (!d) {
+                memcpy(scratch, start, s - start);
+                d = scratch + (s - start);
+            }
+            if (++s == end) { break; }
+            *d++ = *s;
+        }
+        else if (d) {
+            *d++ = *s;
+        }
+    }
+
+    return NULL;
+}
+
+static PyObject *
+typecast_hstore_string(const char *s, Py_ssize_t len, PyObject *curs,
+                       int unicode)
+{
+    if (unicode) {
+        return conn_decode(((cursorObject*)curs)->conn, s, len);
+    }
+    else {
+        return Bytes_FromStringAndSize(s, len);
+    }
+}
+
+/* Parse the hstore representation '"k"=>"v", "k2"=>NULL' into a dict */
+static PyObject *
+typecast_hstore_parse(const char *str, Py_ssize_t len, PyObject *curs,
+                      int unicode)
+{
+    PyObject *rv = NULL, *key = NULL, *val = NULL;
+    const char *s = str, *end = str + len, *tok, *pair = str;
+    Py_ssize_t toklen;
+    char stackbuf[256];
+    char *scratch, *heapbuf = NULL;
+
+    if (str == NULL) { Py_INCREF(Py_None); return Py_None; }
+
+    if (len < (Py_ssize_t)sizeof(stackbuf)) {
+        scratch = stackbuf;
+    }
+    else if (!(scratch = heapbuf = PyMem_Malloc(len))) {
+        return PyErr_NoMemory();
+    }
+
+    if (!(rv = PyDict_New())) { goto exit; }
+
+    while (s < end) {
+        pair = s;
+
+        /* the key: a quoted string */
+        if (*s != '"') { goto error; }
+        if (!(s = typecast_hstore_token(s + 1, end, &tok, &toklen, scratch))) {
+            goto error;
+        }
+        if (!(key = typecast_hstore_string(tok, toklen, curs, unicode))) {
+            goto fail;
+        }
+
+        /* the separator */
+        while (s < end && HSTORE_ISSPACE(*s)) { s++; }
+        if (end - s < 2 || s[0] != '=' || s[1] != '>') { goto error; }
+        s += 2;
+        while (s < end && HSTORE_ISSPACE(*s)) { s++; }
+
+        /* the value: a quoted string or NULL */
+        if (s < end && *s == '"') {
+            if (!(s = typecast_hstore_token(
+                    s + 1, end, &tok, &toklen, scratch))) {
+                goto error;
+            }
+            if (!(val = typecast_hstore_string(tok, toklen, curs, unicode))) {
+                goto fail;
+            }
+        }
+        else if (end - s >= 4 && 0 == strncmp(s, "NULL", 4)) {
+            s += 4;
+            Py_INCREF(Py_None);
+            val = Py_None;
+        }
+        else {
+            goto error;
+        }
+
+        if (0 != PyDict_SetItem(rv, key, val)) { goto fail; }
+        Py_CLEAR(key);
+        Py_CLEAR(val);
+
+        /* pairs are separated by a comma */
+        while (s < end && HSTORE_ISSPACE(*s)) { s++; }
+        if (s < end) {
+            if (*s != ',') {
+                PyErr_Format(InterfaceError,
+                    "error parsing hstore: unparsed data after char %d",
+                    (int)(s - str));
+                goto fail;
+            }
+            s++;
+            while (s < end && HSTORE_ISSPACE(*s)) { s++; }
+        }
+    }
+
+    goto exit;
+
+error:
+    PyErr_Format(InterfaceError,
+        "error parsing hstore pair at char %d", (int)(pair - str));
+
+fail:
+    Py_CLEAR(rv);
+    Py_XDECREF(key);
+    Py_XDECREF(val);
+
+exit:
+    PyMem_Free(heapbuf);
+    return rv;
+}
+
+/** HSTORE - parse an hstore into a dict of strings **/
+
+static PyObject *
+typecast_HSTORE_cast(const char *str, Py_ssize_t len, PyObject *curs)
+{
+#if PY_MAJOR_VERSION < 3
+    return typecast_hstore_parse(str, len, curs, 0);
+#else
+    return typecast_hstore_parse(str, len, curs, 1);
+#endif
+}
+
+/** UNICODEHSTORE - parse an hstore into a dict of unicode strings **/
+
+static PyObject *
+typecast_UNICODEHSTORE_cast(const char *str, Py_ssize_t len, PyObject *curs)
+{
+    return typecast_hstore_parse(str, len, curs, 1);
+}
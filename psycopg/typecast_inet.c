@@ -0,0 +1,231 @@
+/* typecast_inet.c - inet and cidr typecasters
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+
+/* inet and cidr typecasters are registered by extras.register_ipaddress() */
+static long int typecast_INET_types[] = {869, 0};
+static long int typecast_INETARRAY_types[] = {1041, 0};
+static long int typecast_CIDR_types[] = {650, 0};
+static long int typecast_CIDRARRAY_types[] = {651, 0};
+
+#if PY_VERSION_HEX >= 0x03050000
+
+/* Parse a dotted quad IPv4 address into 'addr'.
+ *
+ * Return the pointer past the address, NULL if it is not well formed.
+ */
+static const char *
+typecast_inet_parse_v4(const char *s, const char *end, unsigned char *addr)
+{
+    int i, n, digits;
+
+    for (i = 0; i < 4; i++) {
+        if (i && (s == end || *s++ != '.')) { return NULL; }
+        for (n = 0, digits = 0; s < end && *s >= '0' && *s <= '9'; s++) {
+            if (++digits > 3) { return NULL; }
+            n = n * 10 + (*s - '0');
+        }
+        /* leave leading zeros to the ipaddress module to judge */
+        if (!digits || n > 255 || (digits > 1 && s[-digits] == '0')) {
+            return NULL;
+        }
+        addr[i] = (unsigned char)n;
+    }
+
+    return s;
+}
+
+/* Parse an IPv6 address, possibly compressed or with an embedded IPv4
+ * address in the last 32 bits, into 'addr'.
+ *
+ * Return the pointer past the address, NULL if it is not well formed.
+ */
+static const char *
+typecast_inet_parse_v6(const char *s, const char *end, unsigned char *addr)
+{
+    const char *group;
+    int ngroups = 0, gap = -1, digits, tail;
+    unsigned char c;
+    unsigned int g;
+
+    if (end - s >= 2 && s[0] == ':' && s[1] == ':') {
+        gap = 0;
+        s += 2;
+    }
+
+    while (!(gap == ngroups && (s == end || *s == '/'))) {
+        group = s;
+        for (g = 0, digits = 0; s < end; s++, digits++) {
+            c = (unsigned char)hex_lut[*s & '\x7f'];
+            if (c > 15 || (*s & '\x80')) { break; }
+            g = (g << 4) | c;
+        }
+
+        /* the last 32 bits written as IPv4 */
+        if (s < end && *s == '.') {
+            if (ngroups > 6) { return NULL; }
+            if (!(s = typecast_inet_parse_v4(group, end, addr + 2 * ngroups))) {
+                return NULL;
+            }
+            ngroups += 2;
+            break;
+        }
+
+        if (!digits || digits > 4 || ngroups == 8) { return NULL; }
+        addr[2 * ngroups] = (unsigned char)(g >> 8);
+        addr[2 * ngroups + 1] = (unsigned char)(g & 0xff);
+        ngroups++;
+
+        if (s == end || *s == '/') { break; }
+        if (*s++ != ':') { return NULL; }
+        if (s < end && *s == ':') {
+            if (gap >= 0) { return NULL; }
+            gap = ngroups;
+            s++;
+        }
+    }
+
+    /* expand the :: into the missing zero groups */
+    if (gap >= 0) {
+        if (ngroups > 7) { return NULL; }
+        tail = 2 * (ngroups - gap);
+        memmove(addr + 16 - tail, addr + 2 * gap, tail);
+        memset(addr + 2 * gap, 0, 16 - tail - 2 * gap);
+    }
+    else if (ngroups != 8) {
+        return NULL;
+    }
+
+    return s;
+}
+
+/* Parse the address and build the object passing the class the tuple
+ * (address as int, prefix length), which is much faster than letting the
+ * ipaddress module parse the string.
+ *
+ * Return NULL with no exception set if the string was not parsed.
+ */
+static PyObject *
+typecast_ipaddress_fast(const char *str, Py_ssize_t len, int v6,
+                        PyObject *type)
+{
+    const char *s, *end = str + len;
+    unsigned char addr[16];
+    int prefix, digits;
+    PyObject *i, *args;
+
+    if (!(s = v6 ? typecast_inet_parse_v6(str, end, addr)
+            : typecast_inet_parse_v4(str, end, addr))) {
+        return NULL;
+    }
+
+    prefix = v6 ? 128 : 32;
+    if (s < end && *s == '/') {
+        for (s++, prefix = 0, digits = 0; s < end && *s >= '0' && *s <= '9';
+                s++) {
+            if (++digits > 3) { return NULL; }
+            prefix = prefix * 10 + (*s - '0');
+        }
+        if (!digits || prefix > (v6 ? 128 : 32)
+                || (digits > 1 && s[-digits] == '0')) {
+            return NULL;
+        }
+    }
+    if (s != end) { return NULL; }
+
+    if (v6) {
+        i = _PyLong_FromByteArray(addr, 16, 0, 0);
+    }
+    else {
+        i = PyLong_FromUnsignedLong(((unsigned long)addr[0] << 24)
+            | ((unsigned long)addr[1] << 16)
+            | ((unsigned long)addr[2] << 8) | addr[3]);
+    }
+    if (!i) { return NULL; }
+
+    if (!(args = Py_BuildValue("((Ni))", i, prefix))) { return NULL; }
+    i = PyObject_CallObject(type, args);
+    Py_DECREF(args);
+    return i;
+}
+
+#endif
+
+/* Build an ipaddress object from a network address.
+ *
+ * Choose the IPv4 or IPv6 class looking at the string instead of trying the
+ * first and then the second, as ip_interface() and ip_network() do.
+ */
+static PyObject *
+typecast_ipaddress_cast(const char *str, Py_ssize_t len, int network)
+{
+    PyObject *types, *type, *s, *rv = NULL;
+    int v6;
+
+    if (str == NULL) { Py_INCREF(Py_None); return Py_None; }
+
+    if (!(types = psyco_GetIPAddressTypes())) { return NULL; }
+
+    v6 = (NULL != memchr(str, ':', len));
+    type = PyTuple_GET_ITEM(types, 2 * network + v6);
+
+#if PY_VERSION_HEX >= 0x03050000
+    if ((rv = typecast_ipaddress_fast(str, len, v6, type))
+            || PyErr_Occurred()) {
+        goto exit;
+    }
+#endif
+
+    /* the ipaddress module only accepts unicode strings on Python 2 */
+    if ((s = PyUnicode_DecodeASCII(str, len, NULL))) {
+        rv = PyObject_CallFunctionObjArgs(type, s, NULL);
+        Py_DECREF(s);
+    }
+
+#if PY_VERSION_HEX >= 0x03050000
+exit:
+#endif
+    Py_DECREF(types);
+    return rv;
+}
+
+/** INET - cast an inet into an IPv4Interface or IPv6Interface **/
+
+static PyObject *
+typecast_INET_cast(const char *str, Py_ssize_t len, PyObject *curs)
+{
+    return typecast_ipaddress_cast(str, len, 0);
+}
+
+/** CIDR - cast a cidr into an IPv4Network or IPv6Network **/
+
+static PyObject *
+typecast_CIDR_cast(const char *str, Py_ssize_t len, PyObject *curs)
+{
+    return typecast_ipaddress_cast(str, len, 1);
+}
+
+#define typecast_INETARRAY_cast typecast_GENERIC_ARRAY_cast
+#define typecast_CIDRARRAY_cast typecast_GENERIC_ARRAY_cast
@@ -0,0 +1,75 @@
+/* typecast_json.c - json typecasters
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+
+/* json is a builtin from PostgreSQL 9.2, jsonb from 9.4 */
+static long int typecast_JSON_types[] = {114, 0};
+static long int typecast_JSONARRAY_types[] = {199, 0};
+static long int typecast_JSONB_types[] = {3802, 0};
+static long int typecast_JSONBARRAY_types[] = {3807, 0};
+
+/** JSON - parse a json document using the typecaster loads function **/
+
+static PyObject *
+typecast_JSON_cast(const char *str, Py_ssize_t len, PyObject *curs)
+{
+    typecastObject *self =
+        (typecastObject *)((cursorObject*)curs)->caster;
+    PyObject *s, *loads, *rv = NULL;
+
+    if (str == NULL) { Py_INCREF(Py_None); return Py_None; }
+
+    /* pass loads the same string a Python typecaster would receive */
+#if PY_MAJOR_VERSION < 3
+    s = Bytes_FromStringAndSize(str, len);
+#else
+    s = conn_decode(((cursorObject*)curs)->conn, str, len);
+#endif
+    if (!s) { return NULL; }
+
+    if (self->loads) {
+        Py_INCREF(self->loads);
+        loads = self->loads;
+    }
+    else if (!(loads = psyco_GetJsonLoads())) {
+        /* no json module available: return the string as it is */
+        if (PyErr_ExceptionMatches(PyExc_ImportError)) {
+            PyErr_Clear();
+            return s;
+        }
+        goto exit;
+    }
+
+    rv = PyObject_CallFunctionObjArgs(loads, s, NULL);
+    Py_DECREF(loads);
+
+exit:
+    Py_DECREF(s);
+    return rv;
+}
+
+#define typecast_JSONB_cast typecast_JSON_cast
+#define typecast_JSONARRAY_cast typecast_GENERIC_ARRAY_cast
+#define typecast_JSONBARRAY_cast typecast_GENERIC_ARRAY_cast
@@ -56,7 +56,8 @@ typecast_MXDATE_cast(const char *str, Py_ssize_t len, PyObject *curs)
     Dprintf("typecast_MXDATE_cast: s = %s", str);
 
     /* check for infinity */
-    if (!strcmp(str, "infinity") || !strcmp(str, "-infinity")) {
+    if ((len == 8 && !strncmp(str, "infinity", 8))
+            || (len == 9 && !strncmp(str, "-infinity", 9))) {
         if (str[0] == '-') {
             return mxDateTime.DateTime_FromDateAndTime(-999998,1,1, 0,0,0);
         }
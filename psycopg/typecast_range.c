@@ -0,0 +1,128 @@
+/* typecast_range.c - range types typecasters
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+/* the bounds strings passed to the Range constructor, indexed by
+ * 2 * lower inclusive + upper inclusive */
+static const char *typecast_range_bounds_str[] = {"()", "(]", "[)", "[]"};
+static PyObject *typecast_range_bounds[4];
+
+/* Build the object representing an empty range. */
+static PyObject *
+typecast_range_empty(PyObject *ctor)
+{
+    PyObject *args = NULL, *kwargs = NULL, *rv = NULL;
+
+    if (!(args = PyTuple_New(0))) { goto exit; }
+    if (!(kwargs = PyDict_New())) { goto exit; }
+    if (0 != PyDict_SetItemString(kwargs, "empty", Py_True)) { goto exit; }
+    rv = PyObject_Call(ctor, args, kwargs);
+
+exit:
+    Py_XDECREF(args);
+    Py_XDECREF(kwargs);
+    return rv;
+}
+
+/** RANGE - cast a range into a Range object, using the subtype caster **/
+
+/* The range representation is 'empty' or '[lower,upper)', with either
+ * bracket or parens for each bound. A missing bound is infinite; bounds
+ * containing special chars are quoted as the composite types attributes.
+ */
+static PyObject *
+typecast_RANGE_cast(const char *str, Py_ssize_t len, PyObject *curs)
+{
+    typecastObject *self =
+        (typecastObject *)((cursorObject*)curs)->caster;
+    PyObject *lower = NULL, *upper = NULL, *rv = NULL;
+    PyObject *cast, *bounds;
+    const char *s, *end, *tok, *start;
+    Py_ssize_t toklen;
+    char stackbuf[256];
+    char *scratch, *heapbuf = NULL;
+    int ib;
+
+    if (str == NULL) { Py_INCREF(Py_None); return Py_None; }
+
+    if (len == 5 && 0 == strncmp(str, "empty", 5)) {
+        return typecast_range_empty(self->ctor);
+    }
+
+    if (len < 3 || (str[0] != '[' && str[0] != '(')
+            || (str[len - 1] != ']' && str[len - 1] != ')')) {
+        PyErr_SetString(InterfaceError,
+            "failed to parse range: the bounds are not in brackets");
+        return NULL;
+    }
+
+    ib = (str[0] == '[') * 2 + (str[len - 1] == ']');
+    if (!(bounds = typecast_range_bounds[ib])) {
+        if (!(bounds = Text_FromUTF8(typecast_range_bounds_str[ib]))) {
+            return NULL;
+        }
+        typecast_range_bounds[ib] = bounds;
+    }
+
+    if (len < (Py_ssize_t)sizeof(stackbuf)) {
+        scratch = stackbuf;
+    }
+    else if (!(scratch = heapbuf = PyMem_Malloc(len + 1))) {
+        return PyErr_NoMemory();
+    }
+
+    cast = curs_get_cast((cursorObject *)curs,
+        PyTuple_GET_ITEM(self->atttypes, 0));
+
+    /* the lower bound is cast before parsing the upper one, which may
+     * reuse the scratch buffer */
+    s = str + 1;
+    end = str + len - 1;
+    start = s;
+    if (!(s = typecast_composite_token(s, end, &tok, &toklen, scratch))
+            || s == end) {
+        goto error;
+    }
+    if (!(lower = typecast_cast(cast, tok, toklen, curs))) { goto exit; }
+
+    start = ++s;    /* the comma */
+    if (!(s = typecast_composite_token(s, end, &tok, &toklen, scratch))
+            || s != end) {
+        goto error;
+    }
+    if (!(upper = typecast_cast(cast, tok, toklen, curs))) { goto exit; }
+
+    rv = PyObject_CallFunctionObjArgs(self->ctor, lower, upper, bounds, NULL);
+    goto exit;
+
+error:
+    PyErr_Format(InterfaceError,
+        "failed to parse range: bad bound at char %d", (int)(start - str));
+
+exit:
+    Py_XDECREF(lower);
+    Py_XDECREF(upper);
+    PyMem_Free(heapbuf);
+    return rv;
+}
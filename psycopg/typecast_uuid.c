@@ -0,0 +1,117 @@
+/* typecast_uuid.c - uuid typecasters
+ *
+ * Copyright (C) 2012 Daniele Varrazzo <daniele.varrazzo@gmail.com>
+ *
+ * This file is part of psycopg.
+ *
+ * psycopg2 is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link this program with the OpenSSL library (or with
+ * modified versions of OpenSSL that use the same license as OpenSSL),
+ * and distribute linked combinations including the two.
+ *
+ * You must obey the GNU Lesser General Public License in all respects for
+ * all of the code used other than OpenSSL.
+ *
+ * psycopg2 is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ */
+
+
+/* uuid typecasters are registered by extras.register_uuid() */
+static long int typecast_UUID_types[] = {2950, 0};
+static long int typecast_UUIDARRAY_types[] = {2951, 0};
+
+/* Build a uuid.UUID from its int value.
+ *
+ * The object attributes are set as UUID.__init__() would do, but without
+ * calling it and without going through the read-only UUID.__setattr__().
+ */
+static PyObject *
+typecast_uuid_from_int(PyObject *type, PyObject *i)
+{
+    static PyObject *intname = NULL, *safename = NULL;
+    PyObject *args = NULL, *safe = NULL, *rv = NULL;
+
+    if (!intname) {
+        if (!(intname = Text_FromUTF8("int"))) { return NULL; }
+    }
+    if (!safename) {
+        if (!(safename = Text_FromUTF8("is_safe"))) { return NULL; }
+    }
+
+    if (!(args = PyTuple_New(0))) { goto exit; }
+    if (!(rv = ((PyTypeObject *)type)->tp_new(
+            (PyTypeObject *)type, args, NULL))) {
+        goto exit;
+    }
+    if (0 != PyObject_GenericSetAttr(rv, intname, i)) { goto error; }
+
+    /* Python 3.7 added the is_safe attribute */
+    if (!(safe = psyco_GetUUIDSafeUnknown())) { goto error; }
+    if (safe != Py_None) {
+        if (0 != PyObject_GenericSetAttr(rv, safename, safe)) { goto error; }
+    }
+
+    goto exit;
+
+error:
+    Py_CLEAR(rv);
+
+exit:
+    Py_XDECREF(args);
+    Py_XDECREF(safe);
+    return rv;
+}
+
+/** UUID - parse the uuid text representation into a uuid.UUID **/
+
+static PyObject *
+typecast_UUID_cast(const char *str, Py_ssize_t len, PyObject *curs)
+{
+    PyObject *type, *i = NULL, *rv = NULL;
+    unsigned char bytes[16];
+    unsigned char hi, lo;
+    const char *s = str;
+    int n = 0;
+
+    if (str == NULL) { Py_INCREF(Py_None); return Py_None; }
+
+    if (!(type = psyco_GetUUIDType())) { return NULL; }
+
+    /* PostgreSQL returns the canonical form 'xxxxxxxx-xxxx-xxxx-xxxx-xxxx...':
+     * parse it here, leave anything else to the UUID constructor */
+    if (len == 36) {
+        for (; n < 16; n++) {
+            if (n == 4 || n == 6 || n == 8 || n == 10) {
+                if (*s++ != '-') { break; }
+            }
+            hi = (unsigned char)hex_lut[s[0] & '\x7f'];
+            lo = (unsigned char)hex_lut[s[1] & '\x7f'];
+            if (hi > 15 || lo > 15 || ((s[0] | s[1]) & '\x80')) { break; }
+            bytes[n] = (hi << 4) | lo;
+            s += 2;
+        }
+    }
+
+    if (n == 16) {
+        if ((i = _PyLong_FromByteArray(bytes, 16, 0, 0))) {
+            rv = typecast_uuid_from_int(type, i);
+        }
+    }
+    else if ((i = Text_FromUTF8AndSize(str, len))) {
+        rv = PyObject_CallFunctionObjArgs(type, i, NULL);
+    }
+
+    Py_XDECREF(i);
+    Py_DECREF(type);
+    return rv;
+}
+
+#define typecast_UUIDARRAY_cast typecast_GENERIC_ARRAY_cast
@@ -32,6 +32,244 @@
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef PSYCOPG_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef PSYCOPG_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+/* The libpq ids of the encodings: the single byte ones go from LATIN1 to
+ * KOI8U, the last one the server supports. The multibyte encodings before
+ * them are validated by libpq; in the client-only ones following them
+ * (SJIS, BIG5, GBK...) the bytes of a char may look like a quote or a
+ * backslash. */
+#define PSYCOPG_PG_ENCODING_SQL_ASCII 0
+#define PSYCOPG_PG_ENCODING_UTF8 6
+#define PSYCOPG_PG_ENCODING_SB_FIRST 8
+#define PSYCOPG_PG_ENCODING_SB_LAST 34
+
+/* How escape_copy() deals with the non-ASCII chars */
+#define ESCAPE_HIGHBIT_COPY 0       /* copy them as they are */
+#define ESCAPE_HIGHBIT_UTF8 1       /* copy the valid utf8 sequences */
+#define ESCAPE_HIGHBIT_LIBPQ 2      /* let libpq escape the string */
+
+/* String escaping kernels: return the offset of the first block containing
+ * a quote, a backslash or a NUL, and any non-ASCII char if 'highbit' is set,
+ * or of the end of the last whole block. */
+
+#ifdef PSYCOPG_HAVE_SSE2
+
+static Py_ssize_t
+escape_scan_sse2(const char *from, Py_ssize_t len, int highbit)
+{
+    const __m128i quote = _mm_set1_epi8('\'');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i nul = _mm_setzero_si128();
+    Py_ssize_t i;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(from + i));
+        int m = _mm_movemask_epi8(_mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(c, quote), _mm_cmpeq_epi8(c, bslash)),
+            _mm_cmpeq_epi8(c, nul)));
+        if (highbit) { m |= _mm_movemask_epi8(c); }
+        if (m) { break; }
+    }
+
+    return i;
+}
+
+#endif /* PSYCOPG_HAVE_SSE2 */
+
+#ifdef PSYCOPG_HAVE_AVX2
+
+__attribute__((target("avx2"))) static Py_ssize_t
+escape_scan_avx2(const char *from, Py_ssize_t len, int highbit)
+{
+    const __m256i quote = _mm256_set1_epi8('\'');
+    const __m256i bslash = _mm256_set1_epi8('\\');
+    const __m256i nul = _mm256_setzero_si256();
+    Py_ssize_t i;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(from + i));
+        int m = _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(c, quote), _mm256_cmpeq_epi8(c, bslash)),
+            _mm256_cmpeq_epi8(c, nul)));
+        if (highbit) { m |= _mm256_movemask_epi8(c); }
+        if (m) { break; }
+    }
+
+    return i;
+}
+
+#endif /* PSYCOPG_HAVE_AVX2 */
+
+/* Return the offset of the first char in 'from' that may need escaping, or
+ * 'len' if there is none. */
+static Py_ssize_t
+escape_scan(const char *from, Py_ssize_t len, int highbit)
+{
+    Py_ssize_t i = 0;
+    char c;
+
+#ifdef PSYCOPG_HAVE_AVX2
+    if (psycopg_simd_level() >= 2) {
+        i = escape_scan_avx2(from, len, highbit);
+    }
+#endif
+#ifdef PSYCOPG_HAVE_SSE2
+    i += escape_scan_sse2(from + i, len - i, highbit);
+#endif
+
+    for (; i < len; i++) {
+        c = from[i];
+        if (c == '\'' || c == '\\' || c == '\0' || (highbit && (c & 0x80))) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/* Return how the non-ASCII chars must be escaped for the connection: only
+ * the single byte encodings can be copied blindly, libpq validates the
+ * multibyte chars and replaces the broken ones. */
+static int
+escape_highbit(connectionObject *conn)
+{
+    int enc;
+
+    if (!(conn && conn->pgconn)) { return ESCAPE_HIGHBIT_LIBPQ; }
+    enc = PQclientEncoding(conn->pgconn);
+    if (enc == PSYCOPG_PG_ENCODING_SQL_ASCII
+            || (enc >= PSYCOPG_PG_ENCODING_SB_FIRST
+                && enc <= PSYCOPG_PG_ENCODING_SB_LAST)) {
+        return ESCAPE_HIGHBIT_COPY;
+    }
+    if (enc == PSYCOPG_PG_ENCODING_UTF8) { return ESCAPE_HIGHBIT_UTF8; }
+    return ESCAPE_HIGHBIT_LIBPQ;
+}
+
+/* Return 1 if the ASCII bytes of the strings encoded for the connection are
+ * always ASCII chars, so that they can be escaped one byte at time. It is
+ * not the case in the client-only encodings, where they may be the second
+ * byte of a char, and when the encoding is unknown. */
+int
+psycopg_ascii_safe(PyObject *obj)
+{
+    connectionObject *conn = (connectionObject *)obj;
+
+    if (!(conn && conn->pgconn)) { return 0; }
+    return PQclientEncoding(conn->pgconn) <= PSYCOPG_PG_ENCODING_SB_LAST;
+}
+
+/* Return the length of the utf8 char at the start of 's' if it is valid
+ * according to the server rules (no overlong forms, no surrogates, up to
+ * U+10FFFF), else 0. */
+static int
+escape_utf8_len(const unsigned char *s, Py_ssize_t len)
+{
+    int n, i;
+
+    if (s[0] >= 0xC2 && s[0] <= 0xDF) { n = 2; }
+    else if (s[0] >= 0xE0 && s[0] <= 0xEF) { n = 3; }
+    else if (s[0] >= 0xF0 && s[0] <= 0xF4) { n = 4; }
+    else { return 0; }
+
+    if (n > len) { return 0; }
+    for (i = 1; i < n; i++) {
+        if ((s[i] & 0xC0) != 0x80) { return 0; }
+    }
+
+    switch (s[0]) {
+    case 0xE0: if (s[1] < 0xA0) { return 0; } break;
+    case 0xED: if (s[1] > 0x9F) { return 0; } break;
+    case 0xF0: if (s[1] < 0x90) { return 0; } break;
+    case 0xF4: if (s[1] > 0x8F) { return 0; } break;
+    }
+
+    return n;
+}
+
+/* Escape the string 'from' into 'to', without quotes, as PQescapeStringConn
+ * would: double the quotes, and the backslashes unless the connection has
+ * standard_conforming_strings, stop at the first NUL. If 'to' is NULL only
+ * compute the length. 'highbit' is the escape_highbit() of the connection.
+ *
+ * Return the length of the escaped string or -1 if the string must be
+ * escaped by libpq: if it contains a non-ASCII char libpq must check (an
+ * invalid utf8 sequence or any char in the other multibyte encodings) or
+ * if it contains anything to escape and there is no connection.
+ */
+static Py_ssize_t
+escape_copy(connectionObject *conn, const char *from, Py_ssize_t len,
+            char *to, int highbit)
+{
+    PGconn *pgconn = conn ? conn->pgconn : NULL;
+    int bsdouble = -1;
+    Py_ssize_t pos = 0, n, rv = 0;
+    const char *scs;
+
+    for (;;) {
+        n = escape_scan(
+            from + pos, len - pos, highbit != ESCAPE_HIGHBIT_COPY);
+        if (to) {
+            memcpy(to + rv, from + pos, n);
+        }
+        rv += n;
+        pos += n;
+        if (pos == len || from[pos] == '\0') { break; }
+
+        if (!pgconn) { return -1; }
+
+        if (from[pos] & 0x80) {
+            if (highbit != ESCAPE_HIGHBIT_UTF8) { return -1; }
+            if (!(n = escape_utf8_len(
+                    (const unsigned char *)from + pos, len - pos))) {
+                return -1;
+            }
+            if (to) {
+                memcpy(to + rv, from + pos, n);
+            }
+            rv += n;
+            pos += n;
+            continue;
+        }
+
+        if (from[pos] == '\\') {
+            if (bsdouble < 0) {
+                scs = PQparameterStatus(pgconn, "standard_conforming_strings");
+                bsdouble = !(scs && 0 == strcmp(scs, "on"));
+            }
+            if (bsdouble) {
+                if (to) { to[rv] = '\\'; }
+                rv++;
+            }
+        }
+        else {
+            if (to) { to[rv] = '\''; }
+            rv++;
+        }
+        if (to) { to[rv] = from[pos]; }
+        rv++;
+        pos++;
+    }
+
+    return rv;
+}
+
+/* Escape a string to build a valid PostgreSQL literal, quotes included.
+ *
+ * If 'to' is NULL allocate a buffer on the Python heap, else 'to' must have
+ * room for len * 2 + 4 chars. 'len' is optional: if 0 the length is
+ * calculated. The length of the result is returned in 'tolen'.
+ *
+ * The strings with nothing to escape are copied as they are, the others are
+ * escaped by escape_copy() or, when it can't, by libpq.
+ */
 char *
 psycopg_escape_string(PyObject *obj, const char *from, Py_ssize_t len,
                        char *to, Py_ssize_t *tolen)
@@ -39,24 +277,45 @@ psycopg_escape_string(PyObject *obj, const char *from, Py_ssize_t len,
     Py_ssize_t ql;
     connectionObject *conn = (connectionObject*)obj;
     int eq = (conn && (conn->equote)) ? 1 : 0;   
+    int highbit;
 
     if (len == 0)
         len = strlen(from);
-    
-    if (to == NULL) {
-        to = (char *)PyMem_Malloc((len * 2 + 4) * sizeof(char));
-        if (to == NULL)
-            return NULL;
+
+    highbit = escape_highbit(conn);
+    if (len == escape_scan(from, len, highbit != ESCAPE_HIGHBIT_COPY)) {
+        if (to == NULL) {
+            if (!(to = (char *)PyMem_Malloc(len + 4))) {
+                return NULL;
+            }
+        }
+        memcpy(to+eq+1, from, len);
+        ql = len;
+    }
+    else if (0 <= (ql = escape_copy(conn, from, len, NULL, highbit))) {
+        if (to == NULL) {
+            if (!(to = (char *)PyMem_Malloc(ql + 4))) {
+                return NULL;
+            }
+        }
+        escape_copy(conn, from, len, to+eq+1, highbit);
     }
+    else {
+        if (to == NULL) {
+            to = (char *)PyMem_Malloc((len * 2 + 4) * sizeof(char));
+            if (to == NULL)
+                return NULL;
+        }
 
-    {
-        #if PG_VERSION_HEX >= 0x080104
-            int err;
-            if (conn && conn->pgconn)
-                ql = PQescapeStringConn(conn->pgconn, to+eq+1, from, len, &err);
-            else
-        #endif
-                ql = PQescapeString(to+eq+1, from, len);
+        {
+            #if PG_VERSION_HEX >= 0x080104
+                int err;
+                if (conn && conn->pgconn)
+                    ql = PQescapeStringConn(conn->pgconn, to+eq+1, from, len, &err);
+                else
+            #endif
+                    ql = PQescapeString(to+eq+1, from, len);
+        }
     }
 
     if (eq)
@@ -128,6 +387,40 @@ psycopg_strdup(char **to, const char *from, Py_ssize_t len)
     return 0;
 }
 
+/* Return the representation of a number as bytes, prepending a space to the
+ * negative numbers as the adapters do (ticket #57).
+ *
+ * Steal a reference to `str`, the result of str() or repr() on the number.
+ * It is safe to call the function on NULL.
+ */
+STEALS(1) PyObject *
+psycopg_quote_number(PyObject *str)
+{
+    PyObject *rv;
+    Py_ssize_t len;
+
+    if (!str) { return NULL; }
+
+#if PY_MAJOR_VERSION > 2
+    /* unicode to bytes in Py3 */
+    rv = PyUnicode_AsUTF8String(str);
+    Py_DECREF(str);
+    if (!rv) { return NULL; }
+#else
+    rv = str;
+#endif
+
+    if ('-' != Bytes_AS_STRING(rv)[0]) { return rv; }
+
+    len = Bytes_GET_SIZE(rv);
+    if ((str = Bytes_FromStringAndSize(NULL, len + 1))) {
+        Bytes_AS_STRING(str)[0] = ' ';
+        memcpy(Bytes_AS_STRING(str) + 1, Bytes_AS_STRING(rv), len);
+    }
+    Py_DECREF(rv);
+    return str;
+}
+
 /* Ensure a Python object is a bytes string.
  *
  * Useful when a char * is required out of it.
@@ -225,3 +518,246 @@ psycopg_is_text_file(PyObject *f)
     }
 }
 
+
+/* Return the vector instruction set usable on this machine.
+ *
+ * 0 means none (use the scalar code), 1 SSE2, 2 AVX2.
+ */
+int
+psycopg_simd_level(void)
+{
+    static int level = -1;
+
+    if (level < 0) {
+#if defined(PSYCOPG_HAVE_AVX2)
+        __builtin_cpu_init();
+        level = __builtin_cpu_supports("avx2") ? 2 : 1;
+#elif defined(PSYCOPG_HAVE_SSE2)
+        level = 1;
+#else
+        level = 0;
+#endif
+        Dprintf("psycopg_simd_level: %d", level);
+    }
+
+    return level;
+}
+
+
+/* hex encoding and decoding kernels, used by the bytea adapter/typecaster */
+
+static const char hex_digits[] = "0123456789abcdef";
+
+#ifdef PSYCOPG_HAVE_SSE2
+
+/* Convert 16 nibbles (values 0-15) into their lowercase hex digits. */
+#define HEX_DIGITS_SSE2(n) \
+    _mm_add_epi8(_mm_add_epi8((n), _mm_set1_epi8('0')), \
+        _mm_and_si128(_mm_cmpgt_epi8((n), _mm_set1_epi8(9)), \
+            _mm_set1_epi8('a' - '0' - 10)))
+
+static Py_ssize_t
+hex_encode_sse2(const unsigned char *from, Py_ssize_t len, char *to)
+{
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    Py_ssize_t i;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(from + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), mask);
+        __m128i lo = _mm_and_si128(in, mask);
+
+        hi = HEX_DIGITS_SSE2(hi);
+        lo = HEX_DIGITS_SSE2(lo);
+        _mm_storeu_si128((__m128i *)(to + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(to + 2 * i + 16),
+            _mm_unpackhi_epi8(hi, lo));
+    }
+
+    return i;
+}
+
+/* Convert 16 hex digits at 's' into nibbles.
+ *
+ * Return 0 if any of the chars is not an hex digit.
+ */
+static int
+hex_nibbles_sse2(const char *s, __m128i *out)
+{
+    __m128i c = _mm_loadu_si128((const __m128i *)s);
+    __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i l = _mm_sub_epi8(
+        _mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i isd = _mm_and_si128(_mm_cmpgt_epi8(d, _mm_set1_epi8(-1)),
+        _mm_cmplt_epi8(d, _mm_set1_epi8(10)));
+    __m128i isl = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8(-1)),
+        _mm_cmplt_epi8(l, _mm_set1_epi8(6)));
+
+    if (0xffff != _mm_movemask_epi8(_mm_or_si128(isd, isl))) {
+        return 0;
+    }
+
+    *out = _mm_or_si128(_mm_and_si128(isd, d),
+        _mm_and_si128(isl, _mm_add_epi8(l, _mm_set1_epi8(10))));
+    return 1;
+}
+
+/* Join pairs of nibbles into 8 bytes, one per 16 bit lane. */
+#define HEX_JOIN_SSE2(n) \
+    _mm_or_si128( \
+        _mm_slli_epi16(_mm_and_si128((n), _mm_set1_epi16(0xff)), 4), \
+        _mm_srli_epi16((n), 8))
+
+static Py_ssize_t
+hex_decode_sse2(const char *from, Py_ssize_t len, char *to)
+{
+    Py_ssize_t i;
+    __m128i a, b;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        if (!hex_nibbles_sse2(from + i, &a)
+                || !hex_nibbles_sse2(from + i + 16, &b)) {
+            break;
+        }
+        _mm_storeu_si128((__m128i *)(to + i / 2),
+            _mm_packus_epi16(HEX_JOIN_SSE2(a), HEX_JOIN_SSE2(b)));
+    }
+
+    return i;
+}
+
+#endif /* PSYCOPG_HAVE_SSE2 */
+
+#ifdef PSYCOPG_HAVE_AVX2
+
+#define HEX_DIGITS_AVX2(n) \
+    _mm256_add_epi8(_mm256_add_epi8((n), _mm256_set1_epi8('0')), \
+        _mm256_and_si256(_mm256_cmpgt_epi8((n), _mm256_set1_epi8(9)), \
+            _mm256_set1_epi8('a' - '0' - 10)))
+
+__attribute__((target("avx2"))) static Py_ssize_t
+hex_encode_avx2(const unsigned char *from, Py_ssize_t len, char *to)
+{
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    Py_ssize_t i;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)(from + i));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(in, 4), mask);
+        __m256i lo = _mm256_and_si256(in, mask);
+        __m256i a, b;
+
+        hi = HEX_DIGITS_AVX2(hi);
+        lo = HEX_DIGITS_AVX2(lo);
+
+        /* unpack works within the 128 bit lanes: swap the middle halves */
+        a = _mm256_unpacklo_epi8(hi, lo);
+        b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i *)(to + 2 * i),
+            _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i *)(to + 2 * i + 32),
+            _mm256_permute2x128_si256(a, b, 0x31));
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2"))) static int
+hex_nibbles_avx2(const char *s, __m256i *out)
+{
+    __m256i c = _mm256_loadu_si256((const __m256i *)s);
+    __m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    __m256i l = _mm256_sub_epi8(
+        _mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i isd = _mm256_andnot_si256(
+        _mm256_cmpgt_epi8(_mm256_setzero_si256(), d),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(10), d));
+    __m256i isl = _mm256_andnot_si256(
+        _mm256_cmpgt_epi8(_mm256_setzero_si256(), l),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(6), l));
+
+    if (-1 != _mm256_movemask_epi8(_mm256_or_si256(isd, isl))) {
+        return 0;
+    }
+
+    *out = _mm256_or_si256(_mm256_and_si256(isd, d),
+        _mm256_and_si256(isl, _mm256_add_epi8(l, _mm256_set1_epi8(10))));
+    return 1;
+}
+
+#define HEX_JOIN_AVX2(n) \
+    _mm256_or_si256( \
+        _mm256_slli_epi16(_mm256_and_si256((n), _mm256_set1_epi16(0xff)), 4), \
+        _mm256_srli_epi16((n), 8))
+
+__attribute__((target("avx2"))) static Py_ssize_t
+hex_decode_avx2(const char *from, Py_ssize_t len, char *to)
+{
+    Py_ssize_t i;
+    __m256i a, b;
+
+    for (i = 0; i + 64 <= len; i += 64) {
+        if (!hex_nibbles_avx2(from + i, &a)
+                || !hex_nibbles_avx2(from + i + 32, &b)) {
+            break;
+        }
+        /* pack works within the 128 bit lanes: put the quadwords in order */
+        _mm256_storeu_si256((__m256i *)(to + i / 2),
+            _mm256_permute4x64_epi64(
+                _mm256_packus_epi16(HEX_JOIN_AVX2(a), HEX_JOIN_AVX2(b)),
+                0xd8));
+    }
+
+    return i;
+}
+
+#endif /* PSYCOPG_HAVE_AVX2 */
+
+/* Write the hex representation of 'len' bytes from 'from' into 'to'.
+ *
+ * 'to' must have room for 2 * len chars. No terminator is added.
+ */
+void
+psycopg_hex_encode(const unsigned char *from, Py_ssize_t len, char *to)
+{
+    Py_ssize_t i = 0;
+
+#ifdef PSYCOPG_HAVE_AVX2
+    if (psycopg_simd_level() >= 2) {
+        i = hex_encode_avx2(from, len, to);
+    }
+#endif
+#ifdef PSYCOPG_HAVE_SSE2
+    i += hex_encode_sse2(from + i, len - i, to + 2 * i);
+#endif
+
+    for (; i < len; i++) {
+        to[2 * i] = hex_digits[from[i] >> 4];
+        to[2 * i + 1] = hex_digits[from[i] & 0x0f];
+    }
+}
+
+/* Decode a run of hex digits from 'from' into 'to'.
+ *
+ * Only the vectorized part is done here: the function stops at the first
+ * block that contains anything else than hex digits or when the input left
+ * is shorter than a block. Return the number of chars consumed (always even,
+ * half of them are the bytes written): the caller is responsible for the rest
+ * of the input.
+ */
+Py_ssize_t
+psycopg_hex_decode(const char *from, Py_ssize_t len, char *to)
+{
+    Py_ssize_t i = 0;
+
+#ifdef PSYCOPG_HAVE_AVX2
+    if (psycopg_simd_level() >= 2) {
+        i = hex_decode_avx2(from, len, to);
+    }
+#endif
+#ifdef PSYCOPG_HAVE_SSE2
+    i += hex_decode_sse2(from + i, len - i, to + i / 2);
+#endif
+
+    return i;
+}
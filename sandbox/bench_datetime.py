@@ -0,0 +1,52 @@
+"""Benchmark the date/time typecasters.
+
+Compare the values in the ISO format returned by the server, which are
+parsed by the fast path, with equivalent values that must go through the
+general parser, then fetch a result set of timestamps from the server.
+
+Usage: python bench_datetime.py [DSN]
+"""
+
+import sys
+import time
+
+import psycopg2
+import psycopg2.extensions as ext
+
+dsn = len(sys.argv) > 1 and sys.argv[1] or 'dbname=test'
+N = 200000
+
+conn = psycopg2.connect(dsn)
+curs = conn.cursor()
+
+def bench(label, caster, value):
+    t0 = time.time()
+    for i in range(N):
+        caster(value, curs)
+    t = time.time() - t0
+    sys.stdout.write("%-40s %8.0f ns/value\n" % (label, t * 1e9 / N))
+
+# the 'T' separator and the single digit fields are only understood by the
+# general parser
+bench("date iso", ext.PYDATE, '2012-03-04')
+bench("date general", ext.PYDATE, '2012-3-4')
+bench("timestamp iso", ext.PYDATETIME, '2012-03-04 05:06:07.123456')
+bench("timestamp general", ext.PYDATETIME, '2012-03-04T05:06:07.123456')
+bench("timestamptz iso", ext.PYDATETIME, '2012-03-04 05:06:07.123456+02')
+bench("timestamptz general", ext.PYDATETIME,
+    '2012-03-04T05:06:07.123456+02')
+bench("timestamp infinity", ext.PYDATETIME, 'infinity')
+bench("time iso", ext.PYTIME, '05:06:07.123456')
+bench("timetz iso", ext.PYTIME, '05:06:07.123456+02')
+bench("timetz general", ext.PYTIME, '5:06:07.123456+02')
+
+t0 = time.time()
+curs.execute("""select now() + i * '1 second'::interval
+    from generate_series(1, %s) i""", (N,))
+t1 = time.time()
+curs.fetchall()
+t2 = time.time()
+sys.stdout.write("%-40s %8.0f ns/value (query: %.2f s)\n"
+    % ("fetch timestamptz", (t2 - t1) * 1e9 / N, t1 - t0))
+
+conn.close()
@@ -419,7 +419,7 @@ data_files = []
 
 sources = [
     'psycopgmodule.c',
-    'green.c', 'pqpath.c', 'utils.c', 'bytes_format.c',
+    'green.c', 'pqpath.c', 'utils.c',
 
     'connection_int.c', 'connection_type.c',
     'cursor_int.c', 'cursor_type.c',
@@ -429,6 +429,8 @@ sources = [
     'adapter_asis.c', 'adapter_binary.c', 'adapter_datetime.c',
     'adapter_list.c', 'adapter_pboolean.c', 'adapter_pdecimal.c',
     'adapter_pint.c', 'adapter_pfloat.c', 'adapter_qstring.c',
+    'adapter_hstore.c', 'adapter_ipaddress.c', 'adapter_json.c',
+    'adapter_range.c', 'adapter_sqlin.c', 'adapter_uuid.c',
     'microprotocols.c', 'microprotocols_proto.c',
     'typecast.c',
 ]
@@ -442,12 +444,16 @@ depends = [
     'adapter_asis.h', 'adapter_binary.h', 'adapter_datetime.h',
     'adapter_list.h', 'adapter_pboolean.h', 'adapter_pdecimal.h',
     'adapter_pint.h', 'adapter_pfloat.h', 'adapter_qstring.h',
+    'adapter_hstore.h', 'adapter_ipaddress.h', 'adapter_json.h',
+    'adapter_range.h', 'adapter_sqlin.h', 'adapter_uuid.h',
     'microprotocols.h', 'microprotocols_proto.h',
     'typecast.h', 'typecast_binary.h',
 
     # included sources
     'typecast_array.c', 'typecast_basic.c', 'typecast_binary.c',
-    'typecast_builtins.c', 'typecast_datetime.c',
+    'typecast_builtins.c', 'typecast_composite.c', 'typecast_datetime.c',
+    'typecast_hstore.c', 'typecast_inet.c', 'typecast_json.c',
+    'typecast_range.c', 'typecast_uuid.c',
 ]
 
 parser = configparser.ConfigParser()
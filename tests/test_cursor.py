@@ -126,6 +126,83 @@ class CursorTests(unittest.TestCase):
         self.assertRaises(psycopg2.ProgrammingError,
             cur.mogrify, "select %(foo, %(bar)", {'foo': 1, 'bar': 2})
 
+    def test_mogrify_many_args(self):
+        cur = self.conn.cursor()
+        args = [(i, "x'%s" % i, None) for i in range(3000)]
+        query = cur.mogrify("values " + ",".join(["(%s,%s,%s)"] * len(args)),
+            [v for a in args for v in a])
+        self.assertEqual(query, b("values ") + b(",").join(
+            [cur.mogrify("(%s,%s,%s)", a) for a in args]))
+
+        self.assertEqual(cur.mogrify("select %s, 100%%", (1,)),
+            b("select 1, 100%"))
+        self.assertRaises(TypeError, cur.mogrify, "select %s", (1, 2))
+        self.assertRaises(ValueError, cur.mogrify, "select %d", (1,))
+
+    def test_query_cache(self):
+        cur = self.conn.cursor()
+        query = "select %(a)s, %(b)s, %(a)s"
+        cur.mogrify(query, {'a': 0, 'b': 0})
+        hits = self.conn.query_cache_hits
+        misses = self.conn.query_cache_misses
+        for i in range(3):
+            self.assertEqual(cur.mogrify(query, {'a': i, 'b': 'x'}),
+                b("select %d, 'x', %d" % (i, i)))
+        self.assertEqual(self.conn.query_cache_hits, hits + 3)
+        self.assertEqual(self.conn.query_cache_misses, misses)
+
+        # a subclass may change the query: it is not cached
+        class MyStr(str):
+            pass
+        cur.mogrify(MyStr(query), {'a': 1, 'b': 2})
+        self.assertEqual(self.conn.query_cache_hits, hits + 3)
+
+    def test_params_threshold(self):
+        cur = self.conn.cursor()
+        self.assertEqual(self.conn.params_threshold, 0)
+        self.conn.params_threshold = 100
+
+        s = "a'b\\c" * 100
+        data = b("\x00'\\\xff") * 100
+        cur.execute("select %s, %s::text, %s",
+            ('short', s, psycopg2.Binary(data)))
+        self.assertEqual(cur.query, b("select 'short', $1::text, $2"))
+        r = cur.fetchone()
+        self.assertEqual(r[:2], ('short', s))
+        self.assertEqual(bytes(r[2]), data)
+
+        # a value repeated in a mapping is sent once
+        cur.execute("select %(a)s::text = %(a)s", {'a': s})
+        self.assertEqual(cur.query, b("select $1::text = $1"))
+        self.assertEqual(cur.fetchone()[0], True)
+
+        # the type of a long string is not known to the server where the
+        # context doesn't define it, unlike for a quoted literal
+        self.assertRaises(psycopg2.ProgrammingError,
+            cur.execute, "select %s is null", (s,))
+        self.conn.rollback()
+        cur.execute("select %s is null", ('short',))
+        self.assertEqual(cur.fetchone()[0], False)
+
+        # several statements can't be sent with parameters
+        self.assertRaises(psycopg2.ProgrammingError,
+            cur.execute, "select 1; select %s::text", (s,))
+        self.conn.rollback()
+        cur.execute("select 1; select %s::text", ('short',))
+        self.assertEqual(cur.fetchone()[0], 'short')
+
+        # named cursors quote all the arguments
+        cur = self.conn.cursor('named')
+        cur.execute("select %s::text", (s,))
+        self.assertEqual(cur.fetchone()[0], s)
+        cur.close()
+
+        self.conn.params_threshold = 0
+        cur = self.conn.cursor()
+        cur.execute("select %s::text", (s,))
+        self.assert_(b('$1') not in cur.query)
+        self.assertEqual(cur.fetchone()[0], s)
+
     def test_cast(self):
         curs = self.conn.cursor()
 
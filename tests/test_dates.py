@@ -25,6 +25,7 @@
 import math
 import unittest
 import psycopg2
+from psycopg2.extensions import b
 from psycopg2.tz import FixedOffsetTimezone, ZERO
 from testconfig import dsn
 
@@ -126,6 +127,25 @@ class DatetimeTests(unittest.TestCase, CommonDatetimeTestsMixin):
         self.assertEqual(value.second, 29)
         self.assertEqual(value.microsecond, 123456)
 
+    def test_parse_datetime_fraction_digits(self):
+        for frac, us in [('1', 100000), ('12', 120000), ('12345', 123450),
+                ('000001', 1)]:
+            value = self.DATETIME('2007-01-01 13:30:29.' + frac, self.curs)
+            self.assertEqual(value.microsecond, us)
+            value = self.TIME('13:30:29.%s+02' % frac, self.curs)
+            self.assertEqual(value.microsecond, us)
+
+    def test_parse_not_iso(self):
+        # values not in the exact ISO format go through the general parser
+        from datetime import date, datetime
+        self.assertEqual(self.DATE('2007-1-2', self.curs), date(2007, 1, 2))
+        self.assertEqual(self.DATETIME('2007-01-02T13:30:29', self.curs),
+            datetime(2007, 1, 2, 13, 30, 29))
+        self.assertEqual(self.DATETIME('2007-01-02', self.curs),
+            datetime(2007, 1, 2))
+        self.assertEqual(self.DATETIME('12007-01-02 13:30:29', self.curs),
+            datetime(9999, 1, 2, 13, 30, 29))
+
     def check_time_tz(self, str_offset, offset):
         from datetime import time, timedelta
         base = time(13, 30, 29)
@@ -253,6 +273,35 @@ class DatetimeTests(unittest.TestCase, CommonDatetimeTestsMixin):
         self.assertEqual(seconds, -3583504)
         self.assertEqual(int(round((value - seconds) * 1000000)), 123456)
 
+    def test_adapt_literals(self):
+        from datetime import date, time, datetime, timedelta
+        from psycopg2.extensions import adapt
+        tz = FixedOffsetTimezone(-90)
+        for obj, cast in [
+                (date(2007, 1, 1), 'date'),
+                (date(1, 2, 3), 'date'),
+                (time(13, 30, 29), 'time'),
+                (time(0, 0, 0, 1), 'time'),
+                (time(13, 30, tzinfo=tz), 'time'),
+                (datetime(2007, 1, 1, 13, 30, 29), 'timestamp'),
+                (datetime(999, 1, 1, 0, 0, 0, 999999), 'timestamp'),
+                (datetime(2007, 1, 1, 13, 30, 29, 10, tzinfo=tz),
+                    'timestamptz'),
+                (datetime(2007, 1, 1, tzinfo=FixedOffsetTimezone(330)),
+                    'timestamptz')]:
+            self.assertEqual(adapt(obj).getquoted(),
+                b("'%s'::%s" % (obj.isoformat(), cast)))
+
+        self.assertEqual(adapt(timedelta(-3, 4, 5)).getquoted(),
+            b("'-3 days 4.000005 seconds'::interval"))
+
+        # subclasses may customize the representation
+        class MyDate(date):
+            def isoformat(self):
+                return '2012-01-01'
+        self.assertEqual(adapt(MyDate(2007, 1, 1)).getquoted(),
+            b("'2012-01-01'::date"))
+
     def _test_type_roundtrip(self, o1):
         o2 = self.execute("select %s;", (o1,))
         self.assertEqual(type(o1), type(o2))
@@ -285,6 +334,29 @@ class DatetimeTests(unittest.TestCase, CommonDatetimeTestsMixin):
         from datetime import time
         self._test_type_roundtrip(time(10,20,30))
 
+    def test_tzinfo_factory_cache(self):
+        from datetime import timedelta
+        calls = []
+        def factory(offset):
+            calls.append(offset)
+            return FixedOffsetTimezone(offset)
+
+        # the factory is called once per offset
+        curs = self.conn.cursor()
+        curs.tzinfo_factory = factory
+        curs.execute("select '10:00:00+00'::timetz, '10:00:00+02'::timetz,"
+            " '10:00:00+00'::timetz, '10:00:00+02'::timetz")
+        t1, t2, t3, t4 = curs.fetchone()
+        self.assertEqual(sorted(calls), [0, 120])
+        self.assert_(t1.tzinfo is t3.tzinfo)
+        self.assert_(t2.tzinfo is t4.tzinfo)
+        self.assertEqual(t2.utcoffset(), timedelta(hours=2))
+
+        # changing the factory invalidates the cache
+        curs.tzinfo_factory = lambda offset: FixedOffsetTimezone(offset + 60)
+        curs.execute("select '10:00:00+00'::timetz")
+        self.assertEqual(curs.fetchone()[0].utcoffset(), timedelta(hours=1))
+
     def test_type_roundtrip_interval(self):
         from datetime import timedelta
         self._test_type_roundtrip(timedelta(seconds=30))
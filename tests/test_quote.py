@@ -23,7 +23,7 @@
 # License for more details.
 
 import sys
-from testutils import unittest
+from testutils import unittest, skip_from_python
 from testconfig import dsn
 
 import psycopg2
@@ -67,6 +67,35 @@ class QuotingTestCase(unittest.TestCase):
         self.assertEqual(res, data)
         self.assert_(not self.conn.notices)
 
+    def test_string_escape_positions(self):
+        # the special chars found at the boundaries of the scanned blocks
+        curs = self.conn.cursor()
+        for c in ["'", "\\", "''", "\\'"]:
+            for i in [0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 100]:
+                data = "x" * i + c + "y" * (100 - i)
+                curs.execute("SELECT %s;", (data,))
+                self.assertEqual(curs.fetchone()[0], data)
+
+        self.assert_(not self.conn.notices)
+
+    @skip_from_python(3)
+    def test_string_invalid_utf8(self):
+        # the valid utf8 sequences are copied, the broken ones must be
+        # handled by libpq: they can't swallow the closing quote
+        self.conn.set_client_encoding('UTF8')
+        curs = self.conn.cursor()
+        data = u"\xe8\u20ac\U0001f600'".encode('utf8')
+        curs.execute("SELECT %s::text;", (data,))
+        self.assertEqual(curs.fetchone()[0], data)
+
+        for c in ["\xe8'", "\xc3", "\x80", "\xc0\xaf", "\xed\xa0\x80",
+                "\xf4\x90\x80\x80", "\xe2\x82'"]:
+            for i in [0, 15, 31, 100]:
+                data = "x" * i + c + "'; select 'y"
+                self.assertRaises(psycopg2.DataError,
+                    curs.execute, "SELECT %s::text;", (data,))
+                self.conn.rollback()
+
     def test_binary(self):
         data = b("""some data with \000\013 binary
         stuff into, 'quotes' and \\ a backslash too.
@@ -161,6 +190,24 @@ class QuotingTestCase(unittest.TestCase):
             self.assertEqual(res, data)
             self.assert_(not self.conn.notices)
 
+    def test_encoding_switch(self):
+        curs = self.conn.cursor()
+        curs.execute("SHOW server_encoding")
+        server_encoding = curs.fetchone()[0]
+        if server_encoding != "UTF8":
+            return self.skipTest(
+                "Unicode test skipped since server encoding is %s"
+                    % server_encoding)
+
+        # the conversion functions must follow the client encoding
+        psycopg2.extensions.register_type(psycopg2.extensions.UNICODE, self.conn)
+        data = u"\u0430\u0431\u0432 \xe0"
+        for enc, data in [('UTF8', data), ('KOI8', data[:3]),
+                ('LATIN1', data[4:]), ('UTF8', data)]:
+            self.conn.set_client_encoding(enc)
+            curs.execute("SELECT %s::text;", (data,))
+            self.assertEqual(curs.fetchone()[0], data)
+
 
 def test_suite():
     return unittest.TestLoader().loadTestsFromName(__name__)
@@ -69,6 +69,23 @@ class TypesBasicTests(unittest.TestCase):
             self.failUnless(abs(s - 19.10) < 0.001,
                         "wrong float quoting: " + str(s))
 
+    def testIntegerLimits(self):
+        curs = self.conn.cursor()
+        curs.execute("""SELECT 0, -1, 42, (-2147483648)::int4,
+            2147483647::int4, (-9223372036854775808)::int8,
+            9223372036854775807::int8, (-32768)::int2, '{-1,70000}'::int4[]
+            """)
+        self.assertEqual(curs.fetchone(), (0, -1, 42,
+            -2147483648, 2147483647,
+            -9223372036854775808, 9223372036854775807, -32768, [-1, 70000]))
+
+    def testFloatValues(self):
+        curs = self.conn.cursor()
+        curs.execute("SELECT 1.5::float8, -0.25::float4, 1e300::float8, "
+            "'{1.5,-2.5e10}'::float8[]")
+        self.assertEqual(curs.fetchone(),
+            (1.5, -0.25, 1e300, [1.5, -2.5e10]))
+
     def testBoolean(self):
         x = self.execute("SELECT %s as foo", (False,))
         self.assert_(x is False)
@@ -92,6 +109,34 @@ class TypesBasicTests(unittest.TestCase):
         else:
             return self.skipTest("decimal not available")
 
+    def testDecimalToFloat(self):
+        curs = self.conn.cursor()
+        psycopg2.extensions.register_type(psycopg2.extensions.DEC2FLOAT, curs)
+        psycopg2.extensions.register_type(
+            psycopg2.extensions.DEC2FLOATARRAY, curs)
+        curs.execute("SELECT 1.50::numeric, NULL::numeric, "
+            "'{-2.5,NaN}'::numeric[]")
+        f, n, a = curs.fetchone()
+        self.assertEqual((f, n, a[0]), (1.5, None, -2.5))
+        self.assert_(type(f) is float)
+        self.assert_(a[1] != a[1])
+
+        # other cursors are not affected
+        s = self.execute("SELECT 1.50::numeric")
+        self.assertEqual(s, decimal.Decimal("1.50"))
+
+    def testDecimalToInt(self):
+        curs = self.conn.cursor()
+        psycopg2.extensions.register_type(psycopg2.extensions.DEC2INT, curs)
+        curs.execute("SELECT 42::numeric, (-10.00)::numeric(10,2), "
+            "123456789012345678901234567890::numeric")
+        self.assertEqual(curs.fetchone(),
+            (42, -10, 123456789012345678901234567890))
+        curs.execute("SELECT 1.5::numeric")
+        self.assertRaises(psycopg2.DataError, curs.fetchone)
+        curs.execute("SELECT 'NaN'::numeric")
+        self.assertRaises(psycopg2.DataError, curs.fetchone)
+
     def testFloatNan(self):
         try:
             float("nan")
@@ -156,12 +201,65 @@ class TypesBasicTests(unittest.TestCase):
             buf2 = self.execute("SELECT %s::bytea AS foo", (buf,))
             self.assertEqual(s, buf2)
 
+    def testBinaryLargeRoundTrip(self):
+        # large enough to go through the vectorized hex code, with a tail
+        if sys.version_info[0] < 3:
+            s = ''.join([chr(x) for x in range(256)]) * 100 + 'tail'
+            buf = self.execute("SELECT %s::bytea AS foo", (psycopg2.Binary(s),))
+            self.assertEqual(s, str(buf))
+        else:
+            s = bytes(range(256)) * 100 + b'tail'
+            buf = self.execute("SELECT %s::bytea AS foo", (psycopg2.Binary(s),))
+            self.assertEqual(s, buf)
+
+    @testutils.skip_before_postgres(9, 0)
+    def testBinaryHexQuoting(self):
+        b = psycopg2.Binary(bytes(bytearray([0, 1, 0x7f, 0x80, 0xab, 0xff])))
+        b.prepare(self.conn)
+        if self.conn.get_parameter_status(
+                'standard_conforming_strings') == 'off':
+            self.assertEqual(b.getquoted(), b("E'\\\\x00017f80abff'::bytea"))
+        else:
+            self.assertEqual(b.getquoted(), b("'\\x00017f80abff'::bytea"))
+
     def testArray(self):
         s = self.execute("SELECT %s AS foo", ([[1,2],[3,4]],))
         self.failUnlessEqual(s, [[1,2],[3,4]])
         s = self.execute("SELECT %s AS foo", (['one', 'two', 'three'],))
         self.failUnlessEqual(s, ['one', 'two', 'three'])
 
+    def testNumberArrays(self):
+        curs = self.conn.cursor()
+        curs.execute("""select '{1,NULL,-3}'::int2[], '{{1,2},{3,4}}'::int4[],
+            '{9223372036854775807}'::int8[], '{1.5,NaN,-Infinity}'::float8[],
+            '{{t},{f}}'::bool[], '[0:1]={1,2}'::int4[], '{}'::float4[]""")
+        i2, i4, i8, f8, b, sl, e = curs.fetchone()
+        self.assertEqual(i2, [1, None, -3])
+        self.assertEqual(i4, [[1, 2], [3, 4]])
+        self.assertEqual(i8, [9223372036854775807])
+        self.assertEqual(f8[0], 1.5)
+        self.assert_(f8[1] != f8[1])
+        self.assertEqual(f8[2], float('-inf'))
+        self.assertEqual(b, [[True], [False]])
+        self.assertEqual(sl, [1, 2])
+        self.assertEqual(e, [])
+
+    def testPackedArrays(self):
+        import array
+        ext = psycopg2.extensions
+        curs = self.conn.cursor()
+        ext.register_type(ext.PACKEDINTEGERARRAY, curs)
+        ext.register_type(ext.PACKEDFLOATARRAY, curs)
+        curs.execute("""select '{1,2,3}'::int4[], '{{1.5},{2.5}}'::float4[],
+            '{}'::float8[]""")
+        i4, f4, e = curs.fetchone()
+        self.assertEqual(i4, array.array('i', [1, 2, 3]))
+        self.assertEqual(f4, [array.array('d', [1.5]), array.array('d', [2.5])])
+        self.assertEqual(e, array.array('d'))
+
+        curs.execute("select '{1,NULL}'::int4[]")
+        self.assertRaises(psycopg2.DataError, curs.fetchone)
+
     def testEmptyArrayRegression(self):
         # ticket #42
         import datetime
@@ -200,6 +298,57 @@ class TypesBasicTests(unittest.TestCase):
         r = self.execute("SELECT %s AS foo", (ss,))
         self.failUnlessEqual(ss, r)
 
+    def testTextArrays(self):
+        ss = [['a, b', None, 'NULL'], ['{"}', 'x' * 1000, '']]
+        r = self.execute("SELECT %s AS foo", (ss,))
+        self.failUnlessEqual(ss, r)
+        r = self.execute("""SELECT '[0:1]={a,"b c"}'::text[] AS foo""")
+        self.failUnlessEqual(['a', 'b c'], r)
+        r = self.execute("SELECT '{{},{}}'::text[] AS foo")
+        self.failUnlessEqual([], r)
+
+    def testTypedArrays(self):
+        curs = self.conn.cursor()
+        self.assertEqual(curs.mogrify("%s", ([10, None, -20],)),
+            b("'{10,NULL,-20}'::int4[]"))
+        self.assertEqual(curs.mogrify("%s", ([10, 'a'],)),
+            b("ARRAY[10, 'a']"))
+
+        # the type must be the same of the ARRAY of the items
+        for l in [[1, None, -2], [1, 2**40], [2**70, 1], [1.5, -0.25, None],
+                [1.5, float('inf')], ['a', None, 'b"\\\'', '']]:
+            curs.execute("select %s, pg_typeof(%s)::text, pg_typeof(ARRAY["
+                + ", ".join(["%s"] * len(l)) + "])::text", [l, l] + l)
+            r, t1, t2 = curs.fetchone()
+            self.assertEqual(r, l)
+            self.assertEqual(t1, t2)
+
+    def testTypedArraysMultibyte(self):
+        # in SJIS the second byte of a char may be a backslash: the strings
+        # can't be escaped for the array literal one byte at time
+        self.conn.set_client_encoding('SJIS')
+        curs = self.conn.cursor()
+        psycopg2.extensions.register_type(psycopg2.extensions.UNICODE, curs)
+        psycopg2.extensions.register_type(
+            psycopg2.extensions.UNICODEARRAY, curs)
+        l = [u'\u8868', u'x', None]
+        self.assert_(b('\x95\x5c') in l[0].encode('sjis'))
+        self.assert_(curs.mogrify("%s", (l,)).startswith(b('ARRAY[')))
+        curs.execute("select %s", (l,))
+        self.assertEqual(curs.fetchone()[0], l)
+
+    def testTupleIn(self):
+        curs = self.conn.cursor()
+        self.assertEqual(curs.mogrify("%s", ((1, 'a', None, [2]),)),
+            b("(1, 'a', NULL, '{2}'::int4[])"))
+        from psycopg2.extensions import SQL_IN
+        self.assertEqual(SQL_IN(iter([1.5, "b"])).getquoted(),
+            b("(1.5, 'b')"))
+
+        curs.execute("select %s in %s, %s in %s",
+            (3, tuple(range(1000)), 'x', ('a', 'b')))
+        self.assertEqual(curs.fetchone(), (True, False))
+
     @testutils.skip_from_python(3)
     def testTypeRoundtripBuffer(self):
         o1 = buffer("".join(map(chr, range(256))))
@@ -296,6 +445,50 @@ class TypesBasicTests(unittest.TestCase):
         l1 = self.execute("select -%s;", (-1L,))
         self.assertEqual(1, l1)
 
+    def testNumberLiterals(self):
+        from psycopg2.extensions import adapt
+        D = decimal.Decimal
+        for x, s in [(0, '0'), (-42, ' -42'),
+                (2**63, '9223372036854775808'),
+                (-2**63, ' -9223372036854775808'),
+                (1.5, '1.5'), (-0.1, ' -0.1'), (1e100, '1e+100'),
+                (D('-123.45'), ' -123.45'), (D('1E+5'), '1E+5'),
+                (D('1E-7'), '1E-7'), (D('0.000001'), '0.000001'),
+                (D('-0'), ' -0'), (D('NaN'), "'NaN'::numeric"),
+                (D('-Infinity'), "'NaN'::numeric")]:
+            self.assertEqual(adapt(x).getquoted(), b(s))
+
+        # subclasses may customize their representation
+        class MyInt(int):
+            def __str__(self): return '-1'
+        class MyDecimal(D):
+            def __str__(self): return '42'
+        self.assertEqual(adapt(MyInt(1)).getquoted(), b(' -1'))
+        self.assertEqual(adapt(MyDecimal(1)).getquoted(), b('42'))
+
+    def testBuiltinQuoting(self):
+        # builtins are quoted without adapter, but the result must be the same
+        from psycopg2.extensions import adapt
+        curs = self.conn.cursor()
+        for x in [0, -42, 10**30, -10**30, 1.5, -0.25, float('nan'),
+                float('-inf'), True, False, "hel'lo\\", u"\xe0'",
+                b("by\x00tes\xff")]:
+            a = adapt(x)
+            if hasattr(a, 'prepare'):
+                a.prepare(self.conn)
+            self.assertEqual(curs.mogrify("%s", (x,)), a.getquoted())
+            self.assertEqual(curs.mogrify("%(x)s", {'x': x}), a.getquoted())
+
+    def testBuiltinAdapterOverride(self):
+        from psycopg2.extensions import register_adapter, AsIs
+        curs = self.conn.cursor()
+        register_adapter(float, lambda f: AsIs("'%r'::numeric" % f))
+        try:
+            self.assertEqual(curs.mogrify("%s, %s", (2.5, 3)),
+                b("'2.5'::numeric, 3"))
+        finally:
+            register_adapter(float, psycopg2.extensions.Float)
+
     def testGenericArray(self):
         a = self.execute("select '{1,2,3}'::int4[]")
         self.assertEqual(a, [1,2,3])
@@ -316,6 +509,61 @@ class TypesBasicTests(unittest.TestCase):
         a = self.execute("select '{1,2,NULL}'::int4[]")
         self.assertEqual(a, [2,4,'nada'])
 
+    def testRawCaster(self):
+        def caster(s, cur):
+            return s
+        t = psycopg2.extensions.new_type((25,), "RAWTEXT", caster, raw=True)
+
+        psycopg2.extensions.register_type(t, self.conn)
+        a = self.execute("select 'hello'::text")
+        self.assertEqual(a, b('hello'))
+        self.assert_(isinstance(a, bytes))
+        a = self.execute("select NULL::text")
+        self.assertEqual(a, None)
+
+    def testColumnCaster(self):
+        calls = []
+        def caster(values, cur):
+            calls.append(len(values))
+            return [ v is not None and int(v) * 2 or None for v in values ]
+        t = psycopg2.extensions.new_type((23,), "INT4", caster, column=True)
+
+        psycopg2.extensions.register_type(t, self.conn)
+        curs = self.conn.cursor()
+        curs.execute("select x, x::text from generate_series(1, 5) x "
+            "union all select NULL, NULL")
+        self.assertEqual(curs.fetchone(), (2, '1'))
+        self.assertEqual(curs.fetchmany(2), [(4, '2'), (6, '3')])
+        self.assertEqual(curs.fetchall(),
+            [(8, '4'), (10, '5'), (None, None)])
+        self.assertEqual(calls, [1, 2, 3])
+
+    def testColumnCasterNamedCursor(self):
+        calls = []
+        def caster(values, cur):
+            calls.append(len(values))
+            return [ v is not None and int(v) * 2 or None for v in values ]
+        t = psycopg2.extensions.new_type((23,), "INT4", caster, column=True)
+
+        psycopg2.extensions.register_type(t, self.conn)
+        curs = self.conn.cursor('column_caster')
+        curs.itersize = 3
+        curs.execute("select x, x::text from generate_series(1, 7) x")
+        self.assertEqual(curs.fetchone(), (2, '1'))
+        self.assertEqual(list(curs), [ (x * 2, str(x)) for x in range(2, 8) ])
+        # the iterated rows are cast once per fetched batch
+        self.assertEqual(calls, [1, 3, 3])
+
+    def testColumnCasterBadLength(self):
+        def caster(values, cur):
+            return values[1:]
+        t = psycopg2.extensions.new_type((23,), "INT4", caster, column=True)
+
+        psycopg2.extensions.register_type(t, self.conn)
+        curs = self.conn.cursor()
+        curs.execute("select generate_series(1, 3)")
+        self.assertRaises(ValueError, curs.fetchall)
+
 
 class AdaptSubclassTest(unittest.TestCase):
     def test_adapt_subtype(self):
@@ -340,6 +588,27 @@ class AdaptSubclassTest(unittest.TestCase):
            del psycopg2.extensions.adapters[A, psycopg2.extensions.ISQLQuote]
            del psycopg2.extensions.adapters[B, psycopg2.extensions.ISQLQuote]
 
+    def test_adapt_registry_change(self):
+        from psycopg2.extensions import adapt, register_adapter, AsIs
+        from psycopg2.extensions import adapters, ISQLQuote
+
+        class A(object): pass
+        class B(A): pass
+
+        register_adapter(A, lambda a: AsIs("a"))
+        try:
+            self.assertEqual(b('a'), adapt(B()).getquoted())
+            register_adapter(B, lambda b: AsIs("b"))
+            self.assertEqual(b('b'), adapt(B()).getquoted())
+            del adapters[B, ISQLQuote]
+            self.assertEqual(b('a'), adapt(B()).getquoted())
+            adapters.update({(A, ISQLQuote): lambda a: AsIs("aa")})
+            self.assertEqual(b('aa'), adapt(B()).getquoted())
+        finally:
+           del psycopg2.extensions.adapters[A, psycopg2.extensions.ISQLQuote]
+
+        self.assertRaises(psycopg2.ProgrammingError, adapt, B())
+
     @testutils.skip_from_python(3)
     def test_no_mro_no_joy(self):
         from psycopg2.extensions import adapt, register_adapter, AsIs
@@ -429,6 +698,26 @@ class ByteaParserTest(unittest.TestCase):
     def test_full_hex_upper(self):
         return self.test_full_hex(upper=True)
 
+    def test_long_hex(self, upper=False):
+        # lengths around the vectorized blocks size
+        for n in (15, 16, 17, 31, 32, 33, 63, 64, 65, 1000):
+            buf = ''.join(("%02x" % (i % 256)) for i in range(n))
+            if upper: buf = buf.upper()
+            rv = self.cast(b('\\x' + buf))
+            if sys.version_info[0] < 3:
+                self.assertEqual(rv, ''.join(chr(i % 256) for i in range(n)))
+            else:
+                self.assertEqual(rv, bytes(i % 256 for i in range(n)))
+
+    def test_long_hex_upper(self):
+        return self.test_long_hex(upper=True)
+
+    def test_long_hex_bad_char(self):
+        # unexpected chars are skipped, even in the middle of a block
+        buf = '\\x' + '41' * 40 + ' \n' + '42' * 70
+        rv = self.cast(b(buf))
+        self.assertEqual(rv, b('A' * 40 + 'B' * 70))
+
     def test_full_escaped_octal(self):
         buf = ''.join(("\\%03o" % i) for i in range(256))
         rv = self.cast(b(buf))
@@ -22,6 +22,14 @@ import re
 import sys
 from datetime import date
 
+try:
+    import json
+except ImportError:
+    try:
+        import simplejson as json
+    except ImportError:
+        json = None
+
 from testutils import unittest, skip_if_no_uuid, skip_before_postgres
 
 import psycopg2
@@ -80,6 +88,25 @@ class TypesExtrasTests(unittest.TestCase):
         s = self.execute("SELECT '{}'::uuid[] AS foo")
         self.failUnless(type(s) == list and len(s) == 0)
 
+    @skip_if_no_uuid
+    def testUUIDRoundTrip(self):
+        import uuid
+        psycopg2.extras.register_uuid()
+        uu = [uuid.UUID(int=0), uuid.UUID(int=2 ** 128 - 1),
+            uuid.UUID('9c6d5a77-7256-457e-9461-347b4358e350')]
+        for u in uu:
+            self.assertEqual(psycopg2.extensions.adapt(u).getquoted(),
+                b("'%s'::uuid" % u))
+            s = self.execute("SELECT %s AS foo", (u,))
+            self.assertEqual(s, u)
+            self.assertEqual(s.int, u.int)
+            self.assertEqual(str(s), str(u))
+
+        # upper case and braces are parsed too
+        s = self.execute("SELECT %s::uuid",
+            ('{9C6D5A77-7256-457E-9461-347B4358E350}',))
+        self.assertEqual(s, uu[2])
+
     def testINET(self):
         psycopg2.extras.register_inet()
         i = psycopg2.extras.Inet("192.168.1.0/24")
@@ -115,6 +142,47 @@ class TypesExtrasTests(unittest.TestCase):
             filter_scs(self.conn, b("E'192.168.1.0/24'::inet")),
             a.getquoted())
 
+    def testIPADDRESS(self):
+        try:
+            import ipaddress
+        except ImportError:
+            return self.skipTest("ipaddress module not available")
+
+        psycopg2.extras.register_ipaddress(self.conn)
+        for s in ['127.0.0.1', '192.168.1.1/24', '::1', '2001:db8::1/64',
+                '::ffff:1.2.3.4/120']:
+            i = ipaddress.ip_interface(unicode(s))
+            self.assertEqual(self.execute("SELECT %s::inet", (s,)), i)
+            self.assertEqual(self.execute("SELECT %s", (i,)), i)
+
+        for s in ['10.0.0.0/8', '2001:db8::/32']:
+            n = ipaddress.ip_network(unicode(s))
+            self.assertEqual(self.execute("SELECT %s::cidr", (s,)), n)
+            self.assertEqual(self.execute("SELECT %s", (n,)), n)
+
+        a = ipaddress.ip_address(u'192.168.1.1')
+        self.assertEqual(self.execute("SELECT %s", (a,)),
+            ipaddress.ip_interface(u'192.168.1.1'))
+
+        # must survive NULL cast to inet
+        s = self.execute("SELECT NULL::inet AS foo")
+        self.failUnless(s is None)
+
+    def testIPADDRESSARRAY(self):
+        try:
+            import ipaddress
+        except ImportError:
+            return self.skipTest("ipaddress module not available")
+
+        psycopg2.extras.register_ipaddress(self.conn)
+        ii = [ipaddress.ip_interface(u'192.168.1.1/24'), None,
+            ipaddress.ip_interface(u'::1')]
+        self.assertEqual(self.execute("SELECT %s", (ii,)), ii)
+        nn = [ipaddress.ip_network(u'10.0.0.0/8'), None]
+        self.assertEqual(self.execute("SELECT %s", (nn,)), nn)
+        s = self.execute("SELECT NULL::cidr[] AS foo")
+        self.failUnless(s is None)
+
     def test_adapt_fail(self):
         class Foo(object): pass
         self.assertRaises(psycopg2.ProgrammingError,
@@ -143,16 +211,22 @@ class HstoreTestCase(unittest.TestCase):
         self.conn.close()
 
     def test_adapt_8(self):
+        from psycopg2.extras import HstoreAdapter
+        self._test_adapt_8(HstoreAdapter)
+
+    def test_adapt_8_c(self):
+        from psycopg2._psycopg import Hstore
+        self._test_adapt_8(Hstore)
+
+    def _test_adapt_8(self, adapter):
         if self.conn.server_version >= 90000:
             return self.skipTest("skipping dict adaptation with PG pre-9 syntax")
 
-        from psycopg2.extras import HstoreAdapter
-
         o = {'a': '1', 'b': "'", 'c': None}
         if self.conn.encoding == 'UTF8':
             o['d'] = u'\xe0'
 
-        a = HstoreAdapter(o)
+        a = adapter(o)
         a.prepare(self.conn)
         q = a.getquoted()
 
@@ -169,16 +243,22 @@ class HstoreTestCase(unittest.TestCase):
             self.assertEqual(ii[3], filter_scs(self.conn, b("(E'd' => E'") + encc + b("')")))
 
     def test_adapt_9(self):
+        from psycopg2.extras import HstoreAdapter
+        self._test_adapt_9(HstoreAdapter)
+
+    def test_adapt_9_c(self):
+        from psycopg2._psycopg import Hstore
+        self._test_adapt_9(Hstore)
+
+    def _test_adapt_9(self, adapter):
         if self.conn.server_version < 90000:
             return self.skipTest("skipping dict adaptation with PG 9 syntax")
 
-        from psycopg2.extras import HstoreAdapter
-
         o = {'a': '1', 'b': "'", 'c': None}
         if self.conn.encoding == 'UTF8':
             o['d'] = u'\xe0'
 
-        a = HstoreAdapter(o)
+        a = adapter(o)
         a.prepare(self.conn)
         q = a.getquoted()
 
@@ -203,9 +283,15 @@ class HstoreTestCase(unittest.TestCase):
 
     def test_parse(self):
         from psycopg2.extras import HstoreAdapter
+        self._test_parse(HstoreAdapter.parse, None)
 
+    def test_parse_c(self):
+        from psycopg2._psycopg import HSTORE
+        self._test_parse(HSTORE, self.conn.cursor())
+
+    def _test_parse(self, parse, cur):
         def ok(s, d):
-            self.assertEqual(HstoreAdapter.parse(s, None), d)
+            self.assertEqual(parse(s, cur), d)
 
         ok(None, None)
         ok('', {})
@@ -221,8 +307,7 @@ class HstoreTestCase(unittest.TestCase):
         ok(r'"a\\\\\""=>"1"', {r'a\\"': '1'})
 
         def ko(s):
-            self.assertRaises(psycopg2.InterfaceError,
-                HstoreAdapter.parse, s, None)
+            self.assertRaises(psycopg2.InterfaceError, parse, s, cur)
 
         ko('a')
         ko('"a"')
@@ -475,8 +560,25 @@ class AdaptTypeTestCase(unittest.TestCase):
 
     def test_tokenization(self):
         from psycopg2.extras import CompositeCaster
+        self._test_tokenization(CompositeCaster.tokenize)
+
+    def test_tokenization_c(self):
+        from psycopg2.extras import CompositeCaster
+        from psycopg2._psycopg import new_composite_type
+        curs = self.conn.cursor()
+        def tokenize(s):
+            # cast all the attributes as text
+            n = len(CompositeCaster.tokenize(s))
+            t = new_composite_type((0,), 'TEXTS', (25,) * n,
+                lambda *args: list(args))
+            return t(s, curs)
+
+        self._test_tokenization(tokenize)
+        self.assertEqual(tokenize('(10,"")'), ['10', ''])
+
+    def _test_tokenization(self, tokenize):
         def ok(s, v):
-            self.assertEqual(CompositeCaster.tokenize(s), v)
+            self.assertEqual(tokenize(s), v)
 
         ok("(,)", [None, None])
         ok('(hello,,10.234,2010-11-11)', ['hello', None, '10.234', '2010-11-11'])
@@ -667,6 +769,71 @@ class AdaptTypeTestCase(unittest.TestCase):
         curs.execute("select (1,2)::type_ii")
         self.assertRaises(psycopg2.DataError, curs.fetchone)
 
+        # the number of attributes is checked before casting them
+        c = CompositeCaster('type_ii', oid, [('a', 1082), ('b', 1082), ('c', 1082)])
+        psycopg2.extensions.register_type(c.typecaster, curs)
+        curs.execute("select (1,2)::type_ii")
+        try:
+            curs.fetchone()
+        except psycopg2.DataError, e:
+            self.assert_('expecting 3 components' in str(e), str(e))
+        else:
+            self.fail("DataError not raised")
+
+    @skip_if_no_composite
+    def test_cast_infinity(self):
+        self._create_type("type_di", [('adate', 'date'), ('anint', 'integer')])
+        psycopg2.extras.register_composite("type_di", self.conn)
+
+        curs = self.conn.cursor()
+        curs.execute("select '(infinity,1)'::type_di, '(-infinity,)'::type_di")
+        self.assertEqual(curs.fetchone(), ((date.max, 1), (date.min, None)))
+
+    @skip_if_no_composite
+    def test_cast_empty_string(self):
+        # as CompositeCaster.tokenize(), an empty string is read as a NULL
+        self._create_type("type_ti", [('astring', 'text'), ('anint', 'integer')])
+        psycopg2.extras.register_composite("type_ti", self.conn)
+
+        curs = self.conn.cursor()
+        curs.execute("select ('', 1)::type_ti")
+        self.assertEqual(curs.fetchone()[0], (None, 1))
+
+    @skip_if_no_composite
+    def test_subclass(self):
+        oid = self._create_type("type_ii", [("a", "integer"), ("b", "integer")])
+        from psycopg2.extras import CompositeCaster
+
+        class TokenizeCaster(CompositeCaster):
+            @classmethod
+            def tokenize(self, s):
+                return list(reversed(CompositeCaster.tokenize(s)))
+
+        c = TokenizeCaster('type_ii', oid, [('a', 23), ('b', 23)])
+        curs = self.conn.cursor()
+        psycopg2.extensions.register_type(c.typecaster, curs)
+        curs.execute("select (1,2)::type_ii")
+        self.assertEqual(curs.fetchone()[0], (2, 1))
+
+        try:
+            from collections import namedtuple
+        except ImportError:
+            return
+
+        class TypeCaster(CompositeCaster):
+            def _create_type(self, name, attnames):
+                class Pair(namedtuple(name, attnames)):
+                    def __new__(cls, a, b):
+                        return super(Pair, cls).__new__(cls, a, b * 10)
+                self.type = self._ctor = Pair
+
+        c = TypeCaster('type_ii', oid, [('a', 23), ('b', 23)])
+        psycopg2.extensions.register_type(c.typecaster, curs)
+        curs.execute("select (1,2)::type_ii")
+        v = curs.fetchone()[0]
+        self.assert_(isinstance(v, c.type))
+        self.assertEqual(v, (1, 20))
+
     @skip_if_no_composite
     @skip_before_postgres(8, 4)
     def test_from_tables(self):
@@ -736,6 +903,446 @@ class AdaptTypeTestCase(unittest.TestCase):
         return oid
 
 
+def skip_if_no_json_module(f):
+    """Skip a test if no Python json module is available"""
+    def skip_if_no_json_module_(self):
+        try:
+            import json
+        except ImportError:
+            try:
+                import simplejson as json
+            except ImportError:
+                return self.skipTest("json module not available")
+
+        return f(self)
+
+    return skip_if_no_json_module_
+
+def skip_if_no_json_type(f):
+    """Skip a test if PostgreSQL json type is not available"""
+    def skip_if_no_json_type_(self):
+        curs = self.conn.cursor()
+        curs.execute("select oid from pg_type where typname = 'json'")
+        if not curs.fetchone():
+            return self.skipTest("json not available in test database")
+
+        return f(self)
+
+    return skip_if_no_json_type_
+
+class JsonTestCase(unittest.TestCase):
+    def setUp(self):
+        self.conn = psycopg2.connect(dsn)
+
+    def tearDown(self):
+        self.conn.close()
+
+    @skip_if_no_json_module
+    def test_adapt(self):
+        from psycopg2.extras import Json
+        objs = [None, "te'xt", 123, 123.45,
+            u'\xe0\u20ac', ['a', 100], {'a': 100} ]
+
+        curs = self.conn.cursor()
+        for obj in objs:
+            qs = psycopg2.extensions.QuotedString(json.dumps(obj))
+            qs.prepare(self.conn)
+            self.assertEqual(curs.mogrify("%s", (Json(obj),)), qs.getquoted())
+
+    @skip_if_no_json_module
+    def test_adapt_dumps(self):
+        from psycopg2.extras import Json
+
+        class DecimalEncoder(json.JSONEncoder):
+            def default(self, obj):
+                if isinstance(obj, decimal.Decimal):
+                    return float(obj)
+                return json.JSONEncoder.default(self, obj)
+
+        curs = self.conn.cursor()
+        obj = decimal.Decimal('123.45')
+        dumps = lambda obj: json.dumps(obj, cls=DecimalEncoder)
+        self.assertEqual(curs.mogrify("%s", (Json(obj, dumps=dumps),)),
+            b("'123.45'"))
+
+    @skip_if_no_json_module
+    def test_adapt_subclass(self):
+        from psycopg2.extras import Json
+
+        class DecimalEncoder(json.JSONEncoder):
+            def default(self, obj):
+                if isinstance(obj, decimal.Decimal):
+                    return float(obj)
+                return json.JSONEncoder.default(self, obj)
+
+        class MyJson(Json):
+            def dumps(self, obj):
+                return json.dumps(obj, cls=DecimalEncoder)
+
+        curs = self.conn.cursor()
+        obj = decimal.Decimal('123.45')
+        self.assertEqual(curs.mogrify("%s", (MyJson(obj),)),
+            b("'123.45'"))
+
+    @skip_if_no_json_module
+    @skip_before_postgres(9, 2)
+    def test_default_cast(self):
+        curs = self.conn.cursor()
+
+        curs.execute("""select '{"a": 100.0, "b": null}'::json""")
+        self.assertEqual(curs.fetchone()[0], {'a': 100.0, 'b': None})
+
+        curs.execute("""select array['{"a": 100.0, "b": null}']::json[]""")
+        self.assertEqual(curs.fetchone()[0], [{'a': 100.0, 'b': None}])
+
+        curs.execute("""select null::json, array[null]::json[]""")
+        self.assertEqual(curs.fetchone(), (None, [None]))
+
+    @skip_if_no_json_module
+    @skip_before_postgres(9, 4)
+    def test_default_cast_jsonb(self):
+        curs = self.conn.cursor()
+
+        curs.execute("""select '{"a": 100.0, "b": null}'::jsonb""")
+        self.assertEqual(curs.fetchone()[0], {'a': 100.0, 'b': None})
+
+        curs.execute("""select array['{"a": 100.0, "b": null}']::jsonb[]""")
+        self.assertEqual(curs.fetchone()[0], [{'a': 100.0, 'b': None}])
+
+    @skip_if_no_json_module
+    @skip_if_no_json_type
+    def test_register_on_connection(self):
+        from psycopg2.extras import register_json
+        register_json(self.conn,
+            loads=lambda s: json.loads(s, parse_float=decimal.Decimal))
+
+        curs = self.conn.cursor()
+        curs.execute("""select '{"a": 100.0, "b": null}'::json""")
+        data = curs.fetchone()[0]
+        self.assert_(isinstance(data['a'], decimal.Decimal))
+        self.assertEqual(data['a'], decimal.Decimal('100.0'))
+
+        conn2 = psycopg2.connect(dsn)
+        try:
+            curs = conn2.cursor()
+            curs.execute("""select '{"a": 100.0}'::json""")
+            self.assert_(isinstance(curs.fetchone()[0]['a'], float))
+        finally:
+            conn2.close()
+
+    @skip_if_no_json_module
+    @skip_before_postgres(9, 2)
+    def test_register_default(self):
+        from psycopg2.extras import register_default_json
+        register_default_json(self.conn,
+            loads=lambda s: json.loads(s, parse_float=decimal.Decimal))
+
+        curs = self.conn.cursor()
+        curs.execute("""select '{"a": 100.0, "b": null}'::json""")
+        data = curs.fetchone()[0]
+        self.assert_(isinstance(data['a'], decimal.Decimal))
+        self.assertEqual(data['a'], decimal.Decimal('100.0'))
+
+        curs.execute("""select array['{"a": 100.0, "b": null}']::json[]""")
+        data = curs.fetchone()[0]
+        self.assert_(isinstance(data[0]['a'], decimal.Decimal))
+        self.assertEqual(data[0]['a'], decimal.Decimal('100.0'))
+
+    @skip_if_no_json_module
+    @skip_before_postgres(9, 2)
+    def test_round_trip(self):
+        from psycopg2.extras import Json
+        curs = self.conn.cursor()
+        obj = {'a': [1, 2.5, None], 'b': u'\xe0', 'c': "te'xt"}
+        curs.execute("select %s::json", (Json(obj),))
+        self.assertEqual(curs.fetchone()[0], obj)
+
+
+class RangeTestCase(unittest.TestCase):
+    def setUp(self):
+        self.conn = psycopg2.connect(dsn)
+
+    def tearDown(self):
+        self.conn.close()
+
+    def test_noparam(self):
+        from psycopg2.extras import Range
+        r = Range()
+
+        self.assert_(not r.isempty)
+        self.assertEqual(r.lower, None)
+        self.assertEqual(r.upper, None)
+        self.assert_(r.lower_inf)
+        self.assert_(r.upper_inf)
+        self.assert_(not r.lower_inc)
+        self.assert_(not r.upper_inc)
+
+    def test_empty(self):
+        from psycopg2.extras import Range
+        r = Range(empty=True)
+
+        self.assert_(r.isempty)
+        self.assertEqual(r.lower, None)
+        self.assertEqual(r.upper, None)
+        self.assert_(not r.lower_inf)
+        self.assert_(not r.upper_inf)
+        self.assert_(not r.lower_inc)
+        self.assert_(not r.upper_inc)
+        self.assert_(not r)
+
+    def test_bounds(self):
+        from psycopg2.extras import Range
+        for bounds, lower_inc, upper_inc in [
+                ('[)', True, False),
+                ('(]', False, True),
+                ('()', False, False),
+                ('[]', True, True),]:
+            r = Range(10, 20, bounds)
+            self.assertEqual(r.lower, 10)
+            self.assertEqual(r.upper, 20)
+            self.assertEqual(r.lower_inc, lower_inc)
+            self.assertEqual(r.upper_inc, upper_inc)
+
+        self.assertRaises(ValueError, Range, bounds='(')
+        self.assertRaises(ValueError, Range, bounds='[}')
+
+    def test_in(self):
+        from psycopg2.extras import Range
+        r = Range(10, 20, '[)')
+        self.assert_(9 not in r)
+        self.assert_(10 in r)
+        self.assert_(19 in r)
+        self.assert_(20 not in r)
+
+        r = Range(10, None, '(]')
+        self.assert_(10 not in r)
+        self.assert_(10000 in r)
+        self.assert_(1 not in Range(empty=True))
+
+    def test_eq_hash(self):
+        from psycopg2.extras import Range
+        self.assertEqual(Range(10, 20), Range(10, 20))
+        self.assertNotEqual(Range(10, 20), Range(10, 20, '[]'))
+        self.assertEqual(Range(empty=True), Range(empty=True))
+        self.assertEqual(hash(Range(10, 20)), hash(Range(10, 20)))
+
+    def test_pickling(self):
+        import pickle
+        from psycopg2.extras import NumericRange
+        r = NumericRange(10, 20, '(]')
+        self.assertEqual(pickle.loads(pickle.dumps(r)), r)
+
+    def test_parse_c(self):
+        from psycopg2.extras import RangeCaster, NumberRangeAdapter
+        from psycopg2.extras import NumericRange
+
+        # the typecaster implemented in C agrees with the Python parser
+        caster = RangeCaster(NumberRangeAdapter, NumericRange,
+            oid=3904, subtype_oid=23)
+        curs = self.conn.cursor()
+        for s in ['empty', '[1,10)', '(,5]', '[3,)', '(,)', '("1","10")']:
+            self.assertEqual(caster.typecaster(s, curs), caster.parse(s, curs))
+
+        self.assertRaises(psycopg2.InterfaceError,
+            caster.typecaster, '[1,2', curs)
+        self.assertRaises(psycopg2.InterfaceError,
+            caster.typecaster, '[1,2,3)', curs)
+
+    def test_adapt_number(self):
+        from psycopg2.extras import NumericRange
+        curs = self.conn.cursor()
+        for r, s in [
+                (NumericRange(10, 20), "'[10,20)'"),
+                (NumericRange(None, 20, '(]'), "'(,20]'"),
+                (NumericRange(empty=True), "'empty'"),]:
+            self.assertEqual(curs.mogrify("%s", (r,)), b(s))
+
+    def test_adapt_named(self):
+        from psycopg2.extras import DateRange
+        curs = self.conn.cursor()
+        r = DateRange(date(2012, 1, 1), None)
+        self.assertEqual(curs.mogrify("%s", (r,)),
+            b("daterange('2012-01-01'::date, NULL, '[)')"))
+        self.assertEqual(curs.mogrify("%s", (DateRange(empty=True),)),
+            b("'empty'::daterange"))
+
+
+class RangeCasterTestCase(unittest.TestCase):
+    def setUp(self):
+        self.conn = psycopg2.connect(dsn)
+
+    def tearDown(self):
+        self.conn.close()
+
+    builtin_ranges = ('int4range', 'int8range', 'numrange',
+        'daterange', 'tsrange', 'tstzrange')
+
+    @skip_before_postgres(9, 2)
+    def test_cast_null(self):
+        cur = self.conn.cursor()
+        for type in self.builtin_ranges:
+            cur.execute("select NULL::%s" % type)
+            r = cur.fetchone()[0]
+            self.assertEqual(r, None)
+
+    @skip_before_postgres(9, 2)
+    def test_cast_empty(self):
+        from psycopg2.extras import Range
+        cur = self.conn.cursor()
+        for type in self.builtin_ranges:
+            cur.execute("select 'empty'::%s" % type)
+            r = cur.fetchone()[0]
+            self.assert_(isinstance(r, Range), type)
+            self.assert_(r.isempty)
+
+    @skip_before_postgres(9, 2)
+    def test_cast_numbers(self):
+        from psycopg2.extras import NumericRange
+        cur = self.conn.cursor()
+        for type in ('int4range', 'int8range'):
+            cur.execute("select '(10,20)'::%s" % type)
+            r = cur.fetchone()[0]
+            self.assert_(isinstance(r, NumericRange))
+            self.assertEqual(r.lower, 11)
+            self.assertEqual(r.upper, 20)
+            self.assert_(r.lower_inc)
+            self.assert_(not r.upper_inc)
+
+        cur.execute("select '(10.2,20.6)'::numrange")
+        r = cur.fetchone()[0]
+        self.assert_(isinstance(r, NumericRange))
+        self.assertEqual(r.lower, decimal.Decimal('10.2'))
+        self.assertEqual(r.upper, decimal.Decimal('20.6'))
+        self.assert_(not r.lower_inc)
+        self.assert_(not r.upper_inc)
+
+    @skip_before_postgres(9, 2)
+    def test_cast_timestamptz(self):
+        from psycopg2.extras import DateTimeTZRange
+        from datetime import datetime
+        from psycopg2.tz import FixedOffsetTimezone
+        cur = self.conn.cursor()
+        ts1 = datetime(2000,1,1, tzinfo=FixedOffsetTimezone(600))
+        ts2 = datetime(2000,12,31,23,59,59,999, tzinfo=FixedOffsetTimezone(600))
+        cur.execute("select tstzrange(%s, %s, '[]')", (ts1, ts2))
+        r = cur.fetchone()[0]
+        self.assert_(isinstance(r, DateTimeTZRange))
+        self.assertEqual(r.lower, ts1)
+        self.assertEqual(r.upper, ts2)
+        self.assert_(r.lower_inc)
+        self.assert_(r.upper_inc)
+
+    @skip_before_postgres(9, 2)
+    def test_cast_infinity(self):
+        from psycopg2.extras import DateRange, DateTimeTZRange
+        from datetime import datetime
+        cur = self.conn.cursor()
+        cur.execute("select '[2020-01-01,infinity)'::daterange, "
+            "'[-infinity,2020-01-01)'::daterange")
+        r1, r2 = cur.fetchone()
+        self.assert_(isinstance(r1, DateRange))
+        self.assertEqual(r1.lower, date(2020, 1, 1))
+        self.assertEqual(r1.upper, date.max)
+        self.assertEqual(r2.lower, date.min)
+        self.assertEqual(r2.upper, date(2020, 1, 1))
+
+        cur.execute("select '[2020-01-01 00:00:00+00,infinity)'::tstzrange, "
+            "'[-infinity,2020-01-01 00:00:00+00)'::tstzrange")
+        r1, r2 = cur.fetchone()
+        self.assert_(isinstance(r1, DateTimeTZRange))
+        self.assertEqual(r1.lower.year, 2020)
+        self.assertEqual(r1.upper, datetime.max)
+        self.assertEqual(r2.lower, datetime.min)
+        self.assertEqual(r2.upper.year, 2020)
+
+    @skip_before_postgres(9, 2)
+    def test_round_trip(self):
+        from psycopg2.extras import NumericRange, DateRange
+        cur = self.conn.cursor()
+        for r, type in [
+                (NumericRange(10, 20), 'int4range'),
+                (NumericRange(None, decimal.Decimal('1.5'), '(]'), 'numrange'),
+                (DateRange(date(2012, 1, 1), date(2012, 2, 1)), 'daterange'),
+                (DateRange(empty=True), 'daterange'),]:
+            cur.execute("select %%s::%s" % type, (r,))
+            self.assertEqual(cur.fetchone()[0], r)
+
+        r = [NumericRange(1, 2), NumericRange(empty=True)]
+        cur.execute("select %s::int4range[]", (r,))
+        self.assertEqual(cur.fetchone()[0], r)
+
+    @skip_before_postgres(9, 2)
+    def test_register_range_adapter(self):
+        from psycopg2.extras import Range, register_range
+        cur = self.conn.cursor()
+        cur.execute("create type textrange as range (subtype=text)")
+        rc = register_range('textrange', 'TextRange', cur)
+
+        TextRange = rc.range
+        self.assert_(issubclass(TextRange, Range))
+        self.assertEqual(TextRange.__name__, 'TextRange')
+
+        r = TextRange('a', 'b,"c', '(]')
+        cur.execute("select %s", [r])
+        r1 = cur.fetchone()[0]
+        self.assertEqual(r1, r)
+
+    @skip_before_postgres(9, 2)
+    def test_range_escaping(self):
+        from psycopg2.extras import register_range
+        cur = self.conn.cursor()
+        cur.execute("create type textrange as range (subtype=text)")
+        rc = register_range('textrange', 'TextRange', cur)
+
+        TextRange = rc.range
+        cur.execute("""
+            create table rangetest (
+                id integer primary key,
+                range textrange)""")
+
+        bounds = [ '[)', '(]', '()', '[]' ]
+        ranges = [ TextRange(low, up, bounds[i % 4])
+            for i, (low, up) in enumerate(zip(
+                [None] + map(chr, range(1, 128)),
+                map(chr, range(1, 128)) + [None],
+                ))]
+        ranges.append(TextRange())
+        ranges.append(TextRange(empty=True))
+
+        errs = 0
+        for i, r in enumerate(ranges):
+            # depending on the collation some of the ranges have the lower
+            # bound greater than the upper one and fail to insert
+            try:
+                cur.execute("""
+                    savepoint x;
+                    insert into rangetest (id, range) values (%s, %s);
+                    """, (i, r))
+            except psycopg2.DataError:
+                errs += 1
+                cur.execute("rollback to savepoint x;")
+
+        # but not too many of them
+        self.assert_(errs < 30,
+            "too many collate errors. Is the test working?")
+
+        cur.execute("select id, range from rangetest order by id")
+        for i, r in cur:
+            self.assertEqual(ranges[i].lower, r.lower)
+            self.assertEqual(ranges[i].upper, r.upper)
+            self.assertEqual(ranges[i].lower_inc, r.lower_inc)
+            self.assertEqual(ranges[i].upper_inc, r.upper_inc)
+            self.assertEqual(ranges[i].lower_inf, r.lower_inf)
+            self.assertEqual(ranges[i].upper_inf, r.upper_inf)
+
+    @skip_before_postgres(9, 2)
+    def test_register_range_not_found(self):
+        from psycopg2.extras import register_range
+        cur = self.conn.cursor()
+        self.assertRaises(psycopg2.ProgrammingError,
+            register_range, 'nosuchrange', 'FailRange', cur)
+
+
 def test_suite():
     return unittest.TestLoader().loadTestsFromName(__name__)
 